@@ -0,0 +1,253 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* benchmark-graphic-effects.c: Checks and times the pixel kernels used
+   for icon highlighting.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+/* Usage: benchmark-graphic-effects [size] [iterations]
+ *
+ * Run with EEL_PIXEL_KERNELS=scalar or EEL_PIXEL_KERNELS=sse2 to compare
+ * against the slower kernels.
+ */
+
+#include <config.h>
+
+#include <eel/eel-graphic-effects.h>
+#include <stdlib.h>
+
+#define DEFAULT_SIZE 256
+#define DEFAULT_ITERATIONS 1000
+
+/* The effects on a single premultiplied pixel, as the kernels must
+ * compute them.
+ */
+static guint32
+reference_spotlight (guint32 pixel)
+{
+	guint a, k, c, shift;
+	guint32 result;
+
+	a = pixel >> 24;
+	k = (a * 3 + 16) >> 5;
+	result = pixel & 0xff000000;
+	for (shift = 0; shift < 24; shift += 8) {
+		c = (pixel >> shift) & 0xff;
+		result |= MIN (c + (c >> 3) + k, a) << shift;
+	}
+
+	return result;
+}
+
+static guint32
+reference_colorize (guint32 pixel, const guint *factors)
+{
+	guint shift, i;
+	guint32 result;
+
+	result = pixel & 0xff000000;
+	for (shift = 0, i = 0; shift < 24; shift += 8, i++) {
+		result |= ((((pixel >> shift) & 0xff) * factors[i]) >> 8) << shift;
+	}
+
+	return result;
+}
+
+static guint32
+reference_darken (guint32 pixel, int saturation, int darken)
+{
+	guint gray, keep, intensity, c, shift;
+	guint32 result;
+
+	gray = ((255 - saturation) * darken) >> 8;
+	keep = (saturation * darken) >> 8;
+	intensity = (((pixel >> 16) & 0xff) * 77 +
+		     ((pixel >> 8) & 0xff) * 150 +
+		     (pixel & 0xff) * 28) >> 8;
+
+	result = pixel & 0xff000000;
+	for (shift = 0; shift < 24; shift += 8) {
+		c = (pixel >> shift) & 0xff;
+		result |= (((gray * intensity) >> 8) + ((keep * c) >> 8)) << shift;
+	}
+
+	return result;
+}
+
+static cairo_surface_t *
+create_test_surface (int size)
+{
+	cairo_surface_t *surface;
+	guint32 *row, alpha, pixel;
+	int x, y, shift;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, size, size);
+	cairo_surface_flush (surface);
+
+	for (y = 0; y < size; y++) {
+		row = (guint32 *) (cairo_image_surface_get_data (surface) +
+				   y * cairo_image_surface_get_stride (surface));
+		for (x = 0; x < size; x++) {
+			alpha = g_random_int_range (0, 256);
+			pixel = alpha << 24;
+			for (shift = 0; shift < 24; shift += 8) {
+				pixel |= g_random_int_range (0, alpha + 1) << shift;
+			}
+			row[x] = pixel;
+		}
+	}
+	cairo_surface_mark_dirty (surface);
+
+	return surface;
+}
+
+typedef enum {
+	SPOTLIGHT,
+	COLORIZE,
+	DARKEN
+} Effect;
+
+static GdkRGBA color = { 0.25, 0.5, 0.75, 1.0 };
+static const guint color_factors[3] = { 191, 128, 64 };
+
+static void
+apply (cairo_surface_t *surface, Effect effect)
+{
+	switch (effect) {
+	case SPOTLIGHT:
+		eel_spotlight_surface (surface);
+		break;
+	case COLORIZE:
+		eel_colorize_surface (surface, &color);
+		break;
+	case DARKEN:
+		eel_darken_surface (surface, 160, 200);
+		break;
+	}
+}
+
+static guint32
+apply_reference (guint32 pixel, Effect effect)
+{
+	switch (effect) {
+	case SPOTLIGHT:
+		return reference_spotlight (pixel);
+	case COLORIZE:
+		return reference_colorize (pixel, color_factors);
+	default:
+		return reference_darken (pixel, 160, 200);
+	}
+}
+
+static gboolean
+check_effect (cairo_surface_t *source, Effect effect)
+{
+	cairo_surface_t *result;
+	guint32 *source_row, *result_row;
+	int x, y, size, stride;
+	gboolean ok;
+
+	result = eel_copy_image_surface (source);
+	apply (result, effect);
+
+	size = cairo_image_surface_get_width (source);
+	stride = cairo_image_surface_get_stride (source);
+	ok = TRUE;
+
+	for (y = 0; y < size && ok; y++) {
+		source_row = (guint32 *) (cairo_image_surface_get_data (source) + y * stride);
+		result_row = (guint32 *) (cairo_image_surface_get_data (result) + y * stride);
+		for (x = 0; x < size; x++) {
+			if (result_row[x] != apply_reference (source_row[x], effect)) {
+				g_printerr ("pixel %d,%d: %08x became %08x, expected %08x\n",
+					    x, y, source_row[x], result_row[x],
+					    apply_reference (source_row[x], effect));
+				ok = FALSE;
+				break;
+			}
+		}
+	}
+
+	cairo_surface_destroy (result);
+
+	return ok;
+}
+
+static void
+time_effect (cairo_surface_t *source, Effect effect, const char *name, int iterations)
+{
+	cairo_surface_t *surface;
+	GTimer *timer;
+	double seconds;
+	int i, size;
+
+	surface = eel_copy_image_surface (source);
+	size = cairo_image_surface_get_width (source);
+
+	timer = g_timer_new ();
+	for (i = 0; i < iterations; i++) {
+		apply (surface, effect);
+	}
+	seconds = g_timer_elapsed (timer, NULL);
+
+	g_print ("%-10s %8.3f ms  %8.1f Mpixels/s\n", name, seconds * 1000,
+		 (double) size * size * iterations / seconds / 1e6);
+
+	g_timer_destroy (timer);
+	cairo_surface_destroy (surface);
+}
+
+int
+main (int argc, char *argv[])
+{
+	cairo_surface_t *source;
+	int size, iterations;
+	gboolean ok;
+
+	size = DEFAULT_SIZE;
+	iterations = DEFAULT_ITERATIONS;
+	if (argc > 1) {
+		size = MAX (atoi (argv[1]), 1);
+	}
+	if (argc > 2) {
+		iterations = MAX (atoi (argv[2]), 1);
+	}
+
+	/* An odd size also covers the pixels left over after each
+	 * vector in a row.
+	 */
+	source = create_test_surface (size | 1);
+
+	ok = check_effect (source, SPOTLIGHT)
+		&& check_effect (source, COLORIZE)
+		&& check_effect (source, DARKEN);
+	if (!ok) {
+		cairo_surface_destroy (source);
+		return EXIT_FAILURE;
+	}
+
+	g_print ("%s kernels, %dx%d pixels, %d iterations\n",
+		 eel_graphic_effects_get_kernel_name (), size | 1, size | 1, iterations);
+
+	time_effect (source, SPOTLIGHT, "spotlight", iterations);
+	time_effect (source, COLORIZE, "colorize", iterations);
+	time_effect (source, DARKEN, "darken", iterations);
+
+	cairo_surface_destroy (source);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* benchmark-ref-str.c: Checks and times interning of unique refcounted
+   strings from many threads at once.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+/* Usage: benchmark-ref-str [threads] [iterations]
+ *
+ * Run with EEL_REF_STR_SHARDS=1 to compare against a single table.
+ */
+
+#include <config.h>
+
+#include <eel/eel-string.h>
+#include <stdlib.h>
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_ITERATIONS 1000000
+
+/* Roughly what interning sees while loading a directory: a few
+ * strings that come up all the time and a long tail of rarer ones.
+ */
+#define N_COMMON_STRINGS 16
+#define N_STRINGS 1024
+
+/* How many strings each thread holds on to, like files holding their
+ * mime type, owner and group.
+ */
+#define N_HELD 64
+
+static char *strings[N_STRINGS];
+static int iterations;
+static volatile gint failures;
+
+static const char *
+pick_string (GRand *rand)
+{
+	if (g_rand_int_range (rand, 0, 4) != 0) {
+		return strings[g_rand_int_range (rand, 0, N_COMMON_STRINGS)];
+	}
+	return strings[g_rand_int_range (rand, 0, N_STRINGS)];
+}
+
+static gpointer
+intern_strings (gpointer data)
+{
+	eel_ref_str held[N_HELD] = { NULL };
+	eel_ref_str str, again;
+	GRand *rand;
+	const char *string;
+	int i, slot;
+
+	rand = g_rand_new_with_seed (GPOINTER_TO_UINT (data));
+
+	for (i = 0; i < iterations; i++) {
+		string = pick_string (rand);
+		str = eel_ref_str_get_unique (string);
+
+		/* While we hold a reference, everyone must get the same copy */
+		again = eel_ref_str_get_unique (string);
+		if (again != str || g_strcmp0 (str, string) != 0) {
+			g_atomic_int_inc (&failures);
+		}
+		eel_ref_str_unref (again);
+
+		slot = g_rand_int_range (rand, 0, N_HELD);
+		eel_ref_str_unref (held[slot]);
+		held[slot] = str;
+	}
+
+	for (slot = 0; slot < N_HELD; slot++) {
+		eel_ref_str_unref (held[slot]);
+	}
+
+	g_rand_free (rand);
+
+	return NULL;
+}
+
+static double
+run_threads (int n_threads)
+{
+	GThread **threads;
+	GTimer *timer;
+	double seconds;
+	int i;
+
+	threads = g_new (GThread *, n_threads);
+
+	timer = g_timer_new ();
+	for (i = 0; i < n_threads; i++) {
+		threads[i] = g_thread_new ("intern", intern_strings,
+					   GUINT_TO_POINTER (i + 1));
+	}
+	for (i = 0; i < n_threads; i++) {
+		g_thread_join (threads[i]);
+	}
+	seconds = g_timer_elapsed (timer, NULL);
+
+	g_timer_destroy (timer);
+	g_free (threads);
+
+	return seconds;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int max_threads, n_threads, i;
+	double seconds;
+
+	max_threads = DEFAULT_THREADS;
+	iterations = DEFAULT_ITERATIONS;
+	if (argc > 1) {
+		max_threads = MAX (atoi (argv[1]), 1);
+	}
+	if (argc > 2) {
+		iterations = MAX (atoi (argv[2]), 1);
+	}
+
+	for (i = 0; i < N_STRINGS; i++) {
+		strings[i] = g_strdup_printf ("application/x-type-%d", i);
+	}
+
+	g_print ("%s shards, %d iterations per thread\n",
+		 g_getenv ("EEL_REF_STR_SHARDS") != NULL ?
+		 g_getenv ("EEL_REF_STR_SHARDS") : "default", iterations);
+
+	for (n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+		seconds = run_threads (n_threads);
+		g_print ("%3d threads %8.3f ms  %8.2f Mlookups/s\n", n_threads,
+			 seconds * 1000,
+			 /* Two lookups per iteration */
+			 2.0 * iterations * n_threads / seconds / 1e6);
+	}
+
+	for (i = 0; i < N_STRINGS; i++) {
+		g_free (strings[i]);
+	}
+
+	if (failures > 0) {
+		g_printerr ("%d lookups returned the wrong string\n", failures);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -541,6 +541,15 @@ eel_canvas_queue_resize (EelCanvas *canvas)
 /* Convenience function to reorder items in a group's child list.  This puts the
  * specified link after the "before" link. Returns TRUE if the list was changed.
  */
+static GList *
+group_find_link (EelCanvasGroup *group, EelCanvasItem *item)
+{
+	if (group->item_links == NULL)
+		return NULL;
+
+	return g_hash_table_lookup (group->item_links, item);
+}
+
 static gboolean
 put_item_after (GList *link, GList *before)
 {
@@ -616,7 +625,7 @@ eel_canvas_item_raise (EelCanvasItem *item, int positions)
 		return;
 
 	parent = EEL_CANVAS_GROUP (item->parent);
-	link = g_list_find (parent->item_list, item);
+	link = group_find_link (parent, item);
 	g_assert (link != NULL);
 
 	for (before = link; positions && before; positions--)
@@ -653,7 +662,7 @@ eel_canvas_item_lower (EelCanvasItem *item, int positions)
 		return;
 
 	parent = EEL_CANVAS_GROUP (item->parent);
-	link = g_list_find (parent->item_list, item);
+	link = group_find_link (parent, item);
 	g_assert (link != NULL);
 
 	if (link->prev)
@@ -686,7 +695,7 @@ eel_canvas_item_raise_to_top (EelCanvasItem *item)
 		return;
 
 	parent = EEL_CANVAS_GROUP (item->parent);
-	link = g_list_find (parent->item_list, item);
+	link = group_find_link (parent, item);
 	g_assert (link != NULL);
 
 	if (put_item_after (link, parent->item_list_end)) {
@@ -713,7 +722,7 @@ eel_canvas_item_lower_to_bottom (EelCanvasItem *item)
 		return;
 
 	parent = EEL_CANVAS_GROUP (item->parent);
-	link = g_list_find (parent->item_list, item);
+	link = group_find_link (parent, item);
 	g_assert (link != NULL);
 
 	if (put_item_after (link, NULL)) {
@@ -1374,6 +1383,11 @@ eel_canvas_group_destroy (EelCanvasItem *object)
 		eel_canvas_item_destroy (child);
 	}
 
+	if (group->item_links) {
+		g_hash_table_destroy (group->item_links);
+		group->item_links = NULL;
+	}
+
 	if (EEL_CANVAS_ITEM_CLASS (group_parent_class)->destroy)
 		(* EEL_CANVAS_ITEM_CLASS (group_parent_class)->destroy) (object);
 }
@@ -1674,6 +1688,10 @@ group_add (EelCanvasGroup *group, EelCanvasItem *item)
 	} else
 		group->item_list_end = g_list_append (group->item_list_end, item)->next;
 
+	if (!group->item_links)
+		group->item_links = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_hash_table_insert (group->item_links, item, group->item_list_end);
+
 	if (item->flags & EEL_CANVAS_ITEM_VISIBLE &&
 	    group->item.flags & EEL_CANVAS_ITEM_MAPPED) {
 		if (!(item->flags & EEL_CANVAS_ITEM_REALIZED))
@@ -1696,33 +1714,34 @@ group_remove (EelCanvasGroup *group, EelCanvasItem *item)
 	g_return_if_fail (EEL_IS_CANVAS_GROUP (group));
 	g_return_if_fail (EEL_IS_CANVAS_ITEM (item));
 
-	for (children = group->item_list; children; children = children->next)
-		if (children->data == item) {
-			if (item->flags & EEL_CANVAS_ITEM_MAPPED) {
-				(* EEL_CANVAS_ITEM_GET_CLASS (item)->unmap) (item);
-			}
+	children = group_find_link (group, item);
+	if (children == NULL)
+		return;
 
-			if (item->flags & EEL_CANVAS_ITEM_REALIZED)
-				(* EEL_CANVAS_ITEM_GET_CLASS (item)->unrealize) (item);
+	if (item->flags & EEL_CANVAS_ITEM_MAPPED) {
+		(* EEL_CANVAS_ITEM_GET_CLASS (item)->unmap) (item);
+	}
 
-			if (item->flags & EEL_CANVAS_ITEM_VISIBLE)
-				eel_canvas_queue_resize (item->canvas);
+	if (item->flags & EEL_CANVAS_ITEM_REALIZED)
+		(* EEL_CANVAS_ITEM_GET_CLASS (item)->unrealize) (item);
 
-			/* Unparent the child */
+	if (item->flags & EEL_CANVAS_ITEM_VISIBLE)
+		eel_canvas_queue_resize (item->canvas);
 
-			item->parent = NULL;
-			/* item->canvas = NULL; */
-			g_object_unref (G_OBJECT (item));
+	/* Unparent the child */
 
-			/* Remove it from the list */
+	item->parent = NULL;
+	/* item->canvas = NULL; */
+	g_object_unref (G_OBJECT (item));
 
-			if (children == group->item_list_end)
-				group->item_list_end = children->prev;
+	/* Remove it from the list */
 
-			group->item_list = g_list_remove_link (group->item_list, children);
-			g_list_free (children);
-			break;
-		}
+	if (children == group->item_list_end)
+		group->item_list_end = children->prev;
+
+	g_hash_table_remove (group->item_links, item);
+	group->item_list = g_list_remove_link (group->item_list, children);
+	g_list_free (children);
 }
 
 
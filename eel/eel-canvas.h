@@ -329,6 +329,9 @@ struct _EelCanvasGroup {
 	/* Children of the group */
 	GList *item_list;
 	GList *item_list_end;
+
+	/* Maps each child to its link in item_list */
+	GHashTable *item_links;
 };
 
 struct _EelCanvasGroupClass {
@@ -32,6 +32,17 @@
 
 #include <string.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#define EEL_HAVE_SSE2_KERNELS
+#endif
+
+#if defined (EEL_HAVE_SSE2_KERNELS) && defined (__GNUC__) && !defined (__clang__) \
+	&& (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define EEL_HAVE_AVX2_KERNELS
+#endif
+
 /* shared utility to create a new pixbuf from the passed-in one */
 
 static GdkPixbuf *
@@ -212,6 +223,509 @@ eel_create_colorized_pixbuf (GdkPixbuf *src,
 	return dest;
 }
 
+/* In-place effects on premultiplied cairo image surfaces.
+ *
+ * The kernels work on rows of 32-bit pixels. Since all three effects are
+ * linear in the color components, or clamped to the alpha value, they can
+ * be applied to premultiplied pixels directly. RGB24 surfaces are handled
+ * by treating the unused byte as opaque alpha.
+ *
+ * The SSE2 and AVX2 versions widen the pixels to 16 bits per component
+ * and compute exactly the same values as the scalar version, which also
+ * handles the pixels left over at the end of a row.
+ */
+
+#define SPOTLIGHT_COMPONENT(c, a, k) MIN ((c) + ((c) >> 3) + (k), (a))
+
+static void
+spotlight_row_scalar (guint32 *row, int n, guint32 alpha_mask)
+{
+	guint32 pixel;
+	guint a, k;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		pixel = row[i] | alpha_mask;
+		a = pixel >> 24;
+		k = (a * 3 + 16) >> 5;
+		row[i] = (pixel & 0xff000000)
+			| (SPOTLIGHT_COMPONENT ((pixel >> 16) & 0xff, a, k) << 16)
+			| (SPOTLIGHT_COMPONENT ((pixel >> 8) & 0xff, a, k) << 8)
+			| SPOTLIGHT_COMPONENT (pixel & 0xff, a, k);
+	}
+}
+
+/* factors are in B, G, R, A order, as the components in memory */
+static void
+colorize_row_scalar (guint32 *row, int n, guint32 alpha_mask, const guint16 *factors)
+{
+	guint32 pixel;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		pixel = row[i] | alpha_mask;
+		row[i] = (pixel & 0xff000000)
+			| (((((pixel >> 16) & 0xff) * factors[2]) >> 8) << 16)
+			| (((((pixel >> 8) & 0xff) * factors[1]) >> 8) << 8)
+			| (((pixel & 0xff) * factors[0]) >> 8);
+	}
+}
+
+#define DARKEN_COMPONENT(c, intensity, gray, keep) \
+	((((gray) * (intensity)) >> 8) + (((keep) * (c)) >> 8))
+
+static void
+darken_row_scalar (guint32 *row, int n, guint32 alpha_mask, const guint16 *gray, const guint16 *keep)
+{
+	guint32 pixel;
+	guint r, g, b, intensity;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		pixel = row[i] | alpha_mask;
+		r = (pixel >> 16) & 0xff;
+		g = (pixel >> 8) & 0xff;
+		b = pixel & 0xff;
+		intensity = (r * 77 + g * 150 + b * 28) >> 8;
+		row[i] = (pixel & 0xff000000)
+			| (DARKEN_COMPONENT (r, intensity, gray[2], keep[2]) << 16)
+			| (DARKEN_COMPONENT (g, intensity, gray[1], keep[1]) << 8)
+			| DARKEN_COMPONENT (b, intensity, gray[0], keep[0]);
+	}
+}
+
+#ifdef EEL_HAVE_SSE2_KERNELS
+
+static inline __m128i
+broadcast_component_sse2 (__m128i pixels, int component)
+{
+	switch (component) {
+	case 0:
+		return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, _MM_SHUFFLE (0, 0, 0, 0)), _MM_SHUFFLE (0, 0, 0, 0));
+	case 1:
+		return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, _MM_SHUFFLE (1, 1, 1, 1)), _MM_SHUFFLE (1, 1, 1, 1));
+	case 2:
+		return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, _MM_SHUFFLE (2, 2, 2, 2)), _MM_SHUFFLE (2, 2, 2, 2));
+	default:
+		return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, _MM_SHUFFLE (3, 3, 3, 3)), _MM_SHUFFLE (3, 3, 3, 3));
+	}
+}
+
+static inline __m128i
+set_components_sse2 (const guint16 *components)
+{
+	return _mm_set_epi16 (components[3], components[2], components[1], components[0],
+			      components[3], components[2], components[1], components[0]);
+}
+
+/* two pixels with 16-bit components */
+static inline __m128i
+spotlight_sse2 (__m128i c)
+{
+	__m128i a, k;
+
+	a = broadcast_component_sse2 (c, 3);
+	k = _mm_srli_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (a, _mm_set1_epi16 (3)),
+					   _mm_set1_epi16 (16)), 5);
+
+	/* the alpha component is clamped back to itself */
+	return _mm_min_epi16 (_mm_add_epi16 (_mm_add_epi16 (c, _mm_srli_epi16 (c, 3)), k), a);
+}
+
+static inline __m128i
+darken_sse2 (__m128i c, __m128i gray, __m128i keep)
+{
+	__m128i weighted, intensity;
+
+	weighted = _mm_mullo_epi16 (c, _mm_set_epi16 (0, 77, 150, 28, 0, 77, 150, 28));
+	intensity = _mm_add_epi16 (_mm_add_epi16 (broadcast_component_sse2 (weighted, 0),
+						  broadcast_component_sse2 (weighted, 1)),
+				   broadcast_component_sse2 (weighted, 2));
+	intensity = _mm_srli_epi16 (intensity, 8);
+
+	return _mm_add_epi16 (_mm_srli_epi16 (_mm_mullo_epi16 (gray, intensity), 8),
+			      _mm_srli_epi16 (_mm_mullo_epi16 (keep, c), 8));
+}
+
+static void
+spotlight_row_sse2 (guint32 *row, int n, guint32 alpha_mask)
+{
+	__m128i zero, mask, pixels;
+	int i;
+
+	zero = _mm_setzero_si128 ();
+	mask = _mm_set1_epi32 (alpha_mask);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		pixels = _mm_or_si128 (_mm_loadu_si128 ((__m128i *) (row + i)), mask);
+		pixels = _mm_packus_epi16 (spotlight_sse2 (_mm_unpacklo_epi8 (pixels, zero)),
+					   spotlight_sse2 (_mm_unpackhi_epi8 (pixels, zero)));
+		_mm_storeu_si128 ((__m128i *) (row + i), pixels);
+	}
+
+	spotlight_row_scalar (row + i, n - i, alpha_mask);
+}
+
+static void
+colorize_row_sse2 (guint32 *row, int n, guint32 alpha_mask, const guint16 *factors)
+{
+	__m128i zero, mask, multipliers, pixels, lo, hi;
+	int i;
+
+	zero = _mm_setzero_si128 ();
+	mask = _mm_set1_epi32 (alpha_mask);
+	multipliers = _mm_set_epi16 (256, factors[2], factors[1], factors[0],
+				     256, factors[2], factors[1], factors[0]);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		pixels = _mm_or_si128 (_mm_loadu_si128 ((__m128i *) (row + i)), mask);
+		lo = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (pixels, zero), multipliers), 8);
+		hi = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (pixels, zero), multipliers), 8);
+		_mm_storeu_si128 ((__m128i *) (row + i), _mm_packus_epi16 (lo, hi));
+	}
+
+	colorize_row_scalar (row + i, n - i, alpha_mask, factors);
+}
+
+static void
+darken_row_sse2 (guint32 *row, int n, guint32 alpha_mask, const guint16 *gray, const guint16 *keep)
+{
+	__m128i zero, mask, gray_vector, keep_vector, pixels;
+	int i;
+
+	zero = _mm_setzero_si128 ();
+	mask = _mm_set1_epi32 (alpha_mask);
+	gray_vector = set_components_sse2 (gray);
+	keep_vector = set_components_sse2 (keep);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		pixels = _mm_or_si128 (_mm_loadu_si128 ((__m128i *) (row + i)), mask);
+		pixels = _mm_packus_epi16 (darken_sse2 (_mm_unpacklo_epi8 (pixels, zero), gray_vector, keep_vector),
+					   darken_sse2 (_mm_unpackhi_epi8 (pixels, zero), gray_vector, keep_vector));
+		_mm_storeu_si128 ((__m128i *) (row + i), pixels);
+	}
+
+	darken_row_scalar (row + i, n - i, alpha_mask, gray, keep);
+}
+
+#endif /* EEL_HAVE_SSE2_KERNELS */
+
+#ifdef EEL_HAVE_AVX2_KERNELS
+
+#define AVX2_FUNCTION __attribute__ ((target ("avx2")))
+
+/* Same as the SSE2 versions; the AVX2 shuffle, unpack and pack
+ * instructions work on each 128-bit half separately, so the pixels end
+ * up in the same order.
+ */
+static inline AVX2_FUNCTION __m256i
+broadcast_component_avx2 (__m256i pixels, int component)
+{
+	switch (component) {
+	case 0:
+		return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (pixels, _MM_SHUFFLE (0, 0, 0, 0)), _MM_SHUFFLE (0, 0, 0, 0));
+	case 1:
+		return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (pixels, _MM_SHUFFLE (1, 1, 1, 1)), _MM_SHUFFLE (1, 1, 1, 1));
+	case 2:
+		return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (pixels, _MM_SHUFFLE (2, 2, 2, 2)), _MM_SHUFFLE (2, 2, 2, 2));
+	default:
+		return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (pixels, _MM_SHUFFLE (3, 3, 3, 3)), _MM_SHUFFLE (3, 3, 3, 3));
+	}
+}
+
+static inline AVX2_FUNCTION __m256i
+set_components_avx2 (const guint16 *components)
+{
+	return _mm256_set_epi16 (components[3], components[2], components[1], components[0],
+				 components[3], components[2], components[1], components[0],
+				 components[3], components[2], components[1], components[0],
+				 components[3], components[2], components[1], components[0]);
+}
+
+static inline AVX2_FUNCTION __m256i
+spotlight_avx2 (__m256i c)
+{
+	__m256i a, k;
+
+	a = broadcast_component_avx2 (c, 3);
+	k = _mm256_srli_epi16 (_mm256_add_epi16 (_mm256_mullo_epi16 (a, _mm256_set1_epi16 (3)),
+						 _mm256_set1_epi16 (16)), 5);
+
+	return _mm256_min_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (c, _mm256_srli_epi16 (c, 3)), k), a);
+}
+
+static inline AVX2_FUNCTION __m256i
+darken_avx2 (__m256i c, __m256i gray, __m256i keep)
+{
+	__m256i weighted, intensity;
+	const guint16 weights[4] = { 28, 150, 77, 0 };
+
+	weighted = _mm256_mullo_epi16 (c, set_components_avx2 (weights));
+	intensity = _mm256_add_epi16 (_mm256_add_epi16 (broadcast_component_avx2 (weighted, 0),
+							broadcast_component_avx2 (weighted, 1)),
+				      broadcast_component_avx2 (weighted, 2));
+	intensity = _mm256_srli_epi16 (intensity, 8);
+
+	return _mm256_add_epi16 (_mm256_srli_epi16 (_mm256_mullo_epi16 (gray, intensity), 8),
+				 _mm256_srli_epi16 (_mm256_mullo_epi16 (keep, c), 8));
+}
+
+static AVX2_FUNCTION void
+spotlight_row_avx2 (guint32 *row, int n, guint32 alpha_mask)
+{
+	__m256i zero, mask, pixels;
+	int i;
+
+	zero = _mm256_setzero_si256 ();
+	mask = _mm256_set1_epi32 (alpha_mask);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		pixels = _mm256_or_si256 (_mm256_loadu_si256 ((__m256i *) (row + i)), mask);
+		pixels = _mm256_packus_epi16 (spotlight_avx2 (_mm256_unpacklo_epi8 (pixels, zero)),
+					      spotlight_avx2 (_mm256_unpackhi_epi8 (pixels, zero)));
+		_mm256_storeu_si256 ((__m256i *) (row + i), pixels);
+	}
+
+	spotlight_row_sse2 (row + i, n - i, alpha_mask);
+}
+
+static AVX2_FUNCTION void
+colorize_row_avx2 (guint32 *row, int n, guint32 alpha_mask, const guint16 *factors)
+{
+	__m256i zero, mask, multipliers, pixels, lo, hi;
+	guint16 components[4];
+	int i;
+
+	zero = _mm256_setzero_si256 ();
+	mask = _mm256_set1_epi32 (alpha_mask);
+	components[0] = factors[0];
+	components[1] = factors[1];
+	components[2] = factors[2];
+	components[3] = 256;
+	multipliers = set_components_avx2 (components);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		pixels = _mm256_or_si256 (_mm256_loadu_si256 ((__m256i *) (row + i)), mask);
+		lo = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (pixels, zero), multipliers), 8);
+		hi = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (pixels, zero), multipliers), 8);
+		_mm256_storeu_si256 ((__m256i *) (row + i), _mm256_packus_epi16 (lo, hi));
+	}
+
+	colorize_row_sse2 (row + i, n - i, alpha_mask, factors);
+}
+
+static AVX2_FUNCTION void
+darken_row_avx2 (guint32 *row, int n, guint32 alpha_mask, const guint16 *gray, const guint16 *keep)
+{
+	__m256i zero, mask, gray_vector, keep_vector, pixels;
+	int i;
+
+	zero = _mm256_setzero_si256 ();
+	mask = _mm256_set1_epi32 (alpha_mask);
+	gray_vector = set_components_avx2 (gray);
+	keep_vector = set_components_avx2 (keep);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		pixels = _mm256_or_si256 (_mm256_loadu_si256 ((__m256i *) (row + i)), mask);
+		pixels = _mm256_packus_epi16 (darken_avx2 (_mm256_unpacklo_epi8 (pixels, zero), gray_vector, keep_vector),
+					      darken_avx2 (_mm256_unpackhi_epi8 (pixels, zero), gray_vector, keep_vector));
+		_mm256_storeu_si256 ((__m256i *) (row + i), pixels);
+	}
+
+	darken_row_sse2 (row + i, n - i, alpha_mask, gray, keep);
+}
+
+#endif /* EEL_HAVE_AVX2_KERNELS */
+
+typedef struct {
+	const char *name;
+	void (* spotlight) (guint32 *row, int n, guint32 alpha_mask);
+	void (* colorize) (guint32 *row, int n, guint32 alpha_mask, const guint16 *factors);
+	void (* darken) (guint32 *row, int n, guint32 alpha_mask, const guint16 *gray, const guint16 *keep);
+} PixelKernels;
+
+static const PixelKernels scalar_kernels = {
+	"scalar", spotlight_row_scalar, colorize_row_scalar, darken_row_scalar
+};
+
+#ifdef EEL_HAVE_SSE2_KERNELS
+static const PixelKernels sse2_kernels = {
+	"sse2", spotlight_row_sse2, colorize_row_sse2, darken_row_sse2
+};
+#endif
+
+#ifdef EEL_HAVE_AVX2_KERNELS
+static const PixelKernels avx2_kernels = {
+	"avx2", spotlight_row_avx2, colorize_row_avx2, darken_row_avx2
+};
+#endif
+
+/* Picks the fastest kernels the CPU supports. Setting EEL_PIXEL_KERNELS
+ * to "scalar" or "sse2" selects slower ones, for testing.
+ */
+static const PixelKernels *
+get_pixel_kernels (void)
+{
+	static const PixelKernels *kernels = NULL;
+	const char *requested;
+
+	if (kernels != NULL) {
+		return kernels;
+	}
+
+	requested = g_getenv ("EEL_PIXEL_KERNELS");
+	kernels = &scalar_kernels;
+
+	if (g_strcmp0 (requested, "scalar") != 0) {
+#ifdef EEL_HAVE_SSE2_KERNELS
+		kernels = &sse2_kernels;
+#endif
+#ifdef EEL_HAVE_AVX2_KERNELS
+		__builtin_cpu_init ();
+		if (g_strcmp0 (requested, "sse2") != 0 &&
+		    __builtin_cpu_supports ("avx2")) {
+			kernels = &avx2_kernels;
+		}
+#endif
+	}
+
+	return kernels;
+}
+
+const char *
+eel_graphic_effects_get_kernel_name (void)
+{
+	return get_pixel_kernels ()->name;
+}
+
+static gboolean
+surface_is_acceptable (cairo_surface_t *surface)
+{
+	return cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE
+		&& (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32
+		    || cairo_image_surface_get_format (surface) == CAIRO_FORMAT_RGB24);
+}
+
+typedef enum {
+	EFFECT_SPOTLIGHT,
+	EFFECT_COLORIZE,
+	EFFECT_DARKEN
+} Effect;
+
+static void
+apply_effect (cairo_surface_t *surface,
+	      Effect effect,
+	      const guint16 *factors,
+	      const guint16 *keep)
+{
+	const PixelKernels *kernels;
+	guchar *data;
+	guint32 alpha_mask;
+	int width, height, stride, y;
+
+	g_return_if_fail (surface_is_acceptable (surface));
+
+	kernels = get_pixel_kernels ();
+
+	cairo_surface_flush (surface);
+
+	data = cairo_image_surface_get_data (surface);
+	width = cairo_image_surface_get_width (surface);
+	height = cairo_image_surface_get_height (surface);
+	stride = cairo_image_surface_get_stride (surface);
+	alpha_mask = cairo_image_surface_get_format (surface) == CAIRO_FORMAT_RGB24 ? 0xff000000 : 0;
+
+	for (y = 0; y < height; y++) {
+		guint32 *row;
+
+		row = (guint32 *) (data + y * stride);
+		switch (effect) {
+		case EFFECT_SPOTLIGHT:
+			kernels->spotlight (row, width, alpha_mask);
+			break;
+		case EFFECT_COLORIZE:
+			kernels->colorize (row, width, alpha_mask, factors);
+			break;
+		case EFFECT_DARKEN:
+			kernels->darken (row, width, alpha_mask, factors, keep);
+			break;
+		}
+	}
+
+	cairo_surface_mark_dirty (surface);
+}
+
+void
+eel_spotlight_surface (cairo_surface_t *surface)
+{
+	apply_effect (surface, EFFECT_SPOTLIGHT, NULL, NULL);
+}
+
+void
+eel_darken_surface (cairo_surface_t *surface,
+		    int saturation,
+		    int darken)
+{
+	guint16 gray[4], keep[4];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		gray[i] = ((255 - saturation) * darken) >> 8;
+		keep[i] = (saturation * darken) >> 8;
+	}
+	/* leave alpha alone */
+	gray[3] = 0;
+	keep[3] = 256;
+
+	apply_effect (surface, EFFECT_DARKEN, gray, keep);
+}
+
+void
+eel_colorize_surface (cairo_surface_t *surface,
+		      GdkRGBA *color)
+{
+	guint16 factors[4];
+
+	factors[0] = eel_round (color->blue * 255);
+	factors[1] = eel_round (color->green * 255);
+	factors[2] = eel_round (color->red * 255);
+	factors[3] = 256;
+
+	apply_effect (surface, EFFECT_COLORIZE, factors, NULL);
+}
+
+/* Returns a new image surface with the same contents, format and device
+ * scale as the passed-in one, for applying effects to.
+ */
+cairo_surface_t *
+eel_copy_image_surface (cairo_surface_t *surface)
+{
+	cairo_surface_t *copy;
+	double x_scale, y_scale;
+	int height, stride;
+
+	g_return_val_if_fail (surface_is_acceptable (surface), NULL);
+
+	cairo_surface_flush (surface);
+
+	height = cairo_image_surface_get_height (surface);
+	copy = cairo_image_surface_create (cairo_image_surface_get_format (surface),
+					   cairo_image_surface_get_width (surface),
+					   height);
+	stride = cairo_image_surface_get_stride (surface);
+	g_assert (stride == cairo_image_surface_get_stride (copy));
+
+	memcpy (cairo_image_surface_get_data (copy),
+		cairo_image_surface_get_data (surface),
+		(gsize) stride * height);
+	cairo_surface_mark_dirty (copy);
+
+	cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+	cairo_surface_set_device_scale (copy, x_scale, y_scale);
+
+	return copy;
+}
+
 /* utility to stretch a frame to the desired size */
 
 static void
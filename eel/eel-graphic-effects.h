@@ -40,6 +40,22 @@ GdkPixbuf *eel_create_darkened_pixbuf  (GdkPixbuf *source_pixbuf,
 GdkPixbuf* eel_create_colorized_pixbuf (GdkPixbuf *source_pixbuf,
 					GdkRGBA *color);
 
+/* Versions of the above that change a premultiplied ARGB32 or RGB24
+ * image surface in place, using SIMD instructions where available.
+ */
+void       eel_spotlight_surface       (cairo_surface_t *surface);
+void       eel_darken_surface          (cairo_surface_t *surface,
+					int              saturation,
+					int              darken);
+void       eel_colorize_surface        (cairo_surface_t *surface,
+					GdkRGBA         *color);
+
+/* return a copy of an image surface to apply effects to */
+cairo_surface_t *eel_copy_image_surface (cairo_surface_t *surface);
+
+/* name of the pixel kernels in use: "scalar", "sse2" or "avx2" */
+const char *eel_graphic_effects_get_kernel_name (void);
+
 /* stretch a image frame */
 GdkPixbuf *eel_stretch_frame_image     (GdkPixbuf *frame_image,
 					int        left_offset,
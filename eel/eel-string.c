@@ -649,8 +649,55 @@ eel_strdup_printf_with_custom (EelPrintfHandler *handlers,
 
 /*********** refcounted strings ****************/
 
-G_LOCK_DEFINE_STATIC (unique_ref_strs);
-static GHashTable *unique_ref_strs = NULL;
+/* Unique strings are interned in a table split into shards, each with
+ * its own lock, so that threads creating files at the same time rarely
+ * wait for each other. Set EEL_REF_STR_SHARDS=1 to go back to a single
+ * table, e.g. to compare in benchmark-ref-str.
+ */
+#define REF_STR_MAX_SHARDS 64
+
+typedef struct {
+	GMutex lock;
+	GHashTable *table;
+} RefStrShard;
+
+static RefStrShard ref_str_shards[REF_STR_MAX_SHARDS];
+
+static guint
+get_n_shards (void)
+{
+	static gsize n_shards = 0;
+	const char *env;
+	gsize n, i;
+
+	if (g_once_init_enter (&n_shards)) {
+		n = REF_STR_MAX_SHARDS;
+		env = g_getenv ("EEL_REF_STR_SHARDS");
+		if (env != NULL) {
+			n = CLAMP (atoi (env), 1, REF_STR_MAX_SHARDS);
+			/* Round down to a power of two, so a mask picks the shard */
+			while (n & (n - 1)) {
+				n &= n - 1;
+			}
+		}
+
+		for (i = 0; i < n; i++) {
+			g_mutex_init (&ref_str_shards[i].lock);
+			ref_str_shards[i].table =
+				g_hash_table_new (g_str_hash, g_str_equal);
+		}
+
+		g_once_init_leave (&n_shards, n);
+	}
+
+	return n_shards;
+}
+
+static RefStrShard *
+get_shard (const char *string)
+{
+	return &ref_str_shards[g_str_hash (string) & (get_n_shards () - 1)];
+}
 
 static eel_ref_str
 eel_ref_str_new_internal (const char *string, int start_count)
@@ -681,27 +728,26 @@ eel_ref_str_new (const char *string)
 eel_ref_str
 eel_ref_str_get_unique (const char *string)
 {
+	RefStrShard *shard;
 	eel_ref_str res;
 
 	if (string == NULL) {
 		return NULL;
 	}
-	
-	G_LOCK (unique_ref_strs);
-	if (unique_ref_strs == NULL) {
-		unique_ref_strs =
-			g_hash_table_new (g_str_hash, g_str_equal);
-	}
 
-	res = g_hash_table_lookup (unique_ref_strs, string);
+	shard = get_shard (string);
+
+	g_mutex_lock (&shard->lock);
+
+	res = g_hash_table_lookup (shard->table, string);
 	if (res != NULL) {
 		eel_ref_str_ref (res);
 	} else {
 		res = eel_ref_str_new_internal (string, 0x80000001);
-		g_hash_table_insert (unique_ref_strs, res, res);
+		g_hash_table_insert (shard->table, res, res);
 	}
 	
-	G_UNLOCK (unique_ref_strs);
+	g_mutex_unlock (&shard->lock);
 
 	return res;
 }
@@ -720,6 +766,7 @@ eel_ref_str_ref (eel_ref_str str)
 void
 eel_ref_str_unref (eel_ref_str str)
 {
+	RefStrShard *shard;
 	volatile gint *count;
 	gint old_ref;
 
@@ -733,13 +780,14 @@ eel_ref_str_unref (eel_ref_str str)
 	if (old_ref == 1) {
 		g_free ((char *)count);
 	} else if (old_ref == 0x80000001) {
-		G_LOCK (unique_ref_strs);
+		shard = get_shard (str);
+		g_mutex_lock (&shard->lock);
 		/* Need to recheck after taking lock to avoid races with _get_unique() */
 		if (g_atomic_int_add (count, -1) == 0x80000001) {
-			g_hash_table_remove (unique_ref_strs, (char *)str);
+			g_hash_table_remove (shard->table, (char *)str);
 			g_free ((char *)count);
 		} 
-		G_UNLOCK (unique_ref_strs);
+		g_mutex_unlock (&shard->lock);
 	} else if (!g_atomic_int_compare_and_exchange (count,
 						       old_ref, old_ref - 1)) {
 		goto retry_atomic_decrement;
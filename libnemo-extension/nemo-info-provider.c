@@ -90,6 +90,41 @@ nemo_info_provider_cancel_update (NemoInfoProvider *provider,
 								    handle);
 }
 
+/**
+ * nemo_info_provider_can_update_batch:
+ * @provider: a #NemoInfoProvider
+ *
+ * Returns: %TRUE if @provider implements update_file_info_batch
+ */
+gboolean
+nemo_info_provider_can_update_batch (NemoInfoProvider *provider)
+{
+	g_return_val_if_fail (NEMO_IS_INFO_PROVIDER (provider), FALSE);
+
+	return NEMO_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch != NULL;
+}
+
+/**
+ * nemo_info_provider_update_file_info_batch:
+ * @provider: a #NemoInfoProvider
+ * @requests: (element-type NemoFileInfoRequest): the files to update
+ * @cancellable: (allow-none): a #GCancellable
+ *
+ * Fills in emblems and attributes for each of @requests. Blocks; Nemo
+ * calls this from a worker thread.
+ */
+void
+nemo_info_provider_update_file_info_batch (NemoInfoProvider *provider,
+					   GList *requests,
+					   GCancellable *cancellable)
+{
+	g_return_if_fail (NEMO_IS_INFO_PROVIDER (provider));
+	g_return_if_fail (NEMO_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch != NULL);
+
+	NEMO_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch
+		(provider, requests, cancellable);
+}
+
 void
 nemo_info_provider_update_complete_invoke (GClosure *update_complete,
 					       NemoInfoProvider *provider,
@@ -118,3 +153,151 @@ nemo_info_provider_update_complete_invoke (GClosure *update_complete,
 }
 
 					       
+
+struct _NemoFileInfoRequest {
+	volatile gint ref_count;
+
+	char *uri;
+	char *mime_type;
+
+	GList *emblems;
+	GHashTable *string_attributes;
+};
+
+GType
+nemo_file_info_request_get_type (void)
+{
+	static GType type = 0;
+
+	if (!type) {
+		type = g_boxed_type_register_static ("NemoFileInfoRequest",
+						     (GBoxedCopyFunc) nemo_file_info_request_ref,
+						     (GBoxedFreeFunc) nemo_file_info_request_unref);
+	}
+
+	return type;
+}
+
+/**
+ * nemo_file_info_request_new:
+ * @uri: the uri of the file
+ * @mime_type: (allow-none): its mime type
+ *
+ * Returns: (transfer full): a new #NemoFileInfoRequest
+ */
+NemoFileInfoRequest *
+nemo_file_info_request_new (const char *uri,
+			    const char *mime_type)
+{
+	NemoFileInfoRequest *request;
+
+	request = g_new0 (NemoFileInfoRequest, 1);
+	request->ref_count = 1;
+	request->uri = g_strdup (uri);
+	request->mime_type = g_strdup (mime_type);
+
+	return request;
+}
+
+NemoFileInfoRequest *
+nemo_file_info_request_ref (NemoFileInfoRequest *request)
+{
+	g_return_val_if_fail (request != NULL, NULL);
+
+	g_atomic_int_inc (&request->ref_count);
+
+	return request;
+}
+
+void
+nemo_file_info_request_unref (NemoFileInfoRequest *request)
+{
+	g_return_if_fail (request != NULL);
+
+	if (!g_atomic_int_dec_and_test (&request->ref_count)) {
+		return;
+	}
+
+	g_free (request->uri);
+	g_free (request->mime_type);
+	g_list_free_full (request->emblems, g_free);
+	if (request->string_attributes != NULL) {
+		g_hash_table_destroy (request->string_attributes);
+	}
+	g_free (request);
+}
+
+const char *
+nemo_file_info_request_get_uri (NemoFileInfoRequest *request)
+{
+	g_return_val_if_fail (request != NULL, NULL);
+
+	return request->uri;
+}
+
+const char *
+nemo_file_info_request_get_mime_type (NemoFileInfoRequest *request)
+{
+	g_return_val_if_fail (request != NULL, NULL);
+
+	return request->mime_type;
+}
+
+void
+nemo_file_info_request_add_emblem (NemoFileInfoRequest *request,
+				   const char *emblem_name)
+{
+	g_return_if_fail (request != NULL);
+	g_return_if_fail (emblem_name != NULL);
+
+	request->emblems = g_list_prepend (request->emblems,
+					   g_strdup (emblem_name));
+}
+
+void
+nemo_file_info_request_add_string_attribute (NemoFileInfoRequest *request,
+					     const char *attribute_name,
+					     const char *value)
+{
+	g_return_if_fail (request != NULL);
+	g_return_if_fail (attribute_name != NULL);
+	g_return_if_fail (value != NULL);
+
+	if (request->string_attributes == NULL) {
+		request->string_attributes =
+			g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, g_free);
+	}
+
+	g_hash_table_insert (request->string_attributes,
+			     g_strdup (attribute_name), g_strdup (value));
+}
+
+/**
+ * nemo_file_info_request_get_emblems:
+ * @request: a #NemoFileInfoRequest
+ *
+ * Returns: (element-type utf8) (transfer none): the emblems added so far
+ */
+GList *
+nemo_file_info_request_get_emblems (NemoFileInfoRequest *request)
+{
+	g_return_val_if_fail (request != NULL, NULL);
+
+	return request->emblems;
+}
+
+/**
+ * nemo_file_info_request_get_string_attributes:
+ * @request: a #NemoFileInfoRequest
+ *
+ * Returns: (element-type utf8 utf8) (transfer none) (allow-none): the
+ * attributes added so far, or %NULL if there are none
+ */
+GHashTable *
+nemo_file_info_request_get_string_attributes (NemoFileInfoRequest *request)
+{
+	g_return_val_if_fail (request != NULL, NULL);
+
+	return request->string_attributes;
+}
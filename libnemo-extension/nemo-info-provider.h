@@ -25,12 +25,19 @@
 /* This interface is implemented by Nemo extensions that want to 
  * provide information about files.  Extensions are called when Nemo 
  * needs information about a file.  They are passed a NemoFileInfo 
- * object which should be filled with relevant information */
+ * object which should be filled with relevant information.
+ *
+ * Extensions that can answer for many files at once more cheaply (for
+ * example by asking a version control system about a whole folder)
+ * can also implement update_file_info_batch. Nemo then calls it from
+ * a worker thread with a NemoFileInfoRequest for each of a slice of
+ * files, instead of calling update_file_info for each file. */
 
 #ifndef NEMO_INFO_PROVIDER_H
 #define NEMO_INFO_PROVIDER_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include "nemo-extension-types.h"
 #include "nemo-file-info.h"
 
@@ -41,8 +48,11 @@ G_BEGIN_DECLS
 #define NEMO_IS_INFO_PROVIDER(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NEMO_TYPE_INFO_PROVIDER))
 #define NEMO_INFO_PROVIDER_GET_IFACE(obj) (G_TYPE_INSTANCE_GET_INTERFACE ((obj), NEMO_TYPE_INFO_PROVIDER, NemoInfoProviderIface))
 
+#define NEMO_TYPE_FILE_INFO_REQUEST       (nemo_file_info_request_get_type ())
+
 typedef struct _NemoInfoProvider       NemoInfoProvider;
 typedef struct _NemoInfoProviderIface  NemoInfoProviderIface;
+typedef struct _NemoFileInfoRequest    NemoFileInfoRequest;
 
 typedef void (*NemoInfoProviderUpdateComplete) (NemoInfoProvider    *provider,
 						    NemoOperationHandle *handle,
@@ -58,6 +68,11 @@ struct _NemoInfoProviderIface {
 						     NemoOperationHandle **handle);
 	void                    (*cancel_update)    (NemoInfoProvider     *provider,
 						     NemoOperationHandle  *handle);
+
+	/* Optional. Called in a worker thread; may block. */
+	void                    (*update_file_info_batch) (NemoInfoProvider *provider,
+							   GList            *requests,
+							   GCancellable     *cancellable);
 };
 
 /* Interface Functions */
@@ -68,6 +83,30 @@ NemoOperationResult nemo_info_provider_update_file_info       (NemoInfoProvider
 								       NemoOperationHandle **handle);
 void                    nemo_info_provider_cancel_update          (NemoInfoProvider     *provider,
 								       NemoOperationHandle  *handle);
+gboolean                nemo_info_provider_can_update_batch       (NemoInfoProvider     *provider);
+void                    nemo_info_provider_update_file_info_batch (NemoInfoProvider     *provider,
+								       GList                    *requests,
+								       GCancellable             *cancellable);
+
+/* A file handed to update_file_info_batch. Unlike NemoFileInfo it may
+ * be used from the worker thread, but only from that thread until
+ * update_file_info_batch returns. */
+GType                   nemo_file_info_request_get_type           (void);
+NemoFileInfoRequest *   nemo_file_info_request_new                (const char               *uri,
+								       const char               *mime_type);
+NemoFileInfoRequest *   nemo_file_info_request_ref                (NemoFileInfoRequest      *request);
+void                    nemo_file_info_request_unref              (NemoFileInfoRequest      *request);
+const char *            nemo_file_info_request_get_uri            (NemoFileInfoRequest      *request);
+const char *            nemo_file_info_request_get_mime_type      (NemoFileInfoRequest      *request);
+void                    nemo_file_info_request_add_emblem         (NemoFileInfoRequest      *request,
+								       const char               *emblem_name);
+void                    nemo_file_info_request_add_string_attribute (NemoFileInfoRequest    *request,
+								       const char               *attribute_name,
+								       const char               *value);
+
+/* Used by Nemo to apply the answers */
+GList *                 nemo_file_info_request_get_emblems        (NemoFileInfoRequest      *request);
+GHashTable *            nemo_file_info_request_get_string_attributes (NemoFileInfoRequest   *request);
 
 
 
@@ -20,6 +20,8 @@
 #include "nemo-action.h"
 #include <eel/eel-string.h>
 #include <glib/gi18n.h>
+#include <string.h>
+#include "nemo-file-private.h"
 #include "nemo-file-utilities.h"
 
 #define DEBUG_FLAG NEMO_DEBUG_ACTIONS
@@ -46,6 +48,10 @@ static void     nemo_action_constructed (GObject *object);
 
 static void     nemo_action_finalize (GObject *gobject);
 
+static GList   *compile_conditions (gchar **conditions);
+static void     action_condition_free (gpointer data);
+static void     compile_extensions (NemoAction *action);
+
 static gpointer parent_class;
 
 #define ACTION_FILE_GROUP "Nemo Action"
@@ -113,6 +119,9 @@ nemo_action_init (NemoAction *action)
     action->quote_type = QUOTE_TYPE_NONE;
     action->separator = NULL;
     action->conditions = NULL;
+    action->compiled_conditions = NULL;
+    action->lowered_extensions = NULL;
+    action->extension_flags = 0;
     action->dbus = NULL;
     action->dbus_satisfied = TRUE;
     action->escape_underscores = FALSE;
@@ -617,6 +626,8 @@ nemo_action_finalize (GObject *object)
     g_strfreev (action->extensions);
     g_strfreev (action->mimetypes);
     g_strfreev (action->conditions);
+    g_list_free_full (action->compiled_conditions, action_condition_free);
+    g_strfreev (action->lowered_extensions);
     g_free (action->exec);
     g_free (action->parent_dir);
     g_free (action->orig_label);
@@ -1093,6 +1104,9 @@ nemo_action_set_conditions (NemoAction *action, gchar **conditions)
     tmp = action->conditions;
     action->conditions = g_strdupv (conditions);
     g_strfreev (tmp);
+
+    g_list_free_full (action->compiled_conditions, action_condition_free);
+    action->compiled_conditions = compile_conditions (action->conditions);
 }
 
 void
@@ -1187,6 +1201,8 @@ nemo_action_set_extensions (NemoAction *action, gchar **extensions)
     tmp = action->extensions;
     action->extensions = g_strdupv (extensions);
     g_strfreev (tmp);
+
+    compile_extensions (action);
 }
 
 void
@@ -1242,86 +1258,290 @@ try_vector (const gchar *op, gint vector)
     }
 }
 
+/* Conditions are parsed once, when they are set, rather than each time
+ * the visibility is checked. gsettings conditions keep their GSettings
+ * and are re-evaluated only when the key changes.
+ */
+typedef enum {
+    CONDITION_DESKTOP,
+    CONDITION_REMOVABLE,
+    CONDITION_GSETTINGS
+} ConditionType;
+
+typedef struct {
+    ConditionType type;
+    gboolean satisfied;
+
+    /* CONDITION_GSETTINGS; settings is NULL if the schema or key
+     * doesn't exist, target is NULL for a plain boolean key.
+     */
+    GSettings *settings;
+    gchar *key;
+    gchar *op;
+    GVariant *target;
+} ActionCondition;
+
+static void
+action_condition_free (gpointer data)
+{
+    ActionCondition *cond = data;
+
+    if (cond->settings != NULL) {
+        g_signal_handlers_disconnect_matched (cond->settings, G_SIGNAL_MATCH_DATA,
+                                              0, 0, NULL, NULL, cond);
+        g_object_unref (cond->settings);
+    }
+
+    if (cond->target != NULL) {
+        g_variant_unref (cond->target);
+    }
+
+    g_free (cond->key);
+    g_free (cond->op);
+    g_slice_free (ActionCondition, cond);
+}
+
+static void
+update_gsettings_condition (ActionCondition *cond)
+{
+    GVariant *setting_var;
+
+    cond->satisfied = FALSE;
+
+    setting_var = g_settings_get_value (cond->settings, cond->key);
+
+    if (cond->target == NULL) {
+        if (g_variant_is_of_type (setting_var, G_VARIANT_TYPE_BOOLEAN))
+            cond->satisfied = g_variant_get_boolean (setting_var);
+    } else if (g_variant_is_of_type (setting_var, g_variant_get_type (cond->target))) {
+        cond->satisfied = try_vector (cond->op, g_variant_compare (setting_var, cond->target));
+    }
+
+    g_variant_unref (setting_var);
+}
+
+static void
+on_gsettings_condition_changed (GSettings   *settings,
+                                const gchar *key,
+                                gpointer     user_data)
+{
+    update_gsettings_condition (user_data);
+}
+
 static gboolean
-check_gsettings_condition (NemoAction *action, const gchar *condition)
+key_exists (GSettings *settings, const gchar *key)
 {
+    gchar **keys = g_settings_list_keys (settings);
+    gboolean ret = FALSE;
+    gint i;
+
+    for (i = 0; keys[i] != NULL && !ret; i++)
+        ret = g_strcmp0 (keys[i], key) == 0;
 
+    g_strfreev (keys);
+    return ret;
+}
+
+static ActionCondition *
+compile_gsettings_condition (const gchar *condition)
+{
     gchar **split = g_strsplit (condition, " ", 6);
     gint len = g_strv_length (split);
 
     if (len != 6 && 
         len != 3) {
         g_strfreev (split);
-        return FALSE;
+        return NULL;
     }
 
     if (g_strcmp0 (split[0], "gsettings") != 0) {
         g_strfreev (split);
-        return FALSE;
+        return NULL;
     }
 
+    ActionCondition *cond = g_slice_new0 (ActionCondition);
+    cond->type = CONDITION_GSETTINGS;
+
     if (len == 6 &&
         (!g_variant_type_string_is_valid (split[GSETTINGS_TYPE_INDEX]) || 
          !operator_is_valid (split[GSETTINGS_OP_INDEX]))) {
         g_printerr ("Nemo Action: Either gsettings variant type (%s) or operator (%s) is invalid.\n",
                     split[GSETTINGS_TYPE_INDEX], split[GSETTINGS_OP_INDEX]);
         g_strfreev (split);
-        return FALSE;
+        return cond;
     }
 
-    GSettingsSchemaSource *schema_source;
-    gboolean ret = FALSE;
-    const GVariantType *target_type;
+    if (len == 6) {
+        cond->target = g_variant_parse (G_VARIANT_TYPE (split[GSETTINGS_TYPE_INDEX]),
+                                        split[GSETTINGS_VAL_INDEX],
+                                        NULL, NULL, NULL);
+        if (cond->target == NULL) {
+            g_printerr ("Nemo Action: gsettings value could not be parsed into a valid GVariant\n");
+            g_strfreev (split);
+            return cond;
+        }
+        g_variant_ref_sink (cond->target);
+        cond->op = g_strdup (split[GSETTINGS_OP_INDEX]);
+    }
 
-    if (len == 3) {
-        target_type = G_VARIANT_TYPE_BOOLEAN;
-    } else {
-        target_type = G_VARIANT_TYPE (split[GSETTINGS_TYPE_INDEX]);
+    GSettingsSchemaSource *schema_source = g_settings_schema_source_get_default ();
+    GSettingsSchema *schema = g_settings_schema_source_lookup (schema_source,
+                                                               split[GSETTINGS_SCHEMA_INDEX],
+                                                               TRUE);
+
+    if (schema != NULL) {
+        GSettings *settings = g_settings_new (split[GSETTINGS_SCHEMA_INDEX]);
+
+        if (key_exists (settings, split[GSETTINGS_KEY_INDEX])) {
+            gchar *signal = g_strconcat ("changed::", split[GSETTINGS_KEY_INDEX], NULL);
+
+            cond->settings = settings;
+            cond->key = g_strdup (split[GSETTINGS_KEY_INDEX]);
+            g_signal_connect (settings, signal,
+                              G_CALLBACK (on_gsettings_condition_changed), cond);
+            g_free (signal);
+
+            /* Also makes sure we get change notification for the key */
+            update_gsettings_condition (cond);
+        } else {
+            g_object_unref (settings);
+        }
+
+        g_settings_schema_unref (schema);
     }
 
-    schema_source = g_settings_schema_source_get_default();
-
-    if (g_settings_schema_source_lookup (schema_source, split[GSETTINGS_SCHEMA_INDEX], TRUE)) {
-        GSettings *s = g_settings_new (split[GSETTINGS_SCHEMA_INDEX]);
-        gchar **keys = g_settings_list_keys (s);
-        gint i;
-        for (i = 0; i < g_strv_length (keys); i++) {
-            if (len == 3) {
-                if (g_strcmp0 (keys[i], split[GSETTINGS_KEY_INDEX]) == 0) {
-                    GVariant *setting_var = g_settings_get_value (s, split[GSETTINGS_KEY_INDEX]);
-                    const GVariantType *setting_type = g_variant_get_type (setting_var);
-                    if (g_variant_type_equal (setting_type, target_type))
-                        ret = g_variant_get_boolean (setting_var);
-                    g_variant_unref (setting_var);
-                }
-            } else {
-                if (g_strcmp0 (keys[i], split[GSETTINGS_KEY_INDEX]) == 0) {
-                    GVariant *setting_var = g_settings_get_value (s, split[GSETTINGS_KEY_INDEX]);
-                    const GVariantType *setting_type = g_variant_get_type (setting_var);
-                    if (g_variant_type_equal (setting_type, target_type)) {
-                        GVariant *target_var = g_variant_parse (target_type,
-                                                                split[GSETTINGS_VAL_INDEX],
-                                                                NULL, NULL, NULL);
-                        if (target_var != NULL) {
-                            gint vector = g_variant_compare (setting_var, target_var);
-                            ret = try_vector (split[GSETTINGS_OP_INDEX], vector);
-                            g_variant_unref (target_var);
-                        } else {
-                            g_printerr ("Nemo Action: gsettings value could not be parsed into a valid GVariant\n");
+    g_strfreev (split);
+    return cond;
+}
+
+static GList *
+compile_conditions (gchar **conditions)
+{
+    GList *compiled = NULL;
+    ActionCondition *cond;
+    gint i;
+
+    for (i = 0; conditions != NULL && conditions[i] != NULL; i++) {
+        cond = NULL;
+
+        if (g_strcmp0 (conditions[i], "desktop") == 0) {
+            cond = g_slice_new0 (ActionCondition);
+            cond->type = CONDITION_DESKTOP;
+        } else if (g_strcmp0 (conditions[i], "removable") == 0) {
+            cond = g_slice_new0 (ActionCondition);
+            cond->type = CONDITION_REMOVABLE;
+        } else if (g_str_has_prefix (conditions[i], "gsettings")) {
+            cond = compile_gsettings_condition (conditions[i]);
+            /* A malformed condition is never satisfied */
+            if (cond == NULL) {
+                cond = g_slice_new0 (ActionCondition);
+                cond->type = CONDITION_GSETTINGS;
+            }
+        }
+
+        if (cond != NULL)
+            compiled = g_list_prepend (compiled, cond);
+    }
+
+    return g_list_reverse (compiled);
+}
+
+static gboolean
+check_conditions (NemoAction *action, GList *selection, NemoFile *parent)
+{
+    GList *l;
+    ActionCondition *cond;
+
+    for (l = action->compiled_conditions; l != NULL; l = l->next) {
+        cond = l->data;
+
+        switch (cond->type) {
+            case CONDITION_DESKTOP: {
+                gchar *name = nemo_file_get_display_name (parent);
+                gboolean is_desktop = g_strcmp0 (name, "x-nemo-desktop") == 0;
+                g_free (name);
+                if (!is_desktop)
+                    return FALSE;
+                break;
+            }
+            case CONDITION_REMOVABLE: {
+                gboolean is_removable = FALSE;
+                if (selection != NULL) {
+                    GMount *mount = nemo_file_get_mount (selection->data);
+                    if (mount) {
+                        GDrive *drive = g_mount_get_drive (mount);
+                        if (drive) {
+                            if (g_drive_is_media_removable (drive))
+                                is_removable = TRUE;
+                            g_object_unref (drive);
                         }
                     }
-                    g_variant_unref (setting_var);
                 }
+                if (!is_removable)
+                    return FALSE;
+                break;
             }
+            case CONDITION_GSETTINGS:
+                if (!cond->satisfied)
+                    return FALSE;
+                break;
+            default:
+                break;
         }
-        g_strfreev (keys);
-        g_object_unref (s);
-        g_strfreev (split);
-        return ret;
-    } else {
-        g_strfreev (split);
-        return FALSE;
     }
+
+    return TRUE;
+}
+
+enum {
+    EXTENSION_MATCH_ANY = 1 << 0,
+    EXTENSION_MATCH_DIR = 1 << 1,
+    EXTENSION_MATCH_NODIRS = 1 << 2,
+    EXTENSION_MATCH_NONE = 1 << 3
+};
+
+/* Splits the Extensions list into the special keywords and the
+ * lower-cased suffixes to match file names against.
+ */
+static void
+compile_extensions (NemoAction *action)
+{
+    GPtrArray *suffixes;
+    gint i;
+
+    g_strfreev (action->lowered_extensions);
+    action->extension_flags = 0;
+
+    suffixes = g_ptr_array_new ();
+
+    for (i = 0; action->extensions != NULL && action->extensions[i] != NULL; i++) {
+        if (g_strcmp0 (action->extensions[i], "dir") == 0) {
+            action->extension_flags |= EXTENSION_MATCH_DIR;
+        } else if (g_strcmp0 (action->extensions[i], "none") == 0) {
+            action->extension_flags |= EXTENSION_MATCH_NONE;
+        } else if (g_strcmp0 (action->extensions[i], "nodirs") == 0) {
+            action->extension_flags |= EXTENSION_MATCH_NODIRS;
+        } else {
+            g_ptr_array_add (suffixes, g_ascii_strdown (action->extensions[i], -1));
+        }
+    }
+
+    if (i == 1 && g_strcmp0 (action->extensions[0], "any") == 0)
+        action->extension_flags |= EXTENSION_MATCH_ANY;
+
+    g_ptr_array_add (suffixes, NULL);
+    action->lowered_extensions = (gchar **) g_ptr_array_free (suffixes, FALSE);
+}
+
+static gboolean
+has_suffix_ignoring_case (const gchar *name, gsize name_len, const gchar *lowered_suffix)
+{
+    gsize suffix_len = strlen (lowered_suffix);
+
+    if (suffix_len > name_len)
+        return FALSE;
+
+    return g_ascii_strcasecmp (name + name_len - suffix_len, lowered_suffix) == 0;
 }
 
 static gboolean
@@ -1332,9 +1552,76 @@ get_is_dir_hack (NemoFile *file)
     GFile *f = nemo_file_get_location (file);
     GFileType type = g_file_query_file_type (f, 0, NULL);
     ret = type == G_FILE_TYPE_DIRECTORY;
+    g_object_unref (f);
     return ret;
 }
 
+static gboolean
+extensions_match (NemoAction *action, NemoFile *file)
+{
+    const gchar *name = eel_ref_str_peek (file->details->name);
+    gsize name_len = strlen (name);
+    gint i;
+
+    for (i = 0; action->lowered_extensions[i] != NULL; i++) {
+        if (has_suffix_ignoring_case (name, name_len, action->lowered_extensions[i]))
+            return TRUE;
+    }
+
+    if ((action->extension_flags & EXTENSION_MATCH_NONE) &&
+        strchr (name, '.') == NULL)
+        return TRUE;
+
+    /* Only ask the file system if it can make a difference */
+    if (action->extension_flags & (EXTENSION_MATCH_DIR | EXTENSION_MATCH_NODIRS)) {
+        gboolean is_dir = get_is_dir_hack (file);
+
+        if (is_dir && (action->extension_flags & EXTENSION_MATCH_DIR))
+            return TRUE;
+        if (!is_dir && (action->extension_flags & EXTENSION_MATCH_NODIRS))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+enum {
+    MIME_CLASS_MATCHES = 1 << 0,
+    MIME_CLASS_IS_LINK = 1 << 1
+};
+
+/* What the action thinks of a mime type, worked out once per distinct
+ * type in the selection. Mime types are interned, so the pointer is
+ * the key.
+ */
+static guint
+get_mime_class (NemoAction *action, NemoFile *file, GHashTable *classes)
+{
+    const gchar *mime_type = eel_ref_str_peek (file->details->mime_type);
+    gpointer value;
+    guint mime_class = 0;
+    gint i;
+
+    if (g_hash_table_lookup_extended (classes, mime_type, NULL, &value))
+        return GPOINTER_TO_UINT (value);
+
+    if (mime_type != NULL) {
+        for (i = 0; action->mimetypes != NULL && action->mimetypes[i] != NULL; i++) {
+            if (g_content_type_is_a (mime_type, action->mimetypes[i])) {
+                mime_class |= MIME_CLASS_MATCHES;
+                break;
+            }
+        }
+
+        if (g_content_type_is_a (mime_type, "application/x-nemo-link"))
+            mime_class |= MIME_CLASS_IS_LINK;
+    }
+
+    g_hash_table_insert (classes, (gpointer) mime_type, GUINT_TO_POINTER (mime_class));
+
+    return mime_class;
+}
+
 gboolean
 nemo_action_get_visibility (NemoAction *action, GList *selection, NemoFile *parent)
 {
@@ -1348,41 +1635,7 @@ nemo_action_get_visibility (NemoAction *action, GList *selection, NemoFile *pare
     if (!nemo_action_get_dbus_satisfied (action))
         goto out;
 
-    gchar **conditions = nemo_action_get_conditions (action);
-
-    guint condition_count = conditions != NULL ? g_strv_length (conditions) : 0;
-
-    if (condition_count > 0) {
-        int j;
-        gchar *condition;
-        for (j = 0; j < condition_count; j++) {
-            condition = conditions[j];
-            if (g_strcmp0 (condition, "desktop") == 0) {
-                gchar *name = nemo_file_get_display_name (parent);
-                if (g_strcmp0 (name, "x-nemo-desktop") != 0)
-                    condition_type_show = FALSE;
-                g_free (name);
-            } else if (g_strcmp0 (condition, "removable") == 0) {
-                gboolean is_removable = FALSE;
-                if (g_list_length (selection) > 0) {
-                    GMount *mount = nemo_file_get_mount (selection->data);
-                    if (mount) {
-                        GDrive *drive = g_mount_get_drive (mount);
-                        if (drive) {
-                            if (g_drive_is_media_removable (drive))
-                                is_removable = TRUE;
-                            g_object_unref (drive);
-                        }
-                    }
-                }
-                condition_type_show = is_removable;
-            } else if (g_str_has_prefix (condition, "gsettings")) {
-                condition_type_show = check_gsettings_condition (action, condition);
-            }
-            if (!condition_type_show)
-                break;
-        }
-    }
+    condition_type_show = check_conditions (action, selection, parent);
 
     if (!condition_type_show)
         goto out;
@@ -1413,71 +1666,27 @@ nemo_action_get_visibility (NemoAction *action, GList *selection, NemoFile *pare
             break;
     }
 
-    gchar **extensions = nemo_action_get_extension_list (action);
-    gchar **mimetypes = nemo_action_get_mimetypes_list (action);
-
-    guint ext_count = extensions != NULL ? g_strv_length (extensions) : 0;
-    guint mime_count = mimetypes != NULL ? g_strv_length (mimetypes) : 0;
-
-    if (ext_count == 1 && g_strcmp0 (extensions[0], "any") == 0)
+    if (action->extension_flags & EXTENSION_MATCH_ANY)
         goto out;
 
+    gboolean has_extensions = action->extensions != NULL && action->extensions[0] != NULL;
     gboolean found_match = TRUE;
+    GHashTable *mime_classes = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     for (iter = selection; iter != NULL && found_match; iter = iter->next) {
-        found_match = FALSE;
-        gchar *raw_fn = nemo_file_get_name (NEMO_FILE (iter->data));
-        gchar *filename = g_ascii_strdown (raw_fn, -1);
-        g_free (raw_fn);
-        int i;
-        gboolean is_dir = get_is_dir_hack (iter->data);
-        if (ext_count > 0) {
-            for (i = 0; i < ext_count; i++) {
-                if (g_strcmp0 (extensions[i], "dir") == 0) {
-                    if (is_dir) {
-                        found_match = TRUE;
-                        break;
-                    }
-                } else if (g_strcmp0 (extensions[i], "none") == 0) {
-                    if (g_strrstr (filename, ".") == NULL) {
-                        found_match = TRUE;
-                        break;
-                    }
-                } else if (g_strcmp0 (extensions[i], "nodirs") == 0) {
-                    if (!is_dir) {
-                        found_match = TRUE;
-                        break;
-                    }
-                } else {
-                    gchar *str = g_ascii_strdown (extensions[i], -1);
-                    if (g_str_has_suffix (filename, str)) {
-                        found_match = TRUE;
-                    }
+        NemoFile *file = NEMO_FILE (iter->data);
+        guint mime_class = get_mime_class (action, file, mime_classes);
 
-                    g_free (str);
+        found_match = (mime_class & MIME_CLASS_MATCHES) ||
+                      (has_extensions && extensions_match (action, file));
 
-                    if (found_match) {
-                        break;
-                    }
-                }
-            }
-            g_free (filename);
-        }
-
-        if (mime_count > 0) {
-            for (i = 0; i < mime_count; i++) {
-                if (nemo_file_is_mime_type (NEMO_FILE (iter->data), mimetypes[i])) {
-                    found_match = TRUE;
-                    break;
-                }
-            }
-        }
-
-        if (nemo_file_is_mime_type (NEMO_FILE (iter->data), "application/x-nemo-link")) {
+        if (mime_class & MIME_CLASS_IS_LINK) {
             found_match = FALSE;
         }
     }
 
+    g_hash_table_destroy (mime_classes);
+
     extension_type_show = found_match;
 
 out:
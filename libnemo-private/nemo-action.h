@@ -89,6 +89,9 @@ struct _NemoAction {
     gchar *exec;
     gchar *parent_dir;
     gchar **conditions;
+    GList *compiled_conditions;
+    gchar **lowered_extensions;
+    guint extension_flags;
     gchar *separator;
     QuoteType quote_type;
     gchar *orig_label;
@@ -51,6 +51,8 @@ static GDebugKey keys[] = {
   { "Window", NEMO_DEBUG_WINDOW },
   { "Undo", NEMO_DEBUG_UNDO },
   { "Actions", NEMO_DEBUG_ACTIONS },
+  { "FileChanges", NEMO_DEBUG_FILE_CHANGES },
+  { "Extensions", NEMO_DEBUG_EXTENSIONS },
   { 0, }
 };
 
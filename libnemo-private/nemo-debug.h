@@ -47,7 +47,9 @@ typedef enum {
   NEMO_DEBUG_SMCLIENT = 1 << 12,
   NEMO_DEBUG_WINDOW = 1 << 13,
   NEMO_DEBUG_UNDO = 1 << 14,
-  NEMO_DEBUG_ACTIONS = 1 << 15
+  NEMO_DEBUG_ACTIONS = 1 << 15,
+  NEMO_DEBUG_FILE_CHANGES = 1 << 16,
+  NEMO_DEBUG_EXTENSIONS = 1 << 17
 } DebugFlags;
 
 void nemo_debug_set_flags (DebugFlags flags);
@@ -22,6 +22,7 @@
  * Authors: Cosimo Cecchi <cosimoc@redhat.com>
  */
 
+
 #include <config.h>
 
 #include "nemo-desktop-metadata.h"
@@ -34,9 +35,85 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
 
-static guint save_in_idle_source_id = 0;
+/* Desktop icon metadata is kept in a log of binary records, one per set
+ * or unset key, in the host's byte order:
+ *
+ *   guint32 length of the rest of the record
+ *   guint8  record type
+ *   guint32 name length, guint32 key length, guint32 number of values
+ *   name, key
+ *   for each value: guint32 length, bytes
+ *
+ * The file is memory-mapped when first needed and indexed by file name
+ * and key, later records replacing earlier ones. Changes are appended to
+ * the file in an idle callback. Once most of the file is made up of
+ * replaced records, it is rewritten with only the current values, in the
+ * background.
+ *
+ * The keyfile used before is imported the first time the store is
+ * created.
+ */
+
+#define STORE_MAGIC "NEMODM\0\1"
+#define STORE_MAGIC_LENGTH 8
+
+/* Don't bother compacting files smaller than this */
+#define STORE_COMPACT_MIN_SIZE (64 * 1024)
+
+/* How long to wait before trying again to write a new or damaged file */
+#define STORE_REWRITE_RETRY_SEC 30
+
+typedef enum {
+	RECORD_STRING = 1,
+	RECORD_STRINGV,
+	RECORD_UNSET
+} RecordType;
+
+typedef struct {
+	RecordType type;
+	/* Values read from the mapped file, decoded on use... */
+	const char *mapped_values;
+	guint32 n_values;
+	/* ...or set since the file was loaded. */
+	char **values;
+	/* Size of the record in the file, so the store knows how much
+	 * of the file is replaced records.
+	 */
+	gsize record_size;
+	/* Size of the record in the file being written by a compaction,
+	 * 0 if it isn't in it. Only becomes record_size if that works.
+	 */
+	gsize compacted_record_size;
+} MetadataEntry;
+
+typedef struct {
+	/* file name -> key -> MetadataEntry */
+	GHashTable *names;
+	GMappedFile *mapped_file;
+
+	GByteArray *pending_records;
+	guint save_in_idle_source_id;
+
+	gsize file_size;
+	gsize replaced_size;
+	/* Contents being written by a compaction, NULL if none */
+	GByteArray *compacted_contents;
+	/* What the file had before the compaction, put back if it fails */
+	GByteArray *compacted_records;
+	gsize compacted_file_size;
+	gsize compacted_replaced_size;
+	/* Set once a compaction failed; later saves only append */
+	gboolean compact_failed;
+	/* Set while the file on disk is missing or damaged. Records can't
+	 * be appended to it, so saves rewrite it until that works.
+	 */
+	gboolean needs_rewrite;
+} MetadataStore;
 
 static gchar *
 get_keyfile_path (void)
@@ -51,241 +128,679 @@ get_keyfile_path (void)
 	return retval;
 }
 
+static gchar *
+get_store_path (void)
+{
+	gchar *xdg_dir, *retval;
+
+	xdg_dir = nemo_get_user_directory ();
+	retval = g_build_filename (xdg_dir, "desktop-metadata-store", NULL);
+
+	g_free (xdg_dir);
+
+	return retval;
+}
+
+static void
+metadata_entry_free (MetadataEntry *entry)
+{
+	g_strfreev (entry->values);
+	g_free (entry);
+}
+
+static void
+append_uint32 (GByteArray *buffer, guint32 value)
+{
+	g_byte_array_append (buffer, (guint8 *) &value, sizeof (value));
+}
+
+static gsize
+append_record (GByteArray *buffer,
+	       const char *name,
+	       const char *key,
+	       RecordType type,
+	       const char * const *values)
+{
+	guint start, length_offset, i, n_values;
+	guint8 type_byte;
+	guint32 length;
+
+	start = buffer->len;
+	n_values = values != NULL ? g_strv_length ((char **) values) : 0;
+
+	length_offset = buffer->len;
+	append_uint32 (buffer, 0);
+
+	type_byte = type;
+	g_byte_array_append (buffer, &type_byte, 1);
+	append_uint32 (buffer, strlen (name));
+	append_uint32 (buffer, strlen (key));
+	append_uint32 (buffer, n_values);
+	g_byte_array_append (buffer, (guint8 *) name, strlen (name));
+	g_byte_array_append (buffer, (guint8 *) key, strlen (key));
+
+	for (i = 0; i < n_values; i++) {
+		append_uint32 (buffer, strlen (values[i]));
+		g_byte_array_append (buffer, (guint8 *) values[i], strlen (values[i]));
+	}
+
+	length = buffer->len - length_offset - sizeof (guint32);
+	memcpy (buffer->data + length_offset, &length, sizeof (length));
+
+	return buffer->len - start;
+}
+
 static gboolean
-save_in_idle_cb (gpointer data)
+read_uint32 (const char **p,
+	     const char *end,
+	     guint32 *value)
 {
-	GKeyFile *keyfile = data;
-	gchar *contents, *filename;
-	gsize length;
-	GError *error = NULL;
+	if (end - *p < (gssize) sizeof (guint32)) {
+		return FALSE;
+	}
 
-	save_in_idle_source_id = 0;
+	memcpy (value, *p, sizeof (guint32));
+	*p += sizeof (guint32);
 
-	contents = g_key_file_to_data (keyfile, &length, NULL);
-	filename = get_keyfile_path ();
+	return TRUE;
+}
 
-	if (contents != NULL) {
-		g_file_set_contents (filename,
-				     contents, length,
-				     &error);
-		g_free (contents);
+/* Returns the entry's values, which are owned by the entry if it was set
+ * in this session and newly allocated otherwise.
+ */
+static char **
+metadata_entry_get_values (MetadataEntry *entry,
+			   gboolean *free_values)
+{
+	char **values;
+	const char *p;
+	guint32 i, length;
+
+	if (entry->mapped_values == NULL) {
+		*free_values = FALSE;
+		return entry->values;
 	}
 
-	if (error != NULL) {
-		g_warning ("Couldn't save the desktop metadata keyfile to disk: %s",
-			   error->message);
-		g_error_free (error);
+	/* The record was checked when the file was loaded. */
+	values = g_new0 (char *, entry->n_values + 1);
+	p = entry->mapped_values;
+	for (i = 0; i < entry->n_values; i++) {
+		memcpy (&length, p, sizeof (length));
+		p += sizeof (length);
+		values[i] = g_strndup (p, length);
+		p += length;
 	}
 
-	g_free (filename);
+	*free_values = TRUE;
+	return values;
+}
 
-	return FALSE;
+static GHashTable *
+get_keys_for_name (MetadataStore *store,
+		   const char *name,
+		   gboolean create)
+{
+	GHashTable *keys;
+
+	keys = g_hash_table_lookup (store->names, name);
+	if (keys == NULL && create) {
+		keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, (GDestroyNotify) metadata_entry_free);
+		g_hash_table_insert (store->names, g_strdup (name), keys);
+	}
+
+	return keys;
+}
+
+static void
+store_add_replaced (MetadataStore *store,
+		    MetadataEntry *entry)
+{
+	if (store->compacted_contents == NULL) {
+		store->replaced_size += entry->record_size;
+		return;
+	}
+
+	/* Until the compaction is done, count for both the old file and
+	 * the new one, which may have a different record for the entry.
+	 */
+	store->compacted_replaced_size += entry->record_size;
+	store->replaced_size += entry->compacted_record_size != 0 ?
+		entry->compacted_record_size : entry->record_size;
 }
 
+/* Makes entry the current value of key, accounting for the record it
+ * replaces.
+ */
 static void
-save_in_idle (GKeyFile *keyfile)
+store_set_entry (MetadataStore *store,
+		 const char *name,
+		 const char *key,
+		 MetadataEntry *entry)
 {
-	if (save_in_idle_source_id != 0) {
-		g_source_remove (save_in_idle_source_id);
+	GHashTable *keys;
+	MetadataEntry *old_entry;
+
+	keys = get_keys_for_name (store, name, TRUE);
+
+	old_entry = g_hash_table_lookup (keys, key);
+	if (old_entry != NULL) {
+		store_add_replaced (store, old_entry);
 	}
 
-	save_in_idle_source_id = g_idle_add (save_in_idle_cb, keyfile);
+	if (entry->type == RECORD_UNSET) {
+		/* The unset record itself is dead weight once loaded */
+		store_add_replaced (store, entry);
+		g_hash_table_remove (keys, key);
+		metadata_entry_free (entry);
+	} else {
+		g_hash_table_insert (keys, g_strdup (key), entry);
+	}
 }
 
-static GKeyFile *
-load_metadata_keyfile (void)
+/* Indexes the records in the mapped file. Returns FALSE if the file is
+ * damaged; the records up to the damage are kept.
+ */
+static gboolean
+load_records (MetadataStore *store,
+	      const char *contents,
+	      gsize length)
 {
-  	GKeyFile *retval;
-	GError *error = NULL;
+	const char *p, *end, *record_end, *name, *key, *values;
+	guint32 record_length, name_length, key_length, n_values, value_length, i;
+	MetadataEntry *entry;
+	char *name_copy, *key_copy;
+	guint8 type;
+
+	if (length < STORE_MAGIC_LENGTH ||
+	    memcmp (contents, STORE_MAGIC, STORE_MAGIC_LENGTH) != 0) {
+		return FALSE;
+	}
+
+	p = contents + STORE_MAGIC_LENGTH;
+	end = contents + length;
+
+	while (p < end) {
+		const char *record_start;
+
+		record_start = p;
+		if (!read_uint32 (&p, end, &record_length) ||
+		    record_length > (gsize) (end - p)) {
+			return FALSE;
+		}
+		record_end = p + record_length;
+
+		if (record_end - p < 1) {
+			return FALSE;
+		}
+		type = *p++;
+
+		if (!read_uint32 (&p, record_end, &name_length) ||
+		    !read_uint32 (&p, record_end, &key_length) ||
+		    !read_uint32 (&p, record_end, &n_values) ||
+		    (gsize) (record_end - p) < (gsize) name_length + key_length ||
+		    type < RECORD_STRING || type > RECORD_UNSET) {
+			return FALSE;
+		}
+
+		name = p;
+		p += name_length;
+		key = p;
+		p += key_length;
+
+		values = p;
+		for (i = 0; i < n_values; i++) {
+			if (!read_uint32 (&p, record_end, &value_length) ||
+			    value_length > (gsize) (record_end - p)) {
+				return FALSE;
+			}
+			p += value_length;
+		}
+		p = record_end;
+
+		entry = g_new0 (MetadataEntry, 1);
+		entry->type = type;
+		entry->mapped_values = values;
+		entry->n_values = n_values;
+		entry->record_size = record_end - record_start;
+
+		name_copy = g_strndup (name, name_length);
+		key_copy = g_strndup (key, key_length);
+		store_set_entry (store, name_copy, key_copy, entry);
+		g_free (name_copy);
+		g_free (key_copy);
+
+		store->file_size = record_end - contents;
+	}
+
+	return TRUE;
+}
+
+#define STRV_TERMINATOR "@x-nemo-desktop-metadata-term@"
+
+/* Brings the metadata from the old keyfile into the store */
+static void
+import_keyfile (MetadataStore *store)
+{
+	GKeyFile *keyfile;
 	gchar *filename;
+	gchar **groups, **keys, **values;
+	gsize n_values;
+	MetadataEntry *entry;
+	int i, j;
 
-	retval = g_key_file_new ();
+	keyfile = g_key_file_new ();
 	filename = get_keyfile_path ();
 
-	g_key_file_load_from_file (retval,
-				   filename,
-				   G_KEY_FILE_NONE,
-				   &error);
+	if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (keyfile);
+		g_free (filename);
+		return;
+	}
 
-	if (error != NULL) {
-		if (!g_error_matches (error,
-				      G_FILE_ERROR,
-				      G_FILE_ERROR_NOENT)) {
-			g_print ("Unable to open the desktop metadata keyfile: %s\n",
-				 error->message);
+	groups = g_key_file_get_groups (keyfile, NULL);
+	for (i = 0; groups[i] != NULL; i++) {
+		keys = g_key_file_get_keys (keyfile, groups[i], NULL, NULL);
+		if (keys == NULL) {
+			continue;
 		}
 
-		g_error_free (error);
+		for (j = 0; keys[j] != NULL; j++) {
+			values = g_key_file_get_string_list (keyfile, groups[i], keys[j],
+							     &n_values, NULL);
+			if (values == NULL || n_values < 1) {
+				g_strfreev (values);
+				continue;
+			}
+
+			entry = g_new0 (MetadataEntry, 1);
+
+			/* single-length strv are stored with an additional
+			 * terminator in the keyfile, to tell them from strings.
+			 */
+			if (n_values == 1) {
+				entry->type = RECORD_STRING;
+			} else if (n_values == 2 && g_strcmp0 (values[1], STRV_TERMINATOR) == 0) {
+				entry->type = RECORD_STRINGV;
+				g_free (values[1]);
+				values[1] = NULL;
+			} else {
+				entry->type = RECORD_STRINGV;
+			}
+			entry->values = values;
+
+			store_set_entry (store, groups[i], keys[j], entry);
+		}
+
+		g_strfreev (keys);
 	}
 
+	g_strfreev (groups);
+	g_key_file_free (keyfile);
 	g_free (filename);
+}
 
-	return retval;
+/* Serializes the current values, updating the record sizes to match */
+static GByteArray *
+serialize_store (MetadataStore *store)
+{
+	GByteArray *buffer;
+	GHashTableIter names_iter, keys_iter;
+	gpointer name, keys, key, value;
+	MetadataEntry *entry;
+	char **values;
+	gboolean free_values;
+
+	buffer = g_byte_array_new ();
+	g_byte_array_append (buffer, (guint8 *) STORE_MAGIC, STORE_MAGIC_LENGTH);
+
+	g_hash_table_iter_init (&names_iter, store->names);
+	while (g_hash_table_iter_next (&names_iter, &name, &keys)) {
+		g_hash_table_iter_init (&keys_iter, keys);
+		while (g_hash_table_iter_next (&keys_iter, &key, &value)) {
+			entry = value;
+			values = metadata_entry_get_values (entry, &free_values);
+			entry->compacted_record_size =
+				append_record (buffer, name, key, entry->type,
+					       (const char * const *) values);
+			if (free_values) {
+				g_strfreev (values);
+			}
+		}
+	}
+
+	return buffer;
 }
 
-static GKeyFile *
-get_keyfile (void)
+/* Makes the record sizes from the compaction current if it worked, and
+ * forgets them either way.
+ */
+static void
+finish_record_sizes (MetadataStore *store,
+		     gboolean compacted)
 {
-	static gboolean keyfile_loaded = FALSE;
-	static GKeyFile *keyfile = NULL;
+	GHashTableIter names_iter, keys_iter;
+	gpointer keys, value;
+	MetadataEntry *entry;
+
+	g_hash_table_iter_init (&names_iter, store->names);
+	while (g_hash_table_iter_next (&names_iter, NULL, &keys)) {
+		g_hash_table_iter_init (&keys_iter, keys);
+		while (g_hash_table_iter_next (&keys_iter, NULL, &value)) {
+			entry = value;
+			if (compacted && entry->compacted_record_size != 0) {
+				entry->record_size = entry->compacted_record_size;
+			}
+			entry->compacted_record_size = 0;
+		}
+	}
+}
+
+static gboolean save_in_idle_cb (gpointer data);
+static void schedule_save (MetadataStore *store);
+
+static void
+compact_done_cb (GObject *source_object,
+		 GAsyncResult *res,
+		 gpointer user_data)
+{
+	MetadataStore *store;
+	GError *error;
 
-	if (!keyfile_loaded) {
-		keyfile = load_metadata_keyfile ();
-		keyfile_loaded = TRUE;
+	store = user_data;
+
+	error = NULL;
+	if (g_file_replace_contents_finish (G_FILE (source_object), res, NULL, &error)) {
+		store->file_size = store->compacted_contents->len;
+		store->needs_rewrite = FALSE;
+		finish_record_sizes (store, TRUE);
+		g_byte_array_free (store->compacted_records, TRUE);
+	} else {
+		g_warning ("Couldn't save the desktop metadata to disk: %s",
+			   error->message);
+		g_error_free (error);
+
+		finish_record_sizes (store, FALSE);
+		store->file_size = store->compacted_file_size;
+		store->replaced_size = store->compacted_replaced_size;
+
+		if (store->needs_rewrite) {
+			/* There is no usable file to append to. Everything
+			 * is still in memory, so write it all out again later.
+			 */
+			g_byte_array_free (store->compacted_records, TRUE);
+		} else {
+			/* The old file is still there. Its unsaved records go
+			 * first, before the ones made meanwhile.
+			 */
+			g_byte_array_append (store->compacted_records,
+					     store->pending_records->data,
+					     store->pending_records->len);
+			g_byte_array_free (store->pending_records, TRUE);
+			store->pending_records = store->compacted_records;
+			store->compact_failed = TRUE;
+		}
 	}
 
-	return keyfile;
+	store->compacted_records = NULL;
+	g_byte_array_free (store->compacted_contents, TRUE);
+	store->compacted_contents = NULL;
+
+	if (store->needs_rewrite) {
+		if (store->save_in_idle_source_id == 0) {
+			store->save_in_idle_source_id =
+				g_timeout_add_seconds (STORE_REWRITE_RETRY_SEC,
+						       save_in_idle_cb, store);
+		}
+	} else if (store->pending_records->len > 0) {
+		/* Changes made meanwhile go after the compacted records */
+		schedule_save (store);
+	}
 }
 
-void
-nemo_desktop_set_metadata_string (NemoFile *file,
-                                      const gchar *name,
-                                      const gchar *key,
-                                      const gchar *string)
+/* Rewrites the file with only the current values. The values set before
+ * now are all in the new file, so pending records are set aside, and
+ * only dropped once the new file is written.
+ */
+static void
+compact_store (MetadataStore *store)
 {
-	GKeyFile *keyfile;
+	GFile *location;
+	gchar *filename;
 
-	keyfile = get_keyfile ();
+	store->compacted_contents = serialize_store (store);
+
+	store->compacted_records = store->pending_records;
+	store->compacted_file_size = store->file_size;
+	store->compacted_replaced_size = store->replaced_size;
+	store->pending_records = g_byte_array_new ();
+	store->replaced_size = 0;
+
+	filename = get_store_path ();
+	location = g_file_new_for_path (filename);
+	g_file_replace_contents_async (location,
+				       (const char *) store->compacted_contents->data,
+				       store->compacted_contents->len,
+				       NULL, FALSE, G_FILE_CREATE_NONE,
+				       NULL,
+				       compact_done_cb, store);
+	g_object_unref (location);
+	g_free (filename);
+}
 
-	g_key_file_set_string (keyfile,
-			       name,
-			       key,
-			       string);
+static void
+append_pending_records (MetadataStore *store)
+{
+	gchar *filename;
+	gssize written;
+	gsize offset;
+	int fd;
+
+	filename = get_store_path ();
+	fd = g_open (filename, O_WRONLY | O_APPEND | O_CREAT, 0600);
+
+	if (fd < 0) {
+		g_warning ("Couldn't save the desktop metadata to disk: %s",
+			   g_strerror (errno));
+		g_free (filename);
+		return;
+	}
+
+	offset = 0;
+	while (offset < store->pending_records->len) {
+		written = write (fd, store->pending_records->data + offset,
+				 store->pending_records->len - offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			g_warning ("Couldn't save the desktop metadata to disk: %s",
+				   g_strerror (errno));
+			break;
+		}
+		offset += written;
+	}
 
-	save_in_idle (keyfile);
+	close (fd);
+	g_free (filename);
 
-	if (nemo_desktop_update_metadata_from_keyfile (file, name)) {
-		nemo_file_changed (file);
-	}	
+	store->file_size += store->pending_records->len;
+	g_byte_array_set_size (store->pending_records, 0);
 }
 
-#define STRV_TERMINATOR "@x-nemo-desktop-metadata-term@"
+static gboolean
+save_in_idle_cb (gpointer data)
+{
+	MetadataStore *store = data;
 
-void
-nemo_desktop_set_metadata_stringv (NemoFile *file,
-                                       const char *name,
-                                       const char *key,
-                                       const char * const *stringv)
+	store->save_in_idle_source_id = 0;
+
+	if (store->compacted_contents != NULL) {
+		/* compact_done_cb saves again */
+		return FALSE;
+	}
+
+	if (store->needs_rewrite ||
+	    (!store->compact_failed &&
+	     store->replaced_size > STORE_COMPACT_MIN_SIZE &&
+	     store->replaced_size > (store->file_size + store->pending_records->len) / 2)) {
+		compact_store (store);
+	} else {
+		append_pending_records (store);
+	}
+
+	return FALSE;
+}
+
+static void
+schedule_save (MetadataStore *store)
 {
-	GKeyFile *keyfile;
-	guint length;
-	gchar **actual_stringv = NULL;
-	gboolean free_strv = FALSE;
+	if (store->save_in_idle_source_id == 0) {
+		store->save_in_idle_source_id = g_idle_add (save_in_idle_cb, store);
+	}
+}
 
-	keyfile = get_keyfile ();
+static MetadataStore *
+get_store (void)
+{
+	static MetadataStore *store = NULL;
+	GError *error;
+	gchar *filename;
 
-	/* if we would be setting a single-length strv, append a fake
-	 * terminator to the array, to be able to differentiate it later from
-	 * the single string case
-	 */
-	length = g_strv_length ((gchar **) stringv);
+	if (store != NULL) {
+		return store;
+	}
 
-	if (length == 1) {
-		actual_stringv = g_malloc0 (3 * sizeof (gchar *));
-		actual_stringv[0] = (gchar *) stringv[0];
-		actual_stringv[1] = STRV_TERMINATOR;
-		actual_stringv[2] = NULL;
+	store = g_new0 (MetadataStore, 1);
+	store->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, (GDestroyNotify) g_hash_table_destroy);
+	store->pending_records = g_byte_array_new ();
 
-		length = 2;
-		free_strv = TRUE;
-	} else {
-		actual_stringv = (gchar **) stringv;
+	filename = get_store_path ();
+	error = NULL;
+	store->mapped_file = g_mapped_file_new (filename, FALSE, &error);
+
+	if (store->mapped_file == NULL) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_print ("Unable to open the desktop metadata: %s\n",
+				 error->message);
+		}
+		g_error_free (error);
+
+		import_keyfile (store);
+		store->needs_rewrite = TRUE;
+		compact_store (store);
+	} else if (!load_records (store,
+				  g_mapped_file_get_contents (store->mapped_file),
+				  g_mapped_file_get_length (store->mapped_file))) {
+		g_print ("The desktop metadata file is damaged, dropping what can't be read\n");
+		store->needs_rewrite = TRUE;
+		compact_store (store);
 	}
 
-	g_key_file_set_string_list (keyfile,
-				    name,
-				    key,
-				    (const gchar **) actual_stringv,
-				    length);
+	g_free (filename);
+
+	return store;
+}
+
+static void
+set_metadata (NemoFile *file,
+	      const char *name,
+	      const char *key,
+	      RecordType type,
+	      const char * const *values)
+{
+	MetadataStore *store;
+	MetadataEntry *entry;
+
+	store = get_store ();
+
+	entry = g_new0 (MetadataEntry, 1);
+	entry->type = type;
+	entry->values = g_strdupv ((char **) values);
+	entry->record_size = append_record (store->pending_records, name, key, type, values);
 
-	save_in_idle (keyfile);
+	store_set_entry (store, name, key, entry);
+
+	schedule_save (store);
 
 	if (nemo_desktop_update_metadata_from_keyfile (file, name)) {
 		nemo_file_changed (file);
 	}
+}
 
-	if (free_strv) {
-		g_free (actual_stringv);
-	}
+void
+nemo_desktop_set_metadata_string (NemoFile *file,
+                                      const gchar *name,
+                                      const gchar *key,
+                                      const gchar *string)
+{
+	const char *values[2];
+
+	values[0] = string;
+	values[1] = NULL;
+
+	set_metadata (file, name, key,
+		      string != NULL ? RECORD_STRING : RECORD_UNSET,
+		      string != NULL ? values : NULL);
+}
+
+void
+nemo_desktop_set_metadata_stringv (NemoFile *file,
+                                       const char *name,
+                                       const char *key,
+                                       const char * const *stringv)
+{
+	set_metadata (file, name, key,
+		      stringv != NULL ? RECORD_STRINGV : RECORD_UNSET,
+		      stringv);
 }
 
 gboolean
 nemo_desktop_update_metadata_from_keyfile (NemoFile *file,
 					       const gchar *name)
 {
-	gchar **keys, **values;
-	const gchar *actual_values[2];
-	const gchar *key, *value;
-	gchar *gio_key;
-	gsize length, values_length;
-	GKeyFile *keyfile;
+	MetadataStore *store;
+	GHashTable *keys;
+	GHashTableIter iter;
+	gpointer key, value;
+	MetadataEntry *entry;
 	GFileInfo *info;
-	gint idx;
+	gchar *gio_key;
+	char **values;
+	gboolean free_values;
 	gboolean res;
 
-	keyfile = get_keyfile ();
-
-	keys = g_key_file_get_keys (keyfile,
-				    name,
-				    &length,
-				    NULL);
+	store = get_store ();
 
+	keys = get_keys_for_name (store, name, FALSE);
 	if (keys == NULL) {
 		return FALSE;
 	}
 
 	info = g_file_info_new ();
 
-	for (idx = 0; idx < length; idx++) {
-		key = keys[idx];
-		values = g_key_file_get_string_list (keyfile,
-						     name,
-						     key,
-						     &values_length,
-						     NULL);
+	g_hash_table_iter_init (&iter, keys);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		entry = value;
+		values = metadata_entry_get_values (entry, &free_values);
 
 		gio_key = g_strconcat ("metadata::", key, NULL);
 
-		if (values_length < 1) {
-			continue;
-		} else if (values_length == 1) {
-			g_file_info_set_attribute_string (info,
-							  gio_key,
-							  values[0]);
-		} else if (values_length == 2) {
-			/* deal with the fact that single-length strv are stored
-			 * with an additional terminator in the keyfile string, to differentiate
-			 * them from the regular string case.
-			 */
-			value = values[1];
-
-			if (g_strcmp0 (value, STRV_TERMINATOR) == 0) {
-				/* if the 2nd value is the terminator, remove it */
-				actual_values[0] = values[0];
-				actual_values[1] = NULL;
-
-				g_file_info_set_attribute_stringv (info,
-								   gio_key,
-								   (gchar **) actual_values);
-			} else {
-				/* otherwise, set it as a regular strv */
-				g_file_info_set_attribute_stringv (info,
-								   gio_key,
-								   values);
-			}
-		} else {
-			g_file_info_set_attribute_stringv (info,
-							   gio_key,
-							   values);
+		if (entry->type == RECORD_STRING && values[0] != NULL) {
+			g_file_info_set_attribute_string (info, gio_key, values[0]);
+		} else if (entry->type == RECORD_STRINGV) {
+			g_file_info_set_attribute_stringv (info, gio_key, values);
 		}
 
 		g_free (gio_key);
-		g_strfreev (values);
+		if (free_values) {
+			g_strfreev (values);
+		}
 	}
 
 	res = nemo_file_update_metadata_from_info (file, info);
 
-	g_strfreev (keys);
 	g_object_unref (info);
 
 	return res;
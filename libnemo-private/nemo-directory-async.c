@@ -32,11 +32,13 @@
 #include "nemo-signaller.h"
 #include "nemo-global-preferences.h"
 #include "nemo-link.h"
+#include "nemo-trace.h"
 #include <eel/eel-glib-extensions.h>
 #include <gtk/gtk.h>
 #include <libxml/parser.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 /* turn this on to see messages about each load_directory call: */
 #if 0
@@ -55,6 +57,12 @@
 
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 
+/* Each batch is split into chunks of this many files, prepared in
+ * parallel. Collation keys make up most of the work.
+ */
+#define PREPARE_FILES_CHUNK_SIZE 25
+#define PREPARE_FILES_MAX_THREADS 8
+
 /* Keep async. jobs down to this number for all directories. */
 #define MAX_ASYNC_JOBS 10
 
@@ -98,8 +106,19 @@ struct DirectoryLoadState {
 	GHashTable *load_mime_list_hash;
 	NemoFile *load_directory_file;
 	int load_file_count;
+	GList *prepared_files;
+	volatile gint prepare_chunks_left;
+	gint64 trace_start;
 };
 
+typedef struct {
+	DirectoryLoadState *state;
+	GList *files;
+	int count;
+} PrepareFilesChunk;
+
+static GThreadPool *prepare_files_pool = NULL;
+
 struct MimeListState {
 	NemoDirectory *directory;
 	NemoFile *mime_list_file;
@@ -869,6 +888,7 @@ dequeue_pending_idle_callback (gpointer callback_data)
 	GFileInfo *file_info;
 	const char *mimetype, *name;
 	DirectoryLoadState *dir_load_state;
+	NemoFileExtras *extras;
 
 	directory = NEMO_DIRECTORY (callback_data);
 
@@ -982,8 +1002,9 @@ dequeue_pending_idle_callback (gpointer callback_data)
 
 			file->details->got_mime_list = TRUE;
 			file->details->mime_list_is_up_to_date = TRUE;
-			g_list_free_full (file->details->mime_list, g_free);
-			file->details->mime_list = istr_set_get_as_list
+			extras = nemo_file_get_extras (file);
+			g_list_free_full (extras->mime_list, g_free);
+			extras->mime_list = istr_set_get_as_list
 				(dir_load_state->load_mime_list_hash);
 
 			nemo_file_changed (file);
@@ -1090,6 +1111,17 @@ directory_load_done (NemoDirectory *directory,
 		     GError *error)
 {
 	GList *node;
+	DirectoryLoadState *state;
+	char *uri, *detail;
+
+	state = directory->details->directory_load_in_progress;
+	if (state != NULL && state->trace_start != 0) {
+		uri = nemo_directory_get_uri (directory);
+		detail = g_strdup_printf ("%s (%d files)", uri, state->load_file_count);
+		nemo_trace_end (state->trace_start, "directory", "Load directory", detail);
+		g_free (detail);
+		g_free (uri);
+	}
 
 	directory->details->directory_loaded = TRUE;
 	directory->details->directory_loaded_sent_notification = FALSE;
@@ -2055,11 +2087,130 @@ directory_load_state_free (DirectoryLoadState *state)
 	if (state->load_mime_list_hash != NULL) {
 		istr_set_destroy (state->load_mime_list_hash);
 	}
+	g_list_free_full (state->prepared_files, g_object_unref);
 	nemo_file_unref (state->load_directory_file);
 	g_object_unref (state->cancellable);
 	g_free (state);
 }
 
+static void more_files_callback (GObject *source_object,
+				 GAsyncResult *res,
+				 gpointer user_data);
+
+static void
+next_files (DirectoryLoadState *state)
+{
+	g_file_enumerator_next_files_async (state->enumerator,
+					    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+					    G_PRIORITY_DEFAULT,
+					    state->cancellable,
+					    more_files_callback,
+					    state);
+}
+
+static gboolean prepare_files_done (gpointer user_data);
+
+/* Runs in a worker thread. Only touches the chunk's GFileInfos, which
+ * the main thread leaves alone until prepare_files_done.
+ */
+static void
+prepare_files_thread (gpointer data,
+		      gpointer user_data)
+{
+	PrepareFilesChunk *chunk;
+	DirectoryLoadState *state;
+	GList *l;
+	int i;
+
+	chunk = data;
+	state = chunk->state;
+
+	for (l = chunk->files, i = 0; i < chunk->count; l = l->next, i++) {
+		if (g_cancellable_is_cancelled (state->cancellable)) {
+			break;
+		}
+		nemo_file_prepare_info (l->data);
+	}
+
+	g_slice_free (PrepareFilesChunk, chunk);
+
+	/* The last chunk to finish hands the batch back */
+	if (g_atomic_int_dec_and_test (&state->prepare_chunks_left)) {
+		g_idle_add_full (G_PRIORITY_DEFAULT,
+				 prepare_files_done,
+				 state, NULL);
+	}
+}
+
+static void
+prepare_files_start (DirectoryLoadState *state,
+		     GList *files)
+{
+	PrepareFilesChunk *chunk;
+	GList *l;
+	int n_files, n_chunks, n_threads;
+
+	if (prepare_files_pool == NULL) {
+		n_threads = CLAMP (sysconf (_SC_NPROCESSORS_ONLN), 1, PREPARE_FILES_MAX_THREADS);
+		prepare_files_pool = g_thread_pool_new (prepare_files_thread, NULL,
+							n_threads, FALSE, NULL);
+	}
+
+	n_files = g_list_length (files);
+	n_chunks = (n_files + PREPARE_FILES_CHUNK_SIZE - 1) / PREPARE_FILES_CHUNK_SIZE;
+
+	state->prepared_files = files;
+	state->prepare_chunks_left = n_chunks;
+
+	for (l = files; l != NULL; l = g_list_nth (l, PREPARE_FILES_CHUNK_SIZE)) {
+		chunk = g_slice_new (PrepareFilesChunk);
+		chunk->state = state;
+		chunk->files = l;
+		chunk->count = MIN (n_files, PREPARE_FILES_CHUNK_SIZE);
+		n_files -= chunk->count;
+
+		g_thread_pool_push (prepare_files_pool, chunk, NULL);
+	}
+}
+
+static gboolean
+prepare_files_done (gpointer user_data)
+{
+	DirectoryLoadState *state;
+	NemoDirectory *directory;
+	GList *files, *l;
+
+	state = user_data;
+
+	if (state->directory == NULL) {
+		/* Operation was cancelled. Bail out */
+		directory_load_state_free (state);
+		return FALSE;
+	}
+
+	directory = nemo_directory_ref (state->directory);
+
+	g_assert (directory->details->directory_load_in_progress == state);
+
+	files = state->prepared_files;
+	state->prepared_files = NULL;
+
+	for (l = files; l != NULL; l = l->next) {
+		directory_load_one (directory, l->data);
+		g_object_unref (l->data);
+	}
+	g_list_free (files);
+
+	/* Only ask for the next batch now, so the enumerator, the
+	 * workers and the main thread each handle one batch at a time.
+	 */
+	next_files (state);
+
+	nemo_directory_unref (directory);
+
+	return FALSE;
+}
+
 static void
 more_files_callback (GObject *source_object,
 		     GAsyncResult *res,
@@ -2068,8 +2219,7 @@ more_files_callback (GObject *source_object,
 	DirectoryLoadState *state;
 	NemoDirectory *directory;
 	GError *error;
-	GList *files, *l;
-	GFileInfo *info;
+	GList *files;
 
 	state = user_data;
 
@@ -2088,22 +2238,15 @@ more_files_callback (GObject *source_object,
 	files = g_file_enumerator_next_files_finish (state->enumerator,
 						     res, &error);
 
-	for (l = files; l != NULL; l = l->next) {
-		info = l->data;
-		directory_load_one (directory, info);
-		g_object_unref (info);
-	}
-
 	if (files == NULL) {
 		directory_load_done (directory, error);
 		directory_load_state_free (state);
 	} else {
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_DEFAULT,
-						    state->cancellable,
-						    more_files_callback,
-						    state);
+		/* Work out collation keys and interned strings off the
+		 * main thread; prepare_files_done then only has to
+		 * publish them.
+		 */
+		prepare_files_start (state, files);
 	}
 
 	nemo_directory_unref (directory);
@@ -2111,8 +2254,6 @@ more_files_callback (GObject *source_object,
 	if (error) {
 		g_error_free (error);
 	}
-
-	g_list_free (files);
 }
 
 static void
@@ -2143,12 +2284,7 @@ enumerate_children_callback (GObject *source_object,
 		return;
 	} else {
 		state->enumerator = enumerator;
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_DEFAULT,
-						    state->cancellable,
-						    more_files_callback,
-						    state);
+		next_files (state);
 	}
 }
 
@@ -2177,6 +2313,7 @@ start_monitoring_file_list (NemoDirectory *directory)
 	mark_all_files_unconfirmed (directory);
 
 	state = g_new0 (DirectoryLoadState, 1);
+	state->trace_start = nemo_trace_begin ();
 	state->directory = directory;
 	state->cancellable = g_cancellable_new ();
 	state->load_mime_list_hash = istr_set_new ();
@@ -2376,6 +2513,18 @@ is_needy (NemoFile *file,
 	return FALSE;
 }
 
+/* Whether someone asked for the file's extension info and it hasn't
+ * all come in yet.
+ */
+gboolean
+nemo_directory_is_getting_extension_info (NemoDirectory *directory,
+					  NemoFile *file)
+{
+	g_return_val_if_fail (file->details->directory == directory, FALSE);
+
+	return is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO);
+}
+
 static void
 directory_count_stop (NemoDirectory *directory)
 {
@@ -2679,9 +2828,9 @@ deep_count_one (DeepCountState *state,
 	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
 		/* Count the directory. */
         if (hidden) {
-            file->details->deep_hidden_count += 1;
+            nemo_file_get_extras (file)->deep_hidden_count += 1;
         } else {
-            file->details->deep_directory_count += 1;
+            nemo_file_get_extras (file)->deep_directory_count += 1;
         }
 		/* Record the fact that we have to descend into this directory. */
 
@@ -2691,15 +2840,15 @@ deep_count_one (DeepCountState *state,
 	} else {
 		/* Even non-regular files count as files. */
         if (hidden) {
-            file->details->deep_hidden_count += 1;
+            nemo_file_get_extras (file)->deep_hidden_count += 1;
         } else {
-            file->details->deep_file_count += 1;
+            nemo_file_get_extras (file)->deep_file_count += 1;
         }
 	}
 
 	/* Count the size, hidden or not */
 	if (!is_seen_inode && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE)) {
-		file->details->deep_size += g_file_info_get_size (info);
+		nemo_file_get_extras (file)->deep_size += g_file_info_get_size (info);
 	}
 }
 
@@ -2836,7 +2985,7 @@ deep_count_callback (GObject *source_object,
 	enumerator = g_file_enumerate_children_finish  (G_FILE (source_object),	res, NULL);
 	
 	if (enumerator == NULL) {
-		file->details->deep_unreadable_count += 1;
+		nemo_file_get_extras (file)->deep_unreadable_count += 1;
 		
 		deep_count_next_dir (state);
 	} else {
@@ -2902,6 +3051,7 @@ deep_count_start (NemoDirectory *directory,
 {
 	GFile *location;
 	DeepCountState *state;
+	NemoFileExtras *extras;
 	
 	if (directory->details->deep_count_in_progress != NULL) {
 		*doing_io = TRUE;
@@ -2928,11 +3078,12 @@ deep_count_start (NemoDirectory *directory,
 
 	/* Start counting. */
 	file->details->deep_counts_status = NEMO_REQUEST_IN_PROGRESS;
-	file->details->deep_directory_count = 0;
-	file->details->deep_file_count = 0;
-	file->details->deep_unreadable_count = 0;
-    file->details->deep_hidden_count = 0;
-	file->details->deep_size = 0;
+	extras = nemo_file_get_extras (file);
+	extras->deep_directory_count = 0;
+	extras->deep_file_count = 0;
+	extras->deep_unreadable_count = 0;
+	extras->deep_hidden_count = 0;
+	extras->deep_size = 0;
 	directory->details->deep_count_file = file;
 
 	state = g_new0 (DeepCountState, 1);
@@ -2991,6 +3142,7 @@ mime_list_done (MimeListState *state, gboolean success)
 {
 	NemoFile *file;
 	NemoDirectory *directory;
+	NemoFileExtras *extras;
 
 	directory = state->directory;
 	g_assert (directory != NULL);
@@ -2998,13 +3150,14 @@ mime_list_done (MimeListState *state, gboolean success)
 	file = state->mime_list_file;
 	
 	file->details->mime_list_is_up_to_date = TRUE;
-	g_list_free_full (file->details->mime_list, g_free);
+	extras = nemo_file_get_extras (file);
+	g_list_free_full (extras->mime_list, g_free);
 	if (success) {
 		file->details->mime_list_failed = TRUE;
-		file->details->mime_list = NULL;
+		extras->mime_list = NULL;
 	} else {
 		file->details->got_mime_list = TRUE;
-		file->details->mime_list = istr_set_get_as_list	(state->mime_list_hash);
+		extras->mime_list = istr_set_get_as_list	(state->mime_list_hash);
 	}
 	directory->details->mime_list_in_progress = NULL;
 
@@ -3163,7 +3316,10 @@ mime_list_start (NemoDirectory *directory,
 	*doing_io = TRUE;
 
 	if (!nemo_file_is_directory (file)) {
-		g_list_free (file->details->mime_list);
+		if (file->details->extras != NULL) {
+			g_list_free_full (file->details->extras->mime_list, g_free);
+			file->details->extras->mime_list = NULL;
+		}
 		file->details->mime_list_failed = FALSE;
 		file->details->got_mime_list = FALSE;
 		file->details->mime_list_is_up_to_date = TRUE;
@@ -4338,6 +4494,18 @@ filesystem_info_start (NemoDirectory *directory,
 static void
 extension_info_cancel (NemoDirectory *directory)
 {
+	ExtensionInfoBatch *batch;
+
+	batch = directory->details->extension_info_batch;
+	if (batch != NULL) {
+		/* The callback frees the batch once the worker is done */
+		batch->directory = NULL;
+		g_cancellable_cancel (batch->cancellable);
+		directory->details->extension_info_batch = NULL;
+
+		async_job_end (directory, "extension info");
+	}
+
 	if (directory->details->extension_info_in_progress != NULL) {
 		if (directory->details->extension_info_idle) {
 			g_source_remove (directory->details->extension_info_idle);
@@ -4359,6 +4527,20 @@ extension_info_cancel (NemoDirectory *directory)
 static void
 extension_info_stop (NemoDirectory *directory)
 {
+	GList *node;
+
+	if (directory->details->extension_info_batch != NULL) {
+		for (node = directory->details->extension_info_batch->files; node != NULL; node = node->next) {
+			if (is_needy (node->data, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
+				return;
+			}
+		}
+
+		/* None of it is wanted any more */
+		extension_info_cancel (directory);
+		return;
+	}
+
 	if (directory->details->extension_info_in_progress != NULL) {
 		NemoFile *file;
 
@@ -4376,6 +4558,23 @@ extension_info_stop (NemoDirectory *directory)
 	}
 }
 
+/* Like finish_info_provider, for when the caller updates the
+ * directory's state once for many files.
+ */
+static void
+finish_info_provider_for_file (NemoFile *file,
+			       NemoInfoProvider *provider)
+{
+	file->details->pending_info_providers = 
+		g_list_remove  (file->details->pending_info_providers,
+				provider);
+	g_object_unref (provider);
+
+	if (file->details->pending_info_providers == NULL) {
+		nemo_file_info_providers_done (file);
+	}
+}
+
 static void
 finish_info_provider (NemoDirectory *directory,
 		      NemoFile *file,
@@ -4443,6 +4642,188 @@ info_provider_callback (NemoInfoProvider *provider,
 				 g_free);
 }
 
+/* Providers that implement update_file_info_batch get up to this many
+ * files at a time, answered in a worker thread.
+ */
+#define EXTENSION_INFO_BATCH_SIZE 256
+
+/* Extensions get their own threads, so a slow one can't hold up the
+ * GIO jobs that load directories.
+ */
+#define EXTENSION_INFO_MAX_THREADS 4
+
+struct ExtensionInfoBatch {
+	NemoDirectory *directory; /* NULL once cancelled */
+	NemoInfoProvider *provider;
+	GCancellable *cancellable;
+	GList *files;
+	GList *requests;
+	/* extension_info_serial of each file when the batch was made */
+	GArray *serials;
+};
+
+static GThreadPool *extension_info_pool = NULL;
+
+static void
+extension_info_batch_free (ExtensionInfoBatch *batch)
+{
+	g_object_unref (batch->provider);
+	g_object_unref (batch->cancellable);
+	nemo_file_list_free (batch->files);
+	g_list_free_full (batch->requests, (GDestroyNotify) nemo_file_info_request_unref);
+	g_array_free (batch->serials, TRUE);
+	g_free (batch);
+}
+
+static void
+extension_info_batch_add (ExtensionInfoBatch *batch,
+			  NemoFile *file)
+{
+	char *uri, *mime_type;
+
+	uri = nemo_file_get_uri (file);
+	mime_type = nemo_file_get_mime_type (file);
+
+	batch->files = g_list_prepend (batch->files, nemo_file_ref (file));
+	batch->requests = g_list_prepend (batch->requests,
+					  nemo_file_info_request_new (uri, mime_type));
+	g_array_append_val (batch->serials, file->details->extension_info_serial);
+
+	g_free (uri);
+	g_free (mime_type);
+}
+
+static void
+apply_info_request (NemoFile *file,
+		    NemoFileInfoRequest *request)
+{
+	GList *l;
+	GHashTable *attributes;
+	GHashTableIter iter;
+	gpointer name, value;
+
+	/* The list is newest first, as the file keeps it */
+	for (l = g_list_last (nemo_file_info_request_get_emblems (request)); l != NULL; l = l->prev) {
+		nemo_file_info_add_emblem (NEMO_FILE_INFO (file), l->data);
+	}
+
+	attributes = nemo_file_info_request_get_string_attributes (request);
+	if (attributes != NULL) {
+		g_hash_table_iter_init (&iter, attributes);
+		while (g_hash_table_iter_next (&iter, &name, &value)) {
+			nemo_file_info_add_string_attribute (NEMO_FILE_INFO (file), name, value);
+		}
+	}
+}
+
+static gboolean
+extension_info_batch_done (gpointer user_data)
+{
+	ExtensionInfoBatch *batch;
+	NemoDirectory *directory;
+	NemoFile *file;
+	GList *f, *r;
+	guint i;
+
+	batch = user_data;
+	directory = batch->directory;
+
+	if (directory == NULL) {
+		/* Operation was cancelled. Bail out */
+		extension_info_batch_free (batch);
+		return FALSE;
+	}
+
+	nemo_directory_ref (directory);
+
+	g_assert (directory->details->extension_info_batch == batch);
+	directory->details->extension_info_batch = NULL;
+	async_job_end (directory, "extension info");
+
+	for (f = batch->files, r = batch->requests, i = 0; f != NULL; f = f->next, r = r->next, i++) {
+		file = f->data;
+		/* Skip files that moved away or were invalidated since */
+		if (file->details->directory != directory ||
+		    file->details->extension_info_serial != g_array_index (batch->serials, guint, i) ||
+		    g_list_find (file->details->pending_info_providers,
+				 batch->provider) == NULL) {
+			continue;
+		}
+		apply_info_request (file, r->data);
+		finish_info_provider_for_file (file, batch->provider);
+	}
+
+	extension_info_batch_free (batch);
+
+	nemo_directory_async_state_changed (directory);
+	nemo_directory_unref (directory);
+
+	return FALSE;
+}
+
+static void
+extension_info_batch_thread (gpointer data,
+			     gpointer user_data)
+{
+	ExtensionInfoBatch *batch;
+
+	batch = data;
+
+	if (!g_cancellable_is_cancelled (batch->cancellable)) {
+		nemo_info_provider_update_file_info_batch (batch->provider,
+							   batch->requests,
+							   batch->cancellable);
+	}
+
+	g_idle_add (extension_info_batch_done, batch);
+}
+
+static void
+extension_info_batch_start (NemoDirectory *directory,
+			    NemoFile *first_file,
+			    NemoInfoProvider *provider)
+{
+	ExtensionInfoBatch *batch;
+	NemoFile *file;
+	GList *node;
+	int count;
+
+	if (extension_info_pool == NULL) {
+		extension_info_pool = g_thread_pool_new (extension_info_batch_thread, NULL,
+							 EXTENSION_INFO_MAX_THREADS,
+							 FALSE, NULL);
+	}
+
+	batch = g_new0 (ExtensionInfoBatch, 1);
+	batch->directory = directory;
+	batch->provider = g_object_ref (provider);
+	batch->cancellable = g_cancellable_new ();
+	batch->serials = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	extension_info_batch_add (batch, first_file);
+	count = 1;
+
+	/* Take along the other files waiting for the same provider */
+	for (node = directory->details->file_list;
+	     node != NULL && count < EXTENSION_INFO_BATCH_SIZE;
+	     node = node->next) {
+		file = node->data;
+		if (file != first_file &&
+		    g_list_find (file->details->pending_info_providers, provider) != NULL &&
+		    is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
+			extension_info_batch_add (batch, file);
+			count++;
+		}
+	}
+
+	batch->files = g_list_reverse (batch->files);
+	batch->requests = g_list_reverse (batch->requests);
+
+	directory->details->extension_info_batch = batch;
+
+	g_thread_pool_push (extension_info_pool, batch, NULL);
+}
+
 static void
 extension_info_start (NemoDirectory *directory,
 		      NemoFile *file,
@@ -4453,7 +4834,8 @@ extension_info_start (NemoDirectory *directory,
 	NemoOperationHandle *handle;
 	GClosure *update_complete;
 
-	if (directory->details->extension_info_in_progress != NULL) {
+	if (directory->details->extension_info_in_progress != NULL ||
+	    directory->details->extension_info_batch != NULL) {
 		*doing_io = TRUE;
 		return;
 	}
@@ -4469,6 +4851,11 @@ extension_info_start (NemoDirectory *directory,
 
 	provider = file->details->pending_info_providers->data;
 
+	if (nemo_info_provider_can_update_batch (provider)) {
+		extension_info_batch_start (directory, file, provider);
+		return;
+	}
+
 	update_complete = g_cclosure_new (G_CALLBACK (info_provider_callback),
 					  directory,
 					  NULL);
@@ -28,6 +28,7 @@
 #include <libnemo-private/nemo-file-queue.h>
 #include <libnemo-private/nemo-file.h>
 #include <libnemo-private/nemo-monitor.h>
+#include <libnemo-private/nemo-string-arena.h>
 #include <libnemo-extension/nemo-info-provider.h>
 #include <libxml/tree.h>
 
@@ -43,6 +44,7 @@ typedef struct MimeListState MimeListState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct ExtensionInfoBatch ExtensionInfoBatch;
 
 typedef enum {
 	REQUEST_LINK_INFO,
@@ -122,6 +124,7 @@ struct NemoDirectoryDetails
 	NemoInfoProvider *extension_info_provider;
 	NemoOperationHandle *extension_info_in_progress;
 	guint extension_info_idle;
+	ExtensionInfoBatch *extension_info_batch;
 
 	ThumbnailState *thumbnail_state;
 
@@ -136,6 +139,9 @@ struct NemoDirectoryDetails
 	GList *file_operations_in_progress; /* list of FileOperation * */
 
 	GHashTable *hidden_file_hash;
+
+	/* Collation keys of the files in this directory */
+	NemoStringArena *string_arena;
 };
 
 NemoDirectory *nemo_directory_get_existing                    (GFile                     *location);
@@ -175,6 +181,8 @@ gboolean           nemo_directory_is_file_list_monitored          (NemoDirectory
 gboolean           nemo_directory_is_anyone_monitoring_file_list  (NemoDirectory         *directory);
 gboolean           nemo_directory_has_active_request_for_file     (NemoDirectory         *directory,
 								       NemoFile              *file);
+gboolean           nemo_directory_is_getting_extension_info       (NemoDirectory         *directory,
+								       NemoFile              *file);
 void               nemo_directory_remove_file_monitor_link        (NemoDirectory         *directory,
 								       GList                     *link);
 void               nemo_directory_schedule_dequeue_pending        (NemoDirectory         *directory);
@@ -39,6 +39,9 @@
 #include <eel/eel-string.h>
 #include <gtk/gtk.h>
 
+#define DEBUG_FLAG NEMO_DEBUG_FILE
+#include "nemo-debug.h"
+
 enum {
 	FILES_ADDED,
 	FILES_CHANGED,
@@ -116,6 +119,7 @@ nemo_directory_init (NemoDirectory *directory)
 	directory->details->high_priority_queue = nemo_file_queue_new ();
 	directory->details->low_priority_queue = nemo_file_queue_new ();
 	directory->details->extension_queue = nemo_file_queue_new ();
+	directory->details->string_arena = nemo_string_arena_new ();
 }
 
 NemoDirectory *
@@ -191,6 +195,7 @@ nemo_directory_finalize (GObject *object)
 	g_assert (directory->details->count_in_progress == NULL);
 	g_assert (directory->details->dequeue_pending_idle_id == 0);
 	g_list_free_full (directory->details->pending_file_info, g_object_unref);
+	nemo_string_arena_unref (directory->details->string_arena);
 
 	G_OBJECT_CLASS (nemo_directory_parent_class)->finalize (object);
 }
@@ -316,6 +321,10 @@ add_preferences_callbacks (void)
 				  "changed::" NEMO_PREFERENCES_DATE_FORMAT,
 				  G_CALLBACK(async_data_preference_changed_callback),
 				  NULL);
+	g_signal_connect_swapped (nemo_preferences,
+				  "changed::" NEMO_PREFERENCES_SIZE_PREFIXES,
+				  G_CALLBACK (async_data_preference_changed_callback),
+				  NULL);
 }
 
 /**
@@ -746,9 +755,59 @@ nemo_directory_emit_change_signals (NemoDirectory *directory,
 	nemo_directory_emit_files_changed (directory, changed_files);
 }
 
+#ifdef ENABLE_DEBUG
+/* Rough resident size of the files of a directory, not counting what
+ * they share with other files.
+ */
+static void
+debug_memory_report (NemoDirectory *directory)
+{
+	GList *node;
+	NemoFile *file;
+	guint n_files, n_extras;
+	gsize details_size, extras_size, arena_allocated, arena_used;
+	char *uri;
+
+	n_files = 0;
+	n_extras = 0;
+	for (node = directory->details->file_list; node != NULL; node = node->next) {
+		file = NEMO_FILE (node->data);
+		n_files++;
+		if (file->details->extras != NULL) {
+			n_extras++;
+		}
+	}
+
+	if (n_files == 0) {
+		return;
+	}
+
+	details_size = sizeof (NemoFile) + sizeof (NemoFileDetails);
+	extras_size = n_extras * sizeof (NemoFileExtras);
+	nemo_string_arena_get_size (directory->details->string_arena,
+				    &arena_allocated, &arena_used);
+
+	uri = nemo_directory_get_uri (directory);
+	DEBUG ("%s: %u files, %" G_GSIZE_FORMAT " bytes per file "
+	       "(%" G_GSIZE_FORMAT " details, %u files with extras, "
+	       "%" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " collation key bytes used)",
+	       uri, n_files,
+	       details_size + (extras_size + arena_allocated) / n_files,
+	       details_size, n_extras,
+	       arena_used, arena_allocated);
+	g_free (uri);
+}
+#endif
+
 void
 nemo_directory_emit_done_loading (NemoDirectory *directory)
 {
+#ifdef ENABLE_DEBUG
+	if (DEBUGGING) {
+		debug_memory_report (directory);
+	}
+#endif
+
 	g_signal_emit (directory,
 			 signals[DONE_LOADING], 0);
 }
@@ -25,6 +25,9 @@
 
 #include "nemo-directory-notify.h"
 
+#define DEBUG_FLAG NEMO_DEBUG_FILE_CHANGES
+#include "nemo-debug.h"
+
 typedef enum {
 	CHANGE_FILE_INITIAL,
 	CHANGE_FILE_ADDED,
@@ -47,6 +50,8 @@ typedef struct {
 	GList *head;
 	GList *tail;
 	GMutex mutex;
+	/* protected by mutex too */
+	guint64 n_queued;
 } NemoFileChangesQueue;
 
 static NemoFileChangesQueue *
@@ -79,6 +84,8 @@ nemo_file_changes_queue_add_common (NemoFileChangesQueue *queue,
 	/* enqueue the new queue item while locking down the list */
 	g_mutex_lock (&queue->mutex);
 
+	queue->n_queued++;
+
 	queue->head = g_list_prepend (queue->head, new_item);
 	if (queue->tail == NULL)
 		queue->tail = queue->head;
@@ -207,6 +214,158 @@ enum {
 	CONSUME_CHANGES_MAX_CHUNK = 20
 };
 
+/* What a file's additions, changes and removals in one pass add up to */
+typedef enum {
+	COALESCED_ADDED,
+	COALESCED_CHANGED,
+	COALESCED_REMOVED,
+	/* removed, then added again */
+	COALESCED_REPLACED
+} CoalescedKind;
+
+typedef struct {
+	GFile *location;
+	CoalescedKind kind;
+} CoalescedChange;
+
+typedef struct {
+	/* in the order the files were first seen */
+	GArray *changes;
+	/* location -> index in changes + 1 */
+	GHashTable *indices;
+} ChangeCoalescer;
+
+static NemoFileChangesStats stats;
+static gint64 last_consume_time = 0;
+
+static CoalescedKind
+merge_coalesced_kinds (CoalescedKind old_kind, CoalescedKind new_kind)
+{
+	switch (old_kind) {
+	case COALESCED_ADDED:
+		/* An addition followed by a removal is dropped, but the
+		 * removal is kept in case the file was known already.
+		 */
+		if (new_kind == COALESCED_REMOVED) {
+			return COALESCED_REMOVED;
+		}
+		return COALESCED_ADDED;
+	case COALESCED_CHANGED:
+		return new_kind;
+	case COALESCED_REMOVED:
+	case COALESCED_REPLACED:
+		if (new_kind == COALESCED_REMOVED) {
+			return COALESCED_REMOVED;
+		}
+		return COALESCED_REPLACED;
+	default:
+		g_assert_not_reached ();
+		return new_kind;
+	}
+}
+
+static void
+change_coalescer_init (ChangeCoalescer *coalescer)
+{
+	coalescer->changes = g_array_new (FALSE, FALSE, sizeof (CoalescedChange));
+	coalescer->indices = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+}
+
+static void
+change_coalescer_destroy (ChangeCoalescer *coalescer)
+{
+	g_array_free (coalescer->changes, TRUE);
+	g_hash_table_destroy (coalescer->indices);
+}
+
+/* Takes over the reference to location */
+static void
+change_coalescer_add (ChangeCoalescer *coalescer,
+		      GFile *location,
+		      CoalescedKind kind)
+{
+	CoalescedChange change, *existing;
+	guint index;
+
+	index = GPOINTER_TO_UINT (g_hash_table_lookup (coalescer->indices, location));
+	if (index != 0) {
+		existing = &g_array_index (coalescer->changes, CoalescedChange, index - 1);
+		existing->kind = merge_coalesced_kinds (existing->kind, kind);
+		g_object_unref (location);
+		stats.changes_coalesced++;
+		return;
+	}
+
+	change.location = location;
+	change.kind = kind;
+	g_array_append_val (coalescer->changes, change);
+	g_hash_table_insert (coalescer->indices, location,
+			     GUINT_TO_POINTER (coalescer->changes->len));
+}
+
+/* Sends off what the changes added up to: removals first, so a file
+ * that was replaced is added back, then additions and changes.
+ */
+static void
+change_coalescer_flush (ChangeCoalescer *coalescer)
+{
+	GList *additions, *changes, *deletions;
+	CoalescedChange *change;
+	guint i;
+
+	if (coalescer->changes->len == 0) {
+		return;
+	}
+
+	additions = NULL;
+	changes = NULL;
+	deletions = NULL;
+
+	for (i = coalescer->changes->len; i > 0; i--) {
+		change = &g_array_index (coalescer->changes, CoalescedChange, i - 1);
+
+		switch (change->kind) {
+		case COALESCED_ADDED:
+			additions = g_list_prepend (additions, change->location);
+			break;
+		case COALESCED_CHANGED:
+			changes = g_list_prepend (changes, change->location);
+			break;
+		case COALESCED_REMOVED:
+			deletions = g_list_prepend (deletions, change->location);
+			break;
+		case COALESCED_REPLACED:
+			deletions = g_list_prepend (deletions, g_object_ref (change->location));
+			additions = g_list_prepend (additions, change->location);
+			break;
+		default:
+			g_assert_not_reached ();
+			break;
+		}
+	}
+
+	if (deletions != NULL) {
+		nemo_directory_notify_files_removed (deletions);
+		stats.changes_delivered += g_list_length (deletions);
+		g_list_free_full (deletions, g_object_unref);
+	}
+	if (additions != NULL) {
+		nemo_directory_notify_files_added (additions);
+		stats.changes_delivered += g_list_length (additions);
+		g_list_free_full (additions, g_object_unref);
+	}
+	if (changes != NULL) {
+		nemo_directory_notify_files_changed (changes);
+		stats.changes_delivered += g_list_length (changes);
+		g_list_free_full (changes, g_object_unref);
+	}
+
+	stats.flushes++;
+
+	g_array_set_size (coalescer->changes, 0);
+	g_hash_table_remove_all (coalescer->indices);
+}
+
 static void
 pairs_list_free (GList *pairs)
 {
@@ -240,125 +399,94 @@ position_set_list_free (GList *list)
 	g_list_free_full (list, g_free);
 }
 
-/* go through changes in the change queue, send ones with the same kind
- * in a list to the different nemo_directory_notify calls
+static void
+flush_moves (GList **moves)
+{
+	if (*moves != NULL) {
+		*moves = g_list_reverse (*moves);
+		nemo_directory_notify_files_moved (*moves);
+		stats.changes_delivered += g_list_length (*moves);
+		pairs_list_free (*moves);
+		*moves = NULL;
+		stats.flushes++;
+	}
+}
+
+static void
+flush_position_set_requests (GList **position_set_requests)
+{
+	if (*position_set_requests != NULL) {
+		*position_set_requests = g_list_reverse (*position_set_requests);
+		nemo_directory_schedule_position_set (*position_set_requests);
+		position_set_list_free (*position_set_requests);
+		*position_set_requests = NULL;
+	}
+}
+
+/* go through changes in the change queue and send them to the different
+ * nemo_directory_notify calls. Additions, changes and removals in a row
+ * are coalesced per file, so a file created and deleted in between two
+ * passes costs one removal, and a file written to many times one change.
+ * Moves are sent in order with respect to the rest, as they change which
+ * file a location refers to.
  */ 
 void
 nemo_file_changes_consume_changes (gboolean consume_all)
 {
 	NemoFileChange *change;
-	GList *additions, *changes, *deletions, *moves;
-	GList *position_set_requests;
+	GList *moves, *position_set_requests;
 	GFilePair *pair;
 	NemoFileChangesQueuePosition *position_set;
+	ChangeCoalescer coalescer;
 	guint chunk_count;
 	NemoFileChangesQueue *queue;
-	gboolean flush_needed;
-	
+	gint64 now;
 
-	additions = NULL;
-	changes = NULL;
-	deletions = NULL;
 	moves = NULL;
 	position_set_requests = NULL;
+	change_coalescer_init (&coalescer);
 
 	queue = nemo_file_changes_queue_get();
-		
-	/* Consume changes from the queue, stuffing them into one of three lists,
-	 * keep doing it while the changes are of the same kind, then send them off.
-	 * This is to ensure that the changes get sent off in the same order that they 
-	 * arrived.
-	 */
-	for (chunk_count = 0; ; chunk_count++) {
-		change = nemo_file_changes_queue_get_change (queue);
 
-		/* figure out if we need to flush the pending changes that we collected sofar */
+	for (chunk_count = 0; ; chunk_count++) {
+		if (!consume_all && chunk_count >= CONSUME_CHANGES_MAX_CHUNK) {
+			/* we have reached the chunk maximum */
+			change = NULL;
+		} else {
+			change = nemo_file_changes_queue_get_change (queue);
+		}
 
 		if (change == NULL) {
-			flush_needed = TRUE;
 			/* no changes left, flush everything */
-		} else {
-			flush_needed = additions != NULL
-				&& change->kind != CHANGE_FILE_ADDED
-				&& change->kind != CHANGE_POSITION_SET
-				&& change->kind != CHANGE_POSITION_REMOVE;
-			
-			flush_needed |= changes != NULL
-				&& change->kind != CHANGE_FILE_CHANGED;
-			
-			flush_needed |= moves != NULL
-				&& change->kind != CHANGE_FILE_MOVED
-				&& change->kind != CHANGE_POSITION_SET
-				&& change->kind != CHANGE_POSITION_REMOVE;
-			
-			flush_needed |= deletions != NULL
-				&& change->kind != CHANGE_FILE_REMOVED;
-			
-			flush_needed |= position_set_requests != NULL
-				&& change->kind != CHANGE_POSITION_SET
-				&& change->kind != CHANGE_POSITION_REMOVE
-				&& change->kind != CHANGE_FILE_ADDED
-				&& change->kind != CHANGE_FILE_MOVED;
-			
-			flush_needed |= !consume_all && chunk_count >= CONSUME_CHANGES_MAX_CHUNK;
-				/* we have reached the chunk maximum */
-		}
-		
-		if (flush_needed) {
-			/* Send changes we collected off. 
-			 * At one time we may only have one of the lists
-			 * contain changes.
-			 */
-			
-			if (deletions != NULL) {
-				deletions = g_list_reverse (deletions);
-				nemo_directory_notify_files_removed (deletions);
-				g_list_free_full (deletions, g_object_unref);
-				deletions = NULL;
-			}
-			if (moves != NULL) {
-				moves = g_list_reverse (moves);
-				nemo_directory_notify_files_moved (moves);
-				pairs_list_free (moves);
-				moves = NULL;
-			}
-			if (additions != NULL) {
-				additions = g_list_reverse (additions);
-				nemo_directory_notify_files_added (additions);
-				g_list_free_full (additions, g_object_unref);
-				additions = NULL;
-			}
-			if (changes != NULL) {
-				changes = g_list_reverse (changes);
-				nemo_directory_notify_files_changed (changes);
-				g_list_free_full (changes, g_object_unref);
-				changes = NULL;
-			}
-			if (position_set_requests != NULL) {
-				position_set_requests = g_list_reverse (position_set_requests);
-				nemo_directory_schedule_position_set (position_set_requests);
-				position_set_list_free (position_set_requests);
-				position_set_requests = NULL;
-			}
+			change_coalescer_flush (&coalescer);
+			flush_moves (&moves);
+			flush_position_set_requests (&position_set_requests);
+			break;
 		}
 
-		if (change == NULL) {
-			/* we are done */
-			return;
+		stats.changes_consumed++;
+
+		/* Moves go out in order with what came before and after
+		 * them; everything else waits for the end of the pass.
+		 */
+		if (change->kind == CHANGE_FILE_MOVED) {
+			change_coalescer_flush (&coalescer);
+		} else if (change->kind != CHANGE_POSITION_SET &&
+			   change->kind != CHANGE_POSITION_REMOVE) {
+			flush_moves (&moves);
 		}
-		
-		/* add the new change to the list */
+
 		switch (change->kind) {
 		case CHANGE_FILE_ADDED:
-			additions = g_list_prepend (additions, change->from);
+			change_coalescer_add (&coalescer, change->from, COALESCED_ADDED);
 			break;
 
 		case CHANGE_FILE_CHANGED:
-			changes = g_list_prepend (changes, change->from);
+			change_coalescer_add (&coalescer, change->from, COALESCED_CHANGED);
 			break;
 
 		case CHANGE_FILE_REMOVED:
-			deletions = g_list_prepend (deletions, change->from);
+			change_coalescer_add (&coalescer, change->from, COALESCED_REMOVED);
 			break;
 
 		case CHANGE_FILE_MOVED:
@@ -392,5 +520,36 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 		}
 
 		g_free (change);
-	}	
+	}
+
+	change_coalescer_destroy (&coalescer);
+
+	/* Keep a decaying average of the rate changes come in at */
+	now = g_get_monotonic_time ();
+	if (last_consume_time != 0 && now > last_consume_time && chunk_count > 0) {
+		stats.changes_per_second = 0.75 * stats.changes_per_second +
+			0.25 * (chunk_count * (double) G_USEC_PER_SEC / (now - last_consume_time));
+	}
+	last_consume_time = now;
+	stats.passes++;
+
+	DEBUG ("%u changes consumed; %" G_GUINT64_FORMAT " consumed, %" G_GUINT64_FORMAT
+	       " coalesced, %" G_GUINT64_FORMAT " delivered in %" G_GUINT64_FORMAT
+	       " flushes so far, %.1f changes/s",
+	       chunk_count, stats.changes_consumed, stats.changes_coalesced,
+	       stats.changes_delivered, stats.flushes, stats.changes_per_second);
+}
+
+void
+nemo_file_changes_get_stats (NemoFileChangesStats *stats_out)
+{
+	NemoFileChangesQueue *queue;
+
+	queue = nemo_file_changes_queue_get ();
+
+	*stats_out = stats;
+
+	g_mutex_lock (&queue->mutex);
+	stats_out->changes_queued = queue->n_queued;
+	g_mutex_unlock (&queue->mutex);
 }
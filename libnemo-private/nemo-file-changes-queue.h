@@ -38,5 +38,21 @@ void nemo_file_changes_queue_schedule_position_remove        (GFile      *locati
 
 void nemo_file_changes_consume_changes                       (gboolean    consume_all);
 
+/* Counters for profiling how changes flow through the queue */
+typedef struct {
+	guint64 changes_queued;
+	guint64 changes_consumed;
+	/* merged into an earlier change to the same file */
+	guint64 changes_coalesced;
+	/* handed to nemo_directory_notify_files_* */
+	guint64 changes_delivered;
+	guint64 flushes;
+	guint64 passes;
+	/* decaying average over the passes */
+	double changes_per_second;
+} NemoFileChangesStats;
+
+void nemo_file_changes_get_stats                             (NemoFileChangesStats *stats);
+
 
 #endif /* NEMO_FILE_CHANGES_QUEUE_H */
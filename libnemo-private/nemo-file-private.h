@@ -52,6 +52,40 @@ typedef enum {
 	UNKNOWN
 } Knowledge;
 
+/* Fields that most files never set. They are kept out of
+ * NemoFileDetails and allocated on first write by
+ * nemo_file_get_extras(); nemo_file_peek_extras() reads them
+ * without allocating.
+ */
+typedef struct {
+	/* File operations in progress */
+	GList *operations_in_progress;
+
+	/* Emblems provided by extensions */
+	GList *extension_emblems;
+	GList *pending_extension_emblems;
+
+	/* Attributes provided by extensions */
+	GHashTable *extension_attributes;
+	GHashTable *pending_extension_attributes;
+
+	GList *mime_list; /* If this is a directory, the list of MIME types in it. */
+
+	char *trash_orig_path;
+	time_t trash_time; /* 0 is unknown */
+
+	guint deep_directory_count;
+	guint deep_file_count;
+	guint deep_unreadable_count;
+	guint deep_hidden_count;
+	goffset deep_size;
+} NemoFileExtras;
+
+typedef struct {
+	GQuark attribute_q;
+	char *value;
+} NemoFileFormattedAttribute;
+
 struct NemoFileDetails
 {
 	NemoDirectory *directory;
@@ -63,6 +97,9 @@ struct NemoFileDetails
 
 	eel_ref_str display_name;
 	char *display_name_collation_key;
+	/* The first bytes of the collation key, big-endian, so most
+	 * comparisons never have to read the key itself */
+	guint64 collation_key_prefix;
 	eel_ref_str edit_name;
 
 	goffset size; /* -1 is unknown */
@@ -92,12 +129,6 @@ struct NemoFileDetails
 	
 	guint directory_count;
 
-	guint deep_directory_count;
-	guint deep_file_count;
-	guint deep_unreadable_count;
-    guint deep_hidden_count;
-	goffset deep_size;
-
 	GIcon *icon;
 	
 	char *thumbnail_path;
@@ -106,7 +137,6 @@ struct NemoFileDetails
 
     guint thumbnail_try_count;
 
-	GList *mime_list; /* If this is a directory, the list of MIME types in it. */
 	char *top_left_text;
 
 	/* Info you might get from a link (.desktop, .directory or nemo link) */
@@ -118,30 +148,30 @@ struct NemoFileDetails
 	 */
 	eel_ref_str filesystem_id;
 
-	char *trash_orig_path;
-
-	/* The following is for file operations in progress. Since
-	 * there are normally only a few of these, we can move them to
-	 * a separate hash table or something if required to keep the
-	 * file objects small.
-	 */
-	GList *operations_in_progress;
-
 	/* NemoInfoProviders that need to be run for this file */
 	GList *pending_info_providers;
 
-	/* Emblems provided by extensions */
-	GList *extension_emblems;
-	GList *pending_extension_emblems;
-
-	/* Attributes provided by extensions */
-	GHashTable *extension_attributes;
-	GHashTable *pending_extension_attributes;
+	NemoFileExtras *extras;
 
 	GHashTable *metadata;
 
 	/* Mount for mountpoint or the references GMount for a "mountable" */
 	GMount *mount;
+
+	/* Bumped each time the "changed" signal is emitted */
+	guint change_serial;
+
+	/* Display strings lent out by
+	 * nemo_file_peek_string_attribute_with_default_q. They are
+	 * dropped once change_serial moves on. */
+	NemoFileFormattedAttribute *formatted_attributes;
+	guint n_formatted_attributes;
+	guint formatted_attributes_serial;
+	guint formatted_attributes_generation;
+
+	/* Bumped each time extension info is invalidated, so answers
+	 * to an older request can be told apart */
+	guint extension_info_serial;
 	
 	/* boolean fields: bitfield to save space, since there can be
            many NemoFile objects. */
@@ -190,6 +220,9 @@ struct NemoFileDetails
 	
 	eel_boolean_bit is_thumbnailing               : 1;
 
+	/* Waiting in the queue of files whose extension info changed */
+	eel_boolean_bit extension_change_queued       : 1;
+
 	/* TRUE if the file is open in a spatial window */
 	eel_boolean_bit has_open_window               : 1;
 
@@ -222,8 +255,6 @@ struct NemoFileDetails
 	eel_boolean_bit filesystem_use_preview        : 2; /* GFilesystemPreviewType */
 	eel_boolean_bit filesystem_info_is_up_to_date : 1;
 
-	time_t trash_time; /* 0 is unknown */
-
 	guint64 free_space; /* (guint)-1 for unknown */
 	time_t free_space_read; /* The time free_space was updated, or 0 for never */
 };
@@ -256,6 +287,13 @@ void          nemo_file_updated_deep_count_in_progress (NemoFile           *file
 
 
 void          nemo_file_clear_info                     (NemoFile           *file);
+NemoFileExtras *nemo_file_get_extras                   (NemoFile           *file);
+const NemoFileExtras *nemo_file_peek_extras            (NemoFile           *file);
+/* Does the parts of reading info into a file that don't need the file,
+ * such as computing the collation key, ahead of time. Can be called from
+ * any thread, as long as nothing else uses info meanwhile.
+ */
+void          nemo_file_prepare_info                   (GFileInfo              *info);
 /* Compare file's state with a fresh file info struct, return FALSE if
  * no change, update file and return TRUE if the file info contains
  * new state.  */
@@ -265,6 +303,10 @@ gboolean      nemo_file_update_name                    (NemoFile           *file
 							    const char             *name);
 gboolean      nemo_file_update_metadata_from_info      (NemoFile           *file,
 							    GFileInfo              *info);
+gboolean      nemo_file_update_metadata_value          (NemoFile           *file,
+							    const char             *key,
+							    gboolean                is_list,
+							    gconstpointer           value);
 
 gboolean      nemo_file_update_name_and_directory      (NemoFile           *file,
 							    const char             *name,
@@ -25,6 +25,7 @@
 #include <config.h>
 #include "nemo-file.h"
 
+#include "nemo-column-utilities.h"
 #include "nemo-directory-notify.h"
 #include "nemo-directory-private.h"
 #include "nemo-signaller.h"
@@ -59,6 +60,7 @@
 #include <gio/gio.h>
 #include <glib.h>
 #include <libnemo-extension/nemo-file-info.h>
+#include <libnemo-extension/nemo-column-provider.h>
 #include <libnemo-extension/nemo-extension-private.h>
 #include <libxml/parser.h>
 #include <pwd.h>
@@ -192,12 +194,70 @@ nemo_file_constructor (GType                  type,
   return object;
 }
 
-gboolean
-nemo_file_set_display_name (NemoFile *file,
-				const char *display_name,
-				const char *edit_name,
-				gboolean custom)
+/* Collation keys are copied into the arena of the file's directory,
+ * rather than each being a separate allocation.
+ */
+static NemoStringArena *
+get_string_arena (NemoFile *file)
+{
+	static NemoStringArena *fallback_arena = NULL;
+
+	if (file->details->directory != NULL) {
+		return file->details->directory->details->string_arena;
+	}
+
+	if (fallback_arena == NULL) {
+		fallback_arena = nemo_string_arena_new ();
+	}
+	return fallback_arena;
+}
+
+/* Packs the start of key so that comparing two prefixes as numbers
+ * orders them the way strcmp orders the keys.
+ */
+static guint64
+get_collation_key_prefix (const char *collation_key)
+{
+	guint64 prefix;
+	int i;
+
+	prefix = 0;
+	for (i = 0; i < (int) sizeof (prefix); i++) {
+		prefix <<= 8;
+		if (collation_key != NULL && *collation_key != 0) {
+			prefix |= (guchar) *collation_key++;
+		}
+	}
+
+	return prefix;
+}
+
+/* collation_key may be the file's current key */
+static void
+set_collation_key (NemoFile *file,
+		   const char *collation_key)
+{
+	char *old_key;
+
+	old_key = file->details->display_name_collation_key;
+	file->details->display_name_collation_key =
+		nemo_string_arena_strdup (get_string_arena (file), collation_key);
+	file->details->collation_key_prefix = get_collation_key_prefix (collation_key);
+	nemo_string_arena_release (old_key);
+}
+
+/* collation_key, if not NULL, is the already computed key for
+ * display_name.
+ */
+static gboolean
+set_display_name_internal (NemoFile *file,
+			   const char *display_name,
+			   const char *edit_name,
+			   gboolean custom,
+			   const char *collation_key)
 {
+	char *computed_key;
+
 	gboolean changed;
 
 	if (custom && display_name == NULL) {
@@ -236,8 +296,13 @@ nemo_file_set_display_name (NemoFile *file,
 			file->details->display_name = eel_ref_str_new (display_name);
 		}
 		
-		g_free (file->details->display_name_collation_key);
-		file->details->display_name_collation_key = g_utf8_collate_key_for_filename (display_name, -1);
+		if (collation_key != NULL) {
+			set_collation_key (file, collation_key);
+		} else {
+			computed_key = g_utf8_collate_key_for_filename (display_name, -1);
+			set_collation_key (file, computed_key);
+			g_free (computed_key);
+		}
 	}
 
 	if (g_strcmp0 (eel_ref_str_peek (file->details->edit_name), edit_name) != 0) {
@@ -255,13 +320,23 @@ nemo_file_set_display_name (NemoFile *file,
 	return changed;
 }
 
+gboolean
+nemo_file_set_display_name (NemoFile *file,
+				const char *display_name,
+				const char *edit_name,
+				gboolean custom)
+{
+	return set_display_name_internal (file, display_name, edit_name, custom, NULL);
+}
+
 static void
 nemo_file_clear_display_name (NemoFile *file)
 {
 	eel_ref_str_unref (file->details->display_name);
 	file->details->display_name = NULL;
-	g_free (file->details->display_name_collation_key);
+	nemo_string_arena_release (file->details->display_name_collation_key);
 	file->details->display_name_collation_key = NULL;
+	file->details->collation_key_prefix = 0;
 	eel_ref_str_unref (file->details->edit_name);
 	file->details->edit_name = NULL;
 }
@@ -409,6 +484,124 @@ nemo_file_update_metadata_from_info (NemoFile *file,
 	return changed;
 }
 
+/* Sets a single metadata key as it was written, without reading the
+ * file's metadata back. A NULL value removes the key. Returns TRUE if
+ * the stored value changed.
+ */
+gboolean
+nemo_file_update_metadata_value (NemoFile *file,
+				 const char *key,
+				 gboolean is_list,
+				 gconstpointer value)
+{
+	gpointer old_value;
+	guint id;
+
+	id = nemo_metadata_get_id (key);
+	if (id == 0) {
+		return FALSE;
+	}
+	if (is_list) {
+		id |= METADATA_ID_IS_LIST_MASK;
+	}
+
+	old_value = file->details->metadata != NULL ?
+		g_hash_table_lookup (file->details->metadata, GUINT_TO_POINTER (id)) : NULL;
+
+	if (value == NULL) {
+		if (old_value == NULL) {
+			return FALSE;
+		}
+		g_hash_table_remove (file->details->metadata, GUINT_TO_POINTER (id));
+		foreach_metadata_free (GUINT_TO_POINTER (id), old_value, NULL);
+		return TRUE;
+	}
+
+	if (old_value != NULL &&
+	    (is_list ?
+	     eel_g_strv_equal ((char **) old_value, (char **) value) :
+	     strcmp ((char *) old_value, (char *) value) == 0)) {
+		return FALSE;
+	}
+
+	if (file->details->metadata == NULL) {
+		file->details->metadata = g_hash_table_new (NULL, NULL);
+	}
+
+	/* Replacing doesn't free the old value, the hash has no destroy
+	 * functions.
+	 */
+	g_hash_table_insert (file->details->metadata, GUINT_TO_POINTER (id),
+			     is_list ?
+			     (gpointer) g_strdupv ((char **) value) :
+			     (gpointer) g_strdup ((char *) value));
+	if (old_value != NULL) {
+		foreach_metadata_free (GUINT_TO_POINTER (id), old_value, NULL);
+	}
+
+	return TRUE;
+}
+
+NemoFileExtras *
+nemo_file_get_extras (NemoFile *file)
+{
+	if (file->details->extras == NULL) {
+		file->details->extras = g_slice_new0 (NemoFileExtras);
+	}
+
+	return file->details->extras;
+}
+
+const NemoFileExtras *
+nemo_file_peek_extras (NemoFile *file)
+{
+	static const NemoFileExtras no_extras;
+
+	if (file->details->extras == NULL) {
+		return &no_extras;
+	}
+
+	return file->details->extras;
+}
+
+static void
+extras_free (NemoFileExtras *extras)
+{
+	if (extras == NULL) {
+		return;
+	}
+
+	g_assert (extras->operations_in_progress == NULL);
+
+	g_list_free_full (extras->extension_emblems, g_free);
+	g_list_free_full (extras->pending_extension_emblems, g_free);
+
+	if (extras->extension_attributes) {
+		g_hash_table_destroy (extras->extension_attributes);
+	}
+	if (extras->pending_extension_attributes) {
+		g_hash_table_destroy (extras->pending_extension_attributes);
+	}
+
+	g_list_free_full (extras->mime_list, g_free);
+	g_free (extras->trash_orig_path);
+
+	g_slice_free (NemoFileExtras, extras);
+}
+
+static void
+clear_formatted_attributes (NemoFile *file)
+{
+	guint i;
+
+	for (i = 0; i < file->details->n_formatted_attributes; i++) {
+		g_free (file->details->formatted_attributes[i].value);
+	}
+	g_free (file->details->formatted_attributes);
+	file->details->formatted_attributes = NULL;
+	file->details->n_formatted_attributes = 0;
+}
+
 void
 nemo_file_clear_info (NemoFile *file)
 {
@@ -471,7 +664,9 @@ nemo_file_clear_info (NemoFile *file)
 	file->details->mtime = 0;
 	file->details->atime = 0;
 	file->details->ctime = 0;
-	file->details->trash_time = 0;
+	if (file->details->extras != NULL) {
+		file->details->extras->trash_time = 0;
+	}
 	g_free (file->details->symlink_name);
 	file->details->symlink_name = NULL;
 	eel_ref_str_unref (file->details->mime_type);
@@ -760,7 +955,7 @@ finalize (GObject *object)
 
 	file = NEMO_FILE (object);
 
-	g_assert (file->details->operations_in_progress == NULL);
+	g_assert (nemo_file_peek_extras (file)->operations_in_progress == NULL);
 
 	if (file->details->is_thumbnailing) {
 		uri = nemo_file_get_uri (file);
@@ -789,7 +984,7 @@ finalize (GObject *object)
 	nemo_directory_unref (directory);
 	eel_ref_str_unref (file->details->name);
 	eel_ref_str_unref (file->details->display_name);
-	g_free (file->details->display_name_collation_key);
+	nemo_string_arena_release (file->details->display_name_collation_key);
 	eel_ref_str_unref (file->details->edit_name);
 	if (file->details->icon) {
 		g_object_unref (file->details->icon);
@@ -815,20 +1010,12 @@ finalize (GObject *object)
 	}
 
 	eel_ref_str_unref (file->details->filesystem_id);
-	g_free (file->details->trash_orig_path);
 
-	g_list_free_full (file->details->mime_list, g_free);
-	g_list_free_full (file->details->pending_extension_emblems, g_free);
-	g_list_free_full (file->details->extension_emblems, g_free);
 	g_list_free_full (file->details->pending_info_providers, g_object_unref);
 
-	if (file->details->pending_extension_attributes) {
-		g_hash_table_destroy (file->details->pending_extension_attributes);
-	}
-	
-	if (file->details->extension_attributes) {
-		g_hash_table_destroy (file->details->extension_attributes);
-	}
+	clear_formatted_attributes (file);
+
+	extras_free (file->details->extras);
 
 	if (file->details->metadata) {
 		metadata_hash_free (file->details->metadata);
@@ -1652,6 +1839,7 @@ nemo_file_operation_new (NemoFile *file,
 			     gpointer callback_data)
 {
 	NemoFileOperation *op;
+	NemoFileExtras *extras;
 
 	op = g_new0 (NemoFileOperation, 1);
 	op->file = nemo_file_ref (file);
@@ -1659,8 +1847,9 @@ nemo_file_operation_new (NemoFile *file,
 	op->callback_data = callback_data;
 	op->cancellable = g_cancellable_new ();
 
-	op->file->details->operations_in_progress = g_list_prepend
-		(op->file->details->operations_in_progress, op);
+	extras = nemo_file_get_extras (op->file);
+	extras->operations_in_progress = g_list_prepend
+		(extras->operations_in_progress, op);
 
 	return op;
 }
@@ -1668,8 +1857,11 @@ nemo_file_operation_new (NemoFile *file,
 static void
 nemo_file_operation_remove (NemoFileOperation *op)
 {
-	op->file->details->operations_in_progress = g_list_remove
-		(op->file->details->operations_in_progress, op);
+	NemoFileExtras *extras;
+
+	extras = nemo_file_get_extras (op->file);
+	extras->operations_in_progress = g_list_remove
+		(extras->operations_in_progress, op);
 }
 
 void
@@ -1989,7 +2181,7 @@ nemo_file_rename_in_progress (NemoFile *file)
 	GList *node;
 	NemoFileOperation *op;
 
-	for (node = file->details->operations_in_progress; node != NULL; node = node->next) {
+	for (node = nemo_file_peek_extras (file)->operations_in_progress; node != NULL; node = node->next) {
 		op = node->data;
 		if (op->is_rename) {
 			return TRUE;
@@ -2006,7 +2198,7 @@ nemo_file_cancel (NemoFile *file,
 	GList *node, *next;
 	NemoFileOperation *op;
 
-	for (node = file->details->operations_in_progress; node != NULL; node = next) {
+	for (node = nemo_file_peek_extras (file)->operations_in_progress; node != NULL; node = next) {
 		next = node->next;
 		op = node->data;
 
@@ -2103,11 +2295,121 @@ update_links_if_target (NemoFile *target_file)
 	nemo_file_list_free (link_files);
 }
 
+/* What nemo_file_prepare_info works out, kept on the GFileInfo */
+typedef struct {
+	char *display_name;
+	char *display_name_collation_key;
+	eel_ref_str mime_type;
+	eel_ref_str owner;
+	eel_ref_str owner_real;
+	eel_ref_str group;
+} PreparedInfo;
+
+static GQuark
+prepared_info_quark (void)
+{
+	static GQuark quark = 0;
+
+	if (G_UNLIKELY (quark == 0)) {
+		quark = g_quark_from_static_string ("nemo-file-prepared-info");
+	}
+
+	return quark;
+}
+
+static void
+prepared_info_free (PreparedInfo *prepared)
+{
+	g_free (prepared->display_name);
+	g_free (prepared->display_name_collation_key);
+	eel_ref_str_unref (prepared->mime_type);
+	eel_ref_str_unref (prepared->owner);
+	eel_ref_str_unref (prepared->owner_real);
+	eel_ref_str_unref (prepared->group);
+	g_slice_free (PreparedInfo, prepared);
+}
+
+/* The owner and group as update_info_internal reads them, falling back
+ * to the numeric ids.
+ */
+static char *
+get_info_owner (GFileInfo *info)
+{
+	const char *owner;
+
+	owner = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_USER);
+	if (owner == NULL && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_UID)) {
+		return g_strdup_printf ("%d", g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_UID));
+	}
+
+	return g_strdup (owner);
+}
+
+static char *
+get_info_group (GFileInfo *info)
+{
+	const char *group;
+
+	group = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_GROUP);
+	if (group == NULL && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_GID)) {
+		return g_strdup_printf ("%d", g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_GID));
+	}
+
+	return g_strdup (group);
+}
+
+void
+nemo_file_prepare_info (GFileInfo *info)
+{
+	PreparedInfo *prepared;
+	const char *display_name;
+	char *owner, *group;
+
+	prepared = g_slice_new0 (PreparedInfo);
+
+	display_name = g_file_info_get_display_name (info);
+	if (display_name != NULL && *display_name != 0) {
+		prepared->display_name = g_strdup (display_name);
+		prepared->display_name_collation_key = g_utf8_collate_key_for_filename (display_name, -1);
+	}
+
+	/* Interning takes a lock, which is better taken here than on
+	 * the main thread.
+	 */
+	prepared->mime_type = eel_ref_str_get_unique (g_file_info_get_content_type (info));
+
+	owner = get_info_owner (info);
+	prepared->owner = eel_ref_str_get_unique (owner);
+	g_free (owner);
+
+	prepared->owner_real = eel_ref_str_get_unique
+		(g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_OWNER_USER_REAL));
+
+	group = get_info_group (info);
+	prepared->group = eel_ref_str_get_unique (group);
+	g_free (group);
+
+	g_object_set_qdata_full (G_OBJECT (info), prepared_info_quark (),
+				 prepared, (GDestroyNotify) prepared_info_free);
+}
+
+/* Returns the prepared string if it is the one wanted, else interns it */
+static eel_ref_str
+get_unique_prepared (eel_ref_str prepared, const char *string)
+{
+	if (prepared != NULL && g_strcmp0 (eel_ref_str_peek (prepared), string) == 0) {
+		return eel_ref_str_ref (prepared);
+	}
+
+	return eel_ref_str_get_unique (string);
+}
+
 static gboolean
 update_info_internal (NemoFile *file,
 		      GFileInfo *info,
 		      gboolean update_name)
 {
+	PreparedInfo *prepared;
 	GList *node;
 	gboolean changed;
 	gboolean is_symlink, is_hidden, is_mountpoint;
@@ -2134,6 +2436,7 @@ update_info_internal (NemoFile *file,
 	const char *trash_orig_path;
 	const char *group, *owner, *owner_real;
 	gboolean free_owner, free_group;
+	NemoFileExtras *extras;
 	
 	if (file->details->is_gone) {
 		return FALSE;
@@ -2159,10 +2462,16 @@ update_info_internal (NemoFile *file,
 	}
 	file->details->got_file_info = TRUE;
 
-	changed |= nemo_file_set_display_name (file,
-						  g_file_info_get_display_name (info),
-						  g_file_info_get_edit_name (info),
-						  FALSE);
+	prepared = g_object_get_qdata (G_OBJECT (info), prepared_info_quark ());
+
+	changed |= set_display_name_internal (file,
+					      g_file_info_get_display_name (info),
+					      g_file_info_get_edit_name (info),
+					      FALSE,
+					      prepared != NULL &&
+					      g_strcmp0 (prepared->display_name,
+							 g_file_info_get_display_name (info)) == 0 ?
+					      prepared->display_name_collation_key : NULL);
 	
 	file_type = g_file_info_get_file_type (info);
 	if (file->details->type != file_type) {
@@ -2363,19 +2672,19 @@ update_info_internal (NemoFile *file,
 	if (g_strcmp0 (eel_ref_str_peek (file->details->owner), owner) != 0) {
 		changed = TRUE;
 		eel_ref_str_unref (file->details->owner);
-		file->details->owner = eel_ref_str_get_unique (owner);
+		file->details->owner = get_unique_prepared (prepared ? prepared->owner : NULL, owner);
 	}
 	
 	if (g_strcmp0 (eel_ref_str_peek (file->details->owner_real), owner_real) != 0) {
 		changed = TRUE;
 		eel_ref_str_unref (file->details->owner_real);
-		file->details->owner_real = eel_ref_str_get_unique (owner_real);
+		file->details->owner_real = get_unique_prepared (prepared ? prepared->owner_real : NULL, owner_real);
 	}
 	
 	if (g_strcmp0 (eel_ref_str_peek (file->details->group), group) != 0) {
 		changed = TRUE;
 		eel_ref_str_unref (file->details->group);
-		file->details->group = eel_ref_str_get_unique (group);
+		file->details->group = get_unique_prepared (prepared ? prepared->group : NULL, group);
 	}
 
 	if (free_owner) {
@@ -2457,7 +2766,7 @@ update_info_internal (NemoFile *file,
 	if (g_strcmp0 (eel_ref_str_peek (file->details->mime_type), mime_type) != 0) {
 		changed = TRUE;
 		eel_ref_str_unref (file->details->mime_type);
-		file->details->mime_type = eel_ref_str_get_unique (mime_type);
+		file->details->mime_type = get_unique_prepared (prepared ? prepared->mime_type : NULL, mime_type);
 	}
 	
 	selinux_context = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT);
@@ -2487,16 +2796,17 @@ update_info_internal (NemoFile *file,
 		g_time_val_from_iso8601 (time_string, &g_trash_time);
 		trash_time = g_trash_time.tv_sec;
 	}
-	if (file->details->trash_time != trash_time) {
+	if (nemo_file_peek_extras (file)->trash_time != trash_time) {
 		changed = TRUE;
-		file->details->trash_time = trash_time;
+		nemo_file_get_extras (file)->trash_time = trash_time;
 	}
 
 	trash_orig_path = g_file_info_get_attribute_byte_string (info, "trash::orig-path");
-	if (g_strcmp0 (file->details->trash_orig_path, trash_orig_path) != 0) {
+	if (g_strcmp0 (nemo_file_peek_extras (file)->trash_orig_path, trash_orig_path) != 0) {
 		changed = TRUE;
-		g_free (file->details->trash_orig_path);
-		file->details->trash_orig_path = g_strdup (trash_orig_path);
+		extras = nemo_file_get_extras (file);
+		g_free (extras->trash_orig_path);
+		extras->trash_orig_path = g_strdup (trash_orig_path);
 	}
 
 	changed |=
@@ -2645,6 +2955,11 @@ nemo_file_update_name_and_directory (NemoFile *file,
 	file->details->directory = nemo_directory_ref (new_directory);
 	nemo_directory_unref (old_directory);
 
+	/* Let the old directory's arena go */
+	if (file->details->display_name_collation_key != NULL) {
+		set_collation_key (file, file->details->display_name_collation_key);
+	}
+
 	if (name) {
 		update_name_internal (file, name, FALSE);
 	}
@@ -2746,7 +3061,7 @@ get_time (NemoFile *file,
 		time = file->details->atime;
 		break;
 	case NEMO_DATE_TYPE_TRASHED:
-		time = file->details->trash_time;
+		time = nemo_file_peek_extras (file)->trash_time;
 		break;
 	default:
 		g_assert_not_reached ();
@@ -2901,7 +3216,10 @@ compare_by_display_name (NemoFile *file_1, NemoFile *file_2)
             compare = +1;
         else if (!name_1 && name_2)
             compare = -1;
-    } else {
+    } else if (file_1->details->collation_key_prefix != file_2->details->collation_key_prefix) {
+		compare = file_1->details->collation_key_prefix < file_2->details->collation_key_prefix ? -1 : +1;
+	} else {
+		/* Only ties on the prefix need the whole key */
 		key_1 = nemo_file_peek_display_name_collation_key (file_1);
 		key_2 = nemo_file_peek_display_name_collation_key (file_2);
 		compare = g_strcmp0 (key_1, key_2);
@@ -4366,6 +4684,14 @@ nemo_file_get_icon (NemoFile *file,
 	}
 }
 
+guint
+nemo_file_get_change_serial (NemoFile *file)
+{
+	g_return_val_if_fail (NEMO_IS_FILE (file), 0);
+
+	return file->details->change_serial;
+}
+
 GdkPixbuf *
 nemo_file_get_icon_pixbuf (NemoFile *file,
 			       int size,
@@ -4644,7 +4970,7 @@ nemo_file_get_trash_original_file_parent_as_string (NemoFile *file)
 	GFile *location;
 	char *filename;
 
-	if (file->details->trash_orig_path != NULL) {
+	if (nemo_file_peek_extras (file)->trash_orig_path != NULL) {
 		orig_file = nemo_file_get_trash_original_file (file);
 		parent = nemo_file_get_parent (orig_file);
 		location = nemo_file_get_location (parent);
@@ -4935,7 +5261,7 @@ nemo_file_get_directory_item_mime_types (NemoFile *file,
 		return FALSE;
 	}
 
-	*mime_list = eel_g_str_list_copy (file->details->mime_list);
+	*mime_list = eel_g_str_list_copy (nemo_file_peek_extras (file)->mime_list);
 	return TRUE;
 }
 
@@ -6146,6 +6472,7 @@ nemo_file_get_deep_directory_count_as_string (NemoFile *file)
 char *
 nemo_file_get_string_attribute_q (NemoFile *file, GQuark attribute_q)
 {
+	const NemoFileExtras *extras;
 	char *extension_attribute;
 
 	if (attribute_q == attribute_name_q) {
@@ -6233,14 +6560,15 @@ nemo_file_get_string_attribute_q (NemoFile *file, GQuark attribute_q)
 	}
 
 	extension_attribute = NULL;
+	extras = nemo_file_peek_extras (file);
 	
-	if (file->details->pending_extension_attributes) {
-		extension_attribute = g_hash_table_lookup (file->details->pending_extension_attributes,
+	if (extras->pending_extension_attributes) {
+		extension_attribute = g_hash_table_lookup (extras->pending_extension_attributes,
 							   GINT_TO_POINTER (attribute_q));
 	} 
 
-	if (extension_attribute == NULL && file->details->extension_attributes) {
-		extension_attribute = g_hash_table_lookup (file->details->extension_attributes,
+	if (extension_attribute == NULL && extras->extension_attributes) {
+		extension_attribute = g_hash_table_lookup (extras->extension_attributes,
 							   GINT_TO_POINTER (attribute_q));
 	}
 		
@@ -6254,6 +6582,39 @@ nemo_file_get_string_attribute (NemoFile *file, const char *attribute_name)
 }
 
 
+/* The attributes shown by extension columns, as quarks */
+static GHashTable *extension_column_attributes = NULL;
+
+static void
+column_provider_added (gpointer data,
+		       gpointer user_data)
+{
+	GList *columns, *l;
+	GQuark attribute_q;
+
+	columns = nemo_column_provider_get_columns (NEMO_COLUMN_PROVIDER (data));
+	for (l = columns; l != NULL; l = l->next) {
+		g_object_get (l->data, "attribute_q", &attribute_q, NULL);
+		g_hash_table_insert (extension_column_attributes,
+				     GUINT_TO_POINTER (attribute_q),
+				     GUINT_TO_POINTER (attribute_q));
+	}
+	nemo_column_list_free (columns);
+}
+
+static gboolean
+is_extension_column_attribute (GQuark attribute_q)
+{
+	if (extension_column_attributes == NULL) {
+		extension_column_attributes = g_hash_table_new (NULL, NULL);
+		nemo_module_watch_extensions_for_type (NEMO_TYPE_COLUMN_PROVIDER,
+						       column_provider_added, NULL);
+	}
+
+	return g_hash_table_lookup (extension_column_attributes,
+				    GUINT_TO_POINTER (attribute_q)) != NULL;
+}
+
 /**
  * nemo_file_get_string_attribute_with_default:
  * 
@@ -6329,6 +6690,11 @@ nemo_file_get_string_attribute_with_default_q (NemoFile *file, GQuark attribute_
 		/* If n/a */
 		return g_strdup ("");
 	}
+	if (is_extension_column_attribute (attribute_q) &&
+	    nemo_directory_is_getting_extension_info (file->details->directory, file)) {
+		/* Not in yet */
+		return g_strdup ("...");
+	}
 	
 	/* Fallback, use for both unknown attributes and attributes
 	 * for which we have no more appropriate default.
@@ -6342,6 +6708,84 @@ nemo_file_get_string_attribute_with_default (NemoFile *file, const char *attribu
 	return nemo_file_get_string_attribute_with_default_q (file, g_quark_from_string (attribute_name));
 }
 
+/* Informal dates read "today" and "yesterday", so every cached string
+ * is thrown away when the day changes.
+ */
+static guint formatted_attributes_generation = 0;
+static time_t formatted_attributes_expiry = 0;
+
+static void
+check_formatted_attributes_expiry (void)
+{
+	time_t now;
+	struct tm *midnight;
+
+	now = time (NULL);
+	if (now < formatted_attributes_expiry) {
+		return;
+	}
+
+	formatted_attributes_generation++;
+
+	midnight = localtime (&now);
+	midnight->tm_sec = 0;
+	midnight->tm_min = 0;
+	midnight->tm_hour = 0;
+	midnight->tm_mday++;
+	midnight->tm_isdst = -1;
+	formatted_attributes_expiry = mktime (midnight);
+}
+
+/**
+ * nemo_file_peek_string_attribute_with_default_q:
+ * 
+ * Get the same string as nemo_file_get_string_attribute_with_default_q,
+ * without allocating. Strings are formatted once and kept with the
+ * file, which is what cell renderers redrawing the same rows want.
+ * 
+ * @file: NemoFile representing the file in question.
+ * @attribute_q: The quark of the desired attribute.
+ * 
+ * Returns: A string owned by @file. Copy it if it has to outlive the
+ * next change to @file.
+ * 
+ **/
+const char *
+nemo_file_peek_string_attribute_with_default_q (NemoFile *file, GQuark attribute_q)
+{
+	NemoFileFormattedAttribute *formatted;
+	guint i;
+
+	g_return_val_if_fail (NEMO_IS_FILE (file), NULL);
+
+	check_formatted_attributes_expiry ();
+
+	if (file->details->formatted_attributes_serial != file->details->change_serial ||
+	    file->details->formatted_attributes_generation != formatted_attributes_generation) {
+		clear_formatted_attributes (file);
+		file->details->formatted_attributes_serial = file->details->change_serial;
+		file->details->formatted_attributes_generation = formatted_attributes_generation;
+	}
+
+	for (i = 0; i < file->details->n_formatted_attributes; i++) {
+		formatted = &file->details->formatted_attributes[i];
+		if (formatted->attribute_q == attribute_q) {
+			return formatted->value;
+		}
+	}
+
+	/* Only the columns on show end up here, so the array stays short */
+	file->details->formatted_attributes =
+		g_renew (NemoFileFormattedAttribute,
+			 file->details->formatted_attributes,
+			 file->details->n_formatted_attributes + 1);
+	formatted = &file->details->formatted_attributes[file->details->n_formatted_attributes++];
+	formatted->attribute_q = attribute_q;
+	formatted->value = nemo_file_get_string_attribute_with_default_q (file, attribute_q);
+
+	return formatted->value;
+}
+
 gboolean
 nemo_file_is_date_sort_attribute_q (GQuark attribute_q)
 {
@@ -6741,8 +7185,8 @@ nemo_file_get_keywords (NemoFile *file)
 
 	g_return_val_if_fail (NEMO_IS_FILE (file), NULL);
 
-	keywords = eel_g_str_list_copy (file->details->extension_emblems);
-	keywords = g_list_concat (keywords, eel_g_str_list_copy (file->details->pending_extension_emblems));
+	keywords = eel_g_str_list_copy (nemo_file_peek_extras (file)->extension_emblems);
+	keywords = g_list_concat (keywords, eel_g_str_list_copy (nemo_file_peek_extras (file)->pending_extension_emblems));
 	keywords = g_list_concat (keywords, nemo_file_get_metadata_list (file, NEMO_METADATA_KEY_EMBLEMS));
 
 	return sort_keyword_list_and_remove_duplicates (keywords);
@@ -7252,9 +7696,9 @@ nemo_file_get_trash_original_file (NemoFile *file)
 
 	original_file = NULL;
 
-	if (file->details->trash_orig_path != NULL) {
+	if (nemo_file_peek_extras (file)->trash_orig_path != NULL) {
 		/* file name is stored in URL encoding */
-		filename = g_uri_unescape_string (file->details->trash_orig_path, "");
+		filename = g_uri_unescape_string (nemo_file_peek_extras (file)->trash_orig_path, "");
 		location = g_file_new_for_path (filename);
 		original_file = nemo_file_get (location);
 		g_object_unref (G_OBJECT (location));
@@ -7333,6 +7777,9 @@ nemo_file_updated_deep_count_in_progress (NemoFile *file) {
 	g_assert (NEMO_IS_FILE (file));
 	g_assert (nemo_file_is_directory (file));
 
+	/* Deep counts change without a "changed" signal */
+	clear_formatted_attributes (file);
+
 	/* Send out a signal. */
 	g_signal_emit (file, signals[UPDATED_DEEP_COUNT_IN_PROGRESS], 0, file);
 
@@ -7360,6 +7807,8 @@ nemo_file_emit_changed (NemoFile *file)
 
 	g_assert (NEMO_IS_FILE (file));
 
+	file->details->change_serial++;
+
 	/* Send out a signal. */
 	g_signal_emit (file, signals[CHANGED], 0, file);
 
@@ -7616,6 +8065,8 @@ nemo_file_invalidate_extension_info_internal (NemoFile *file)
 	if (file->details->pending_info_providers)
 		g_list_free_full (file->details->pending_info_providers, g_object_unref);
 
+	file->details->extension_info_serial++;
+
 	file->details->pending_info_providers =
 		nemo_module_get_extensions_for_type (NEMO_TYPE_INFO_PROVIDER);
 }
@@ -7777,7 +8228,7 @@ nemo_file_invalidate_all_attributes (NemoFile *file)
 void
 nemo_file_dump (NemoFile *file)
 {
-	long size = file->details->deep_size;
+	long size = nemo_file_peek_extras (file)->deep_size;
 	char *uri;
 	const char *file_kind;
 
@@ -8413,19 +8864,93 @@ nemo_file_class_init (NemoFileClass *class)
 			  NULL);
 }
 
+/* Extension info tends to arrive for many files in a row. Rather than
+ * a "changed" signal per emblem or attribute, tell views once per
+ * frame: the idle runs at a higher priority than GTK's redraw.
+ */
+static GList *extension_changed_files = NULL;
+static guint extension_changed_idle_id = 0;
+
+static gboolean
+emit_extension_info_changed (gpointer user_data)
+{
+	GList *files, *l, *directories;
+	GHashTable *by_directory;
+	NemoFile *file;
+	NemoDirectory *directory;
+	GList *directory_files;
+
+	extension_changed_idle_id = 0;
+
+	files = g_list_reverse (extension_changed_files);
+	extension_changed_files = NULL;
+
+	by_directory = g_hash_table_new (NULL, NULL);
+
+	for (l = files; l != NULL; l = l->next) {
+		file = l->data;
+		file->details->extension_change_queued = FALSE;
+
+		if (nemo_file_is_self_owned (file)) {
+			nemo_file_emit_changed (file);
+			continue;
+		}
+
+		directory = file->details->directory;
+		directory_files = g_hash_table_lookup (by_directory, directory);
+		g_hash_table_insert (by_directory, directory,
+				     g_list_prepend (directory_files, file));
+	}
+
+	directories = g_hash_table_get_keys (by_directory);
+	for (l = directories; l != NULL; l = l->next) {
+		directory_files = g_list_reverse (g_hash_table_lookup (by_directory, l->data));
+		nemo_directory_emit_change_signals (l->data, directory_files);
+		g_list_free (directory_files);
+	}
+	g_list_free (directories);
+	g_hash_table_destroy (by_directory);
+
+	nemo_file_list_free (files);
+
+	return FALSE;
+}
+
+static void
+queue_extension_info_changed (NemoFile *file)
+{
+	if (file->details->extension_change_queued) {
+		return;
+	}
+
+	file->details->extension_change_queued = TRUE;
+	extension_changed_files = g_list_prepend (extension_changed_files,
+						  nemo_file_ref (file));
+
+	if (extension_changed_idle_id == 0) {
+		extension_changed_idle_id =
+			g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+					 emit_extension_info_changed,
+					 NULL, NULL);
+	}
+}
+
 static void
 nemo_file_add_emblem (NemoFile *file,
 			  const char *emblem_name)
 {
+	NemoFileExtras *extras;
+
+	extras = nemo_file_get_extras (file);
 	if (file->details->pending_info_providers) {
-		file->details->pending_extension_emblems = g_list_prepend (file->details->pending_extension_emblems,
-									   g_strdup (emblem_name));
+		extras->pending_extension_emblems = g_list_prepend (extras->pending_extension_emblems,
+								    g_strdup (emblem_name));
 	} else {
-		file->details->extension_emblems = g_list_prepend (file->details->extension_emblems,
-								   g_strdup (emblem_name));
+		extras->extension_emblems = g_list_prepend (extras->extension_emblems,
+							    g_strdup (emblem_name));
 	}
 
-	nemo_file_changed (file);
+	queue_extension_info_changed (file);
 }
 
 static void
@@ -8433,30 +8958,33 @@ nemo_file_add_string_attribute (NemoFile *file,
 				    const char *attribute_name,
 				    const char *value)
 {
+	NemoFileExtras *extras;
+
+	extras = nemo_file_get_extras (file);
 	if (file->details->pending_info_providers) {
 		/* Lazily create hashtable */
-		if (!file->details->pending_extension_attributes) {
-			file->details->pending_extension_attributes = 
+		if (!extras->pending_extension_attributes) {
+			extras->pending_extension_attributes = 
 				g_hash_table_new_full (g_direct_hash, g_direct_equal,
 						       NULL, 
 						       (GDestroyNotify)g_free);
 		}
-		g_hash_table_insert (file->details->pending_extension_attributes,
+		g_hash_table_insert (extras->pending_extension_attributes,
 				     GINT_TO_POINTER (g_quark_from_string (attribute_name)),
 				     g_strdup (value));
 	} else {
-		if (!file->details->extension_attributes) {
-			file->details->extension_attributes = 
+		if (!extras->extension_attributes) {
+			extras->extension_attributes = 
 				g_hash_table_new_full (g_direct_hash, g_direct_equal,
 						       NULL, 
 						       (GDestroyNotify)g_free);
 		}
-		g_hash_table_insert (file->details->extension_attributes,
+		g_hash_table_insert (extras->extension_attributes,
 				     GINT_TO_POINTER (g_quark_from_string (attribute_name)),
 				     g_strdup (value));
 	}
 
-	nemo_file_changed (file);
+	queue_extension_info_changed (file);
 }
 
 static void
@@ -8468,18 +8996,23 @@ nemo_file_invalidate_extension_info (NemoFile *file)
 void
 nemo_file_info_providers_done (NemoFile *file)
 {
-	g_list_free_full (file->details->extension_emblems, g_free);
-	file->details->extension_emblems = file->details->pending_extension_emblems;
-	file->details->pending_extension_emblems = NULL;
+	NemoFileExtras *extras;
+
+	extras = file->details->extras;
+	if (extras != NULL) {
+		g_list_free_full (extras->extension_emblems, g_free);
+		extras->extension_emblems = extras->pending_extension_emblems;
+		extras->pending_extension_emblems = NULL;
 
-	if (file->details->extension_attributes) {
-		g_hash_table_destroy (file->details->extension_attributes);
+		if (extras->extension_attributes) {
+			g_hash_table_destroy (extras->extension_attributes);
+		}
+
+		extras->extension_attributes = extras->pending_extension_attributes;
+		extras->pending_extension_attributes = NULL;
 	}
-	
-	file->details->extension_attributes = file->details->pending_extension_attributes;
-	file->details->pending_extension_attributes = NULL;
 
-	nemo_file_changed (file);
+	queue_extension_info_changed (file);
 }
 
 static void     
@@ -391,6 +391,10 @@ char *                  nemo_file_get_string_attribute_with_default (NemoFile
 									 const char                     *attribute_name);
 char *                  nemo_file_get_string_attribute_with_default_q (NemoFile                  *file,
 									 GQuark                          attribute_q);
+/* Like nemo_file_get_string_attribute_with_default_q, but the string is
+ * owned by the file and only valid until it next changes. */
+const char *            nemo_file_peek_string_attribute_with_default_q (NemoFile                 *file,
+									 GQuark                          attribute_q);
 char *			nemo_file_fit_modified_date_as_string	(NemoFile 			*file,
 									 int				 width,
 									 NemoWidthMeasureCallback    measure_callback,
@@ -468,6 +472,11 @@ GdkPixbuf *             nemo_file_get_icon_pixbuf                   (NemoFile
                                      int                             scale,
 									 NemoFileIconFlags           flags);
 
+/* Changes each time the file emits "changed", for caching what is
+ * derived from it.
+ */
+guint                   nemo_file_get_change_serial                 (NemoFile                   *file);
+
 gboolean                nemo_file_has_open_window                   (NemoFile                   *file);
 void                    nemo_file_set_has_open_window               (NemoFile                   *file,
 									 gboolean                        has_open_window);
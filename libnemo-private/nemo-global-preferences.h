@@ -234,6 +234,9 @@ typedef enum
 
 #define NEMO_PREFERENCES_DISABLE_MENU_WARNING          "disable-menu-warning"
 
+/* Extensions */
+#define NEMO_PREFERENCES_PRELOAD_EXTENSIONS            "preload-extensions"
+
 void nemo_global_preferences_init                      (void);
 char *nemo_global_preferences_get_default_folder_viewer_preference_as_iid (void);
 gboolean nemo_global_preferences_get_ignore_view_metadata (void);
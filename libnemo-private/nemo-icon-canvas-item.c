@@ -183,6 +183,10 @@ static void     draw_pixbuf                          (GdkPixbuf
 static PangoLayout *get_label_layout                 (PangoLayout                  **layout,
 						      NemoIconCanvasItem        *item,
 						      const char                    *text);
+static PangoLayout *create_label_layout              (NemoIconCanvasItem        *item,
+						      const char                    *text);
+static char *   zeroify_label_text                   (const char                    *text);
+static PangoAlignment get_label_alignment            (NemoIconContainer         *container);
 static gboolean hit_test_stretch_handle              (NemoIconCanvasItem        *item,
 						      EelIRect                       canvas_rect,
 						      GtkCornerType *corner);
@@ -863,6 +867,7 @@ prepare_pango_layout_width (NemoIconCanvasItem *item,
 {
 	if (nemo_icon_canvas_item_get_max_text_width (item) < 0) {
 		pango_layout_set_width (layout, -1);
+		pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_NONE);
 	} else {
 		pango_layout_set_width (layout, floor (nemo_icon_canvas_item_get_max_text_width (item)) * PANGO_SCALE);
 		pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_END);
@@ -920,6 +925,151 @@ prepare_pango_layout_for_draw (NemoIconCanvasItem *item,
 	}
 }
 
+/* Label sizes are shared between all items, keyed by the text and all
+ * layout settings that affect its size. Entries are kept in two
+ * generations; when the current one is full, the older one is dropped,
+ * so labels that are still being measured stay around.
+ */
+#define LABEL_SIZE_CACHE_GENERATION_SIZE 16384
+
+typedef struct {
+	int width;
+	int height;
+	int dx;
+	int height_for_layout;
+} LabelSize;
+
+static GHashTable *label_sizes = NULL;
+static GHashTable *old_label_sizes = NULL;
+
+static GHashTable *
+label_size_table_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+static LabelSize *
+label_size_cache_lookup (const char *key)
+{
+	LabelSize *size;
+	gpointer old_key;
+
+	if (label_sizes == NULL) {
+		label_sizes = label_size_table_new ();
+		old_label_sizes = label_size_table_new ();
+	}
+
+	size = g_hash_table_lookup (label_sizes, key);
+	if (size == NULL &&
+	    g_hash_table_lookup_extended (old_label_sizes, key, &old_key, (gpointer *) &size)) {
+		g_hash_table_steal (old_label_sizes, key);
+		g_hash_table_insert (label_sizes, old_key, size);
+	}
+
+	return size;
+}
+
+static void
+label_size_cache_insert (const char *key,
+			 LabelSize *size)
+{
+	if (g_hash_table_size (label_sizes) >= LABEL_SIZE_CACHE_GENERATION_SIZE) {
+		g_hash_table_destroy (old_label_sizes);
+		old_label_sizes = label_sizes;
+		label_sizes = label_size_table_new ();
+	}
+
+	g_hash_table_insert (label_sizes, g_strdup (key), size);
+}
+
+/* Returns the layout shared by all items of the container for measuring
+ * label text. Measuring with it avoids creating a layout and parsing the
+ * font for each item.
+ */
+static PangoLayout *
+get_label_measure_layout (NemoIconCanvasItem *item)
+{
+	NemoIconContainerDetails *details;
+	PangoContext *context;
+	const cairo_font_options_t *options;
+	char *font;
+
+	details = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas)->details;
+
+	if (details->label_measure_layout == NULL) {
+		details->label_measure_layout = create_label_layout (item, "");
+
+		context = pango_layout_get_context (details->label_measure_layout);
+		options = pango_cairo_context_get_font_options (context);
+		font = pango_font_description_to_string
+			(pango_layout_get_font_description (details->label_measure_layout));
+		details->label_measure_font_key = g_strdup_printf
+			("%s %g %lu", font,
+			 pango_cairo_context_get_resolution (context),
+			 options != NULL ? cairo_font_options_hash (options) : 0);
+		g_free (font);
+	}
+
+	return details->label_measure_layout;
+}
+
+/* Measures text with the shared layout as prepared by the caller, going
+ * through the label size cache. The height for layout is only measured
+ * if max_layout_lines is positive.
+ */
+static void
+measure_label_layout (NemoIconCanvasItem *item,
+		      PangoLayout *layout,
+		      const char *text,
+		      int max_layout_lines,
+		      LabelSize *size)
+{
+	NemoIconContainerDetails *details;
+	static GString *key = NULL;
+	LabelSize *cached;
+	char *zeroified_text;
+
+	details = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas)->details;
+
+	pango_layout_set_alignment (layout, get_label_alignment (NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas)));
+
+	if (key == NULL) {
+		key = g_string_new (NULL);
+	}
+	g_string_printf (key, "%s|%d|%d|%d|%d|%d|%s",
+			 details->label_measure_font_key,
+			 pango_layout_get_width (layout),
+			 pango_layout_get_height (layout),
+			 pango_layout_get_ellipsize (layout),
+			 pango_layout_get_alignment (layout),
+			 max_layout_lines,
+			 text);
+
+	cached = label_size_cache_lookup (key->str);
+	if (cached != NULL) {
+		*size = *cached;
+		return;
+	}
+
+	if (g_strcmp0 (details->label_measure_text, text) != 0) {
+		zeroified_text = zeroify_label_text (text);
+		pango_layout_set_text (layout, zeroified_text, -1);
+		g_free (zeroified_text);
+
+		g_free (details->label_measure_text);
+		details->label_measure_text = g_strdup (text);
+	}
+
+	layout_get_full_size (layout, &size->width, &size->height, &size->dx);
+	size->height_for_layout = size->height;
+	if (max_layout_lines > 0) {
+		layout_get_size_for_layout (layout, max_layout_lines,
+					    size->height, &size->height_for_layout);
+	}
+
+	label_size_cache_insert (key->str, g_memdup (size, sizeof (LabelSize)));
+}
+
 static void
 measure_label_text (NemoIconCanvasItem *item)
 {
@@ -927,8 +1077,8 @@ measure_label_text (NemoIconCanvasItem *item)
 	NemoIconContainer *container;
 	gint editable_height, editable_height_for_layout, editable_height_for_entire_text, editable_width, editable_dx;
 	gint additional_height, additional_width, additional_dx;
-	PangoLayout *editable_layout;
-	PangoLayout *additional_layout;
+	PangoLayout *layout;
+	LabelSize size;
 	gboolean have_editable, have_additional;
 
 	/* check to see if the cached values are still valid; if so, there's
@@ -972,38 +1122,33 @@ measure_label_text (NemoIconCanvasItem *item)
 	additional_dx = 0;
 
 	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);	
-	editable_layout = NULL;
-	additional_layout = NULL;
+	layout = get_label_measure_layout (item);
 
 	if (have_editable) {
 		/* first, measure required text height: editable_height_for_entire_text
 		 * then, measure text height applicable for layout: editable_height_for_layout
 		 * next, measure actually displayed height: editable_height
 		 */
-		editable_layout = get_label_layout (&details->editable_text_layout, item, details->editable_text);
-
-		prepare_pango_layout_for_measure_entire_text (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      NULL,
-				      &editable_height_for_entire_text,
-				      NULL);
-		layout_get_size_for_layout (editable_layout,
-					    nemo_icon_container_get_max_layout_lines (container),
-					    editable_height_for_entire_text,
-					    &editable_height_for_layout);
+		prepare_pango_layout_for_measure_entire_text (item, layout);
+		measure_label_layout (item, layout, details->editable_text,
+				      nemo_icon_container_get_max_layout_lines (container),
+				      &size);
+		editable_height_for_entire_text = size.height;
+		editable_height_for_layout = size.height_for_layout;
 
-		prepare_pango_layout_for_draw (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      &editable_width,
-				      &editable_height,
-				      &editable_dx);
+		prepare_pango_layout_for_draw (item, layout);
+		measure_label_layout (item, layout, details->editable_text, 0, &size);
+		editable_width = size.width;
+		editable_height = size.height;
+		editable_dx = size.dx;
 	}
 
 	if (have_additional) {
-		additional_layout = get_label_layout (&details->additional_text_layout, item, details->additional_text);
-		prepare_pango_layout_for_draw (item, additional_layout);
-		layout_get_full_size (additional_layout,
-				      &additional_width, &additional_height, &additional_dx);
+		prepare_pango_layout_for_draw (item, layout);
+		measure_label_layout (item, layout, details->additional_text, 0, &size);
+		additional_width = size.width;
+		additional_height = size.height;
+		additional_dx = size.dx;
 	}
 
 	details->editable_text_height = editable_height;
@@ -1036,14 +1181,6 @@ measure_label_text (NemoIconCanvasItem *item)
 
 	/* extra to make it look nicer */
 	details->text_width += TEXT_BACK_PADDING_X*2;
-
-	if (editable_layout) {
-		g_object_unref (editable_layout);
-	}
-
-	if (additional_layout) {
-		g_object_unref (additional_layout);
-	}
 }
 
 static void
@@ -1331,31 +1468,134 @@ draw_pixbuf (GdkPixbuf *pixbuf,
         cairo_restore (cr);
 }
 
+/* Surfaces recently made from a pixbuf, with and without highlighting.
+ * Icon pixbufs are shared between items, so hovering or selecting icons
+ * of the same type reuses the highlighted surfaces.
+ */
+#define MAX_CACHED_EFFECT_SURFACES 4
+
+typedef struct {
+	cairo_surface_t *surface;
+	int scale;
+	gboolean spotlight;
+	gboolean colorize;
+	GdkRGBA color;
+} EffectSurface;
+
+typedef struct {
+	EffectSurface entries[MAX_CACHED_EFFECT_SURFACES];
+	int n_entries;
+} EffectSurfaceCache;
+
+static void
+effect_surface_cache_free (gpointer data)
+{
+	EffectSurfaceCache *cache;
+	int i;
+
+	cache = data;
+	for (i = 0; i < cache->n_entries; i++) {
+		cairo_surface_destroy (cache->entries[i].surface);
+	}
+	g_free (cache);
+}
+
+static EffectSurfaceCache *
+get_effect_surface_cache (GdkPixbuf *pixbuf)
+{
+	static GQuark quark = 0;
+	EffectSurfaceCache *cache;
+
+	if (quark == 0) {
+		quark = g_quark_from_static_string ("nemo-icon-canvas-item-effect-surfaces");
+	}
+
+	cache = g_object_get_qdata (G_OBJECT (pixbuf), quark);
+	if (cache == NULL) {
+		cache = g_new0 (EffectSurfaceCache, 1);
+		g_object_set_qdata_full (G_OBJECT (pixbuf), quark,
+					 cache, effect_surface_cache_free);
+	}
+
+	return cache;
+}
+
+/* Returns a new reference to the cached surface, moving it to the front
+ * so the least recently used one is dropped first.
+ */
+static cairo_surface_t *
+effect_surface_cache_lookup (EffectSurfaceCache *cache,
+			     int scale,
+			     gboolean spotlight,
+			     const GdkRGBA *color)
+{
+	EffectSurface entry;
+	int i;
+
+	for (i = 0; i < cache->n_entries; i++) {
+		entry = cache->entries[i];
+
+		if (entry.scale == scale &&
+		    entry.spotlight == spotlight &&
+		    entry.colorize == (color != NULL) &&
+		    (color == NULL || gdk_rgba_equal (&entry.color, color))) {
+			memmove (&cache->entries[1], &cache->entries[0], i * sizeof (EffectSurface));
+			cache->entries[0] = entry;
+
+			return cairo_surface_reference (entry.surface);
+		}
+	}
+
+	return NULL;
+}
+
+static void
+effect_surface_cache_insert (EffectSurfaceCache *cache,
+			     cairo_surface_t *surface,
+			     int scale,
+			     gboolean spotlight,
+			     const GdkRGBA *color)
+{
+	EffectSurface *entry;
+
+	if (cache->n_entries == MAX_CACHED_EFFECT_SURFACES) {
+		cairo_surface_destroy (cache->entries[--cache->n_entries].surface);
+	}
+
+	memmove (&cache->entries[1], &cache->entries[0], cache->n_entries * sizeof (EffectSurface));
+	cache->n_entries++;
+
+	entry = &cache->entries[0];
+	entry->surface = cairo_surface_reference (surface);
+	entry->scale = scale;
+	entry->spotlight = spotlight;
+	entry->colorize = color != NULL;
+	if (color != NULL) {
+		entry->color = *color;
+	}
+}
+
 /* shared code to highlight or dim the passed-in pixbuf */
 static cairo_surface_t *
 real_map_surface (NemoIconCanvasItem *icon_item)
 {
 	EelCanvas *canvas;
-	GdkPixbuf *temp_pixbuf, *old_pixbuf;
 	GtkStyleContext *style;
 	GdkRGBA color;
-    cairo_surface_t *surface;
-	
-	temp_pixbuf = icon_item->details->pixbuf;
-	canvas = EEL_CANVAS_ITEM(icon_item)->canvas;
+	EffectSurfaceCache *cache;
+	cairo_surface_t *surface, *plain_surface;
+	gboolean spotlight, colorize;
+	int scale;
 
-	g_object_ref (temp_pixbuf);
-
-	if (icon_item->details->is_prelit ||
-	    icon_item->details->is_highlighted_for_clipboard) {
-		old_pixbuf = temp_pixbuf;
+	canvas = EEL_CANVAS_ITEM(icon_item)->canvas;
+	scale = gtk_widget_get_scale_factor (GTK_WIDGET (canvas));
 
-		temp_pixbuf = eel_create_spotlight_pixbuf (temp_pixbuf);
-		g_object_unref (old_pixbuf);
-	}
+	spotlight = icon_item->details->is_prelit ||
+		icon_item->details->is_highlighted_for_clipboard;
+	colorize = icon_item->details->is_highlighted_for_selection ||
+		icon_item->details->is_highlighted_for_drop;
 
-	if (icon_item->details->is_highlighted_for_selection
-	    || icon_item->details->is_highlighted_for_drop) {
+	if (colorize) {
 		style = gtk_widget_get_style_context (GTK_WIDGET (canvas));
 
 		if (gtk_widget_has_focus (GTK_WIDGET (canvas))) {
@@ -1363,19 +1603,40 @@ real_map_surface (NemoIconCanvasItem *icon_item)
 		} else {
 			gtk_style_context_get_background_color (style, GTK_STATE_FLAG_ACTIVE, &color);	
 		}
+	}
+
+	cache = get_effect_surface_cache (icon_item->details->pixbuf);
+
+	surface = effect_surface_cache_lookup (cache, scale, spotlight, colorize ? &color : NULL);
+	if (surface != NULL) {
+		return surface;
+	}
 
-		old_pixbuf = temp_pixbuf;
-		temp_pixbuf = eel_create_colorized_pixbuf (temp_pixbuf, &color);
+	plain_surface = effect_surface_cache_lookup (cache, scale, FALSE, NULL);
+	if (plain_surface == NULL) {
+		plain_surface = gdk_cairo_surface_create_from_pixbuf (icon_item->details->pixbuf,
+								      scale,
+								      gtk_widget_get_window (GTK_WIDGET (canvas)));
+		effect_surface_cache_insert (cache, plain_surface, scale, FALSE, NULL);
+	}
+
+	if (!spotlight && !colorize) {
+		return plain_surface;
+	}
 
-		g_object_unref (old_pixbuf);
+	surface = eel_copy_image_surface (plain_surface);
+	cairo_surface_destroy (plain_surface);
+
+	if (spotlight) {
+		eel_spotlight_surface (surface);
+	}
+	if (colorize) {
+		eel_colorize_surface (surface, &color);
 	}
 
-    surface = gdk_cairo_surface_create_from_pixbuf (temp_pixbuf,
-                                                    gtk_widget_get_scale_factor (GTK_WIDGET (canvas)),
-                                                    gtk_widget_get_window (GTK_WIDGET (canvas)));
-    g_object_unref (temp_pixbuf);
+	effect_surface_cache_insert (cache, surface, scale, spotlight, colorize ? &color : NULL);
 
-    return surface;
+	return surface;
 }
 
 static cairo_surface_t *
@@ -1386,7 +1647,7 @@ map_surface (NemoIconCanvasItem *icon_item)
 	      && icon_item->details->rendered_is_highlighted_for_selection == icon_item->details->is_highlighted_for_selection
 	      && icon_item->details->rendered_is_highlighted_for_drop == icon_item->details->is_highlighted_for_drop
 	      && icon_item->details->rendered_is_highlighted_for_clipboard == icon_item->details->is_highlighted_for_clipboard
-	      && (icon_item->details->is_highlighted_for_selection && icon_item->details->rendered_is_focused == gtk_widget_has_focus (GTK_WIDGET (EEL_CANVAS_ITEM (icon_item)->canvas))))) {
+	      && (!icon_item->details->is_highlighted_for_selection || icon_item->details->rendered_is_focused == gtk_widget_has_focus (GTK_WIDGET (EEL_CANVAS_ITEM (icon_item)->canvas))))) {
 		if (icon_item->details->rendered_surface != NULL) {
             cairo_surface_destroy (icon_item->details->rendered_surface);
 		}
@@ -1512,6 +1773,48 @@ nemo_icon_canvas_item_draw (EelCanvasItem *item,
 #define ZERO_WIDTH_SPACE "\xE2\x80\x8B"
 
 
+/* Allows line breaks after '_', '-' and '.' characters, if they are not
+ * followed by a number.
+ */
+static char *
+zeroify_label_text (const char *text)
+{
+	GString *str;
+	const char *p;
+
+	if (text == NULL) {
+		return NULL;
+	}
+
+	str = g_string_new (NULL);
+
+	for (p = text; *p != '\0'; p++) {
+		str = g_string_append_c (str, *p);
+
+		if (*p == '_' || *p == '-' || (*p == '.' && !g_ascii_isdigit(*(p+1)))) {
+			/* Ensure that we allow to break after '_' or '.' characters,
+			 * if they are not followed by a number */
+			str = g_string_append (str, ZERO_WIDTH_SPACE);
+		}
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static PangoAlignment
+get_label_alignment (NemoIconContainer *container)
+{
+	if (container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
+		if (!nemo_icon_container_is_layout_rtl (container)) {
+			return PANGO_ALIGN_LEFT;
+		} else {
+			return PANGO_ALIGN_RIGHT;
+		}
+	} else {
+		return PANGO_ALIGN_CENTER;
+	}
+}
+
 static PangoLayout *
 create_label_layout (NemoIconCanvasItem *item,
 		     const char *text)
@@ -1521,9 +1824,7 @@ create_label_layout (NemoIconCanvasItem *item,
 	PangoFontDescription *desc;
 	NemoIconContainer *container;
 	EelCanvasItem *canvas_item;
-	GString *str;
 	char *zeroified_text;
-	const char *p;
 
 	canvas_item = EEL_CANVAS_ITEM (item);
 
@@ -1531,36 +1832,11 @@ create_label_layout (NemoIconCanvasItem *item,
 	context = gtk_widget_get_pango_context (GTK_WIDGET (canvas_item->canvas));
 	layout = pango_layout_new (context);
 	
-	zeroified_text = NULL;
-
-	if (text != NULL) {
-		str = g_string_new (NULL);
-
-		for (p = text; *p != '\0'; p++) {
-			str = g_string_append_c (str, *p);
-
-			if (*p == '_' || *p == '-' || (*p == '.' && !g_ascii_isdigit(*(p+1)))) {
-				/* Ensure that we allow to break after '_' or '.' characters,
-				 * if they are not followed by a number */
-				str = g_string_append (str, ZERO_WIDTH_SPACE);
-			}
-		}
-
-		zeroified_text = g_string_free (str, FALSE);
-	}
+	zeroified_text = zeroify_label_text (text);
 
 	pango_layout_set_text (layout, zeroified_text, -1);
 	pango_layout_set_auto_dir (layout, FALSE);
-	
-	if (container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
-		if (!nemo_icon_container_is_layout_rtl (container)) {
-			pango_layout_set_alignment (layout, PANGO_ALIGN_LEFT);
-		} else {
-			pango_layout_set_alignment (layout, PANGO_ALIGN_RIGHT);
-		}
-	} else {
-		pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
-	}
+	pango_layout_set_alignment (layout, get_label_alignment (container));
 
 	pango_layout_set_spacing (layout, LABEL_LINE_SPACING);
 	pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
@@ -140,7 +140,8 @@ enum {
 };
 
 typedef struct {
-	GList *selection;
+	GPtrArray *selection;
+	guint selection_serial;
 	char *action_descriptions[LAST_ACTION];
 } NemoIconContainerAccessiblePrivate;
 
@@ -190,6 +191,7 @@ static void          reveal_icon                                    (NemoIconCon
 								     NemoIcon *icon);
 
 static void	     nemo_icon_container_set_rtl_positions (NemoIconContainer *container);
+static void          spatial_index_invalidate                       (NemoIconContainer *container);
 static double	     get_mirror_x_position                     (NemoIconContainer *container,
 								NemoIcon *icon,
 								double x);
@@ -299,6 +301,57 @@ icon_is_positioned (const NemoIcon *icon)
 	return icon->x != ICON_UNPOSITIONED_VALUE && icon->y != ICON_UNPOSITIONED_VALUE;
 }
 
+static void
+invalidate_icon_array (NemoIconContainer *container)
+{
+	container->details->icon_array_valid = FALSE;
+}
+
+static void
+ensure_icon_array (NemoIconContainer *container)
+{
+	NemoIconContainerDetails *details;
+	GList *p;
+	NemoIcon *icon;
+	guint i;
+
+	details = container->details;
+	if (details->icon_array_valid) {
+		return;
+	}
+
+	g_ptr_array_set_size (details->icon_array, 0);
+	for (p = details->icons, i = 0; p != NULL; p = p->next, i++) {
+		icon = p->data;
+		icon->index = i;
+		g_ptr_array_add (details->icon_array, icon);
+	}
+
+	details->icon_array_valid = TRUE;
+}
+
+static NemoIcon *
+get_nth_icon (NemoIconContainer *container,
+	      int n)
+{
+	ensure_icon_array (container);
+
+	if (n < 0 || n >= (int) container->details->icon_array->len) {
+		return NULL;
+	}
+
+	return g_ptr_array_index (container->details->icon_array, n);
+}
+
+static int
+get_icon_index (NemoIconContainer *container,
+		NemoIcon *icon)
+{
+	ensure_icon_array (container);
+
+	return icon->index;
+}
+
 
 /* x, y are the top-left coordinates of the icon. */
 static void
@@ -387,6 +440,8 @@ icon_set_position (NemoIcon *icon,
 
 	icon->x = x;
 	icon->y = y;
+
+	spatial_index_invalidate (container);
 }
 
 static void
@@ -463,6 +518,12 @@ icon_toggle_selected (NemoIconContainer *container,
 	end_renaming_mode (container, TRUE);
 
 	icon->is_selected = !icon->is_selected;
+	if (icon->is_selected) {
+		container->details->n_selected++;
+	} else {
+		container->details->n_selected--;
+	}
+	container->details->selection_serial++;
 	eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
 			     "highlighted_for_selection", (gboolean) icon->is_selected,
 			     NULL);
@@ -859,123 +920,274 @@ clear_keyboard_rubberband_start (NemoIconContainer *container)
 	container->details->keyboard_rubberband_start = NULL;
 }
 
-/* carbon-copy of eel_canvas_group_bounds(), but
- * for NemoIconContainerItems it returns the
- * bounds for the “entire item”.
+/* Spatial index of the icons.
+ *
+ * Icons are filed into a uniform grid of buckets by their bounds, so
+ * rubberbanding and visible area updates only look at the icons close
+ * to the rectangle of interest instead of the whole icon list. The index
+ * is invalidated whenever an icon is added, moved, resized or removed
+ * and rebuilt on the next query.
  */
+
+#define SPATIAL_INDEX_BUCKET_SIZE 128.0
+#define SPATIAL_INDEX_MAX_BUCKETS (512 * 512)
+
 static void
-get_icon_bounds_for_canvas_bounds (EelCanvasGroup *group,
-				   double *x1, double *y1,
-				   double *x2, double *y2,
-				   NemoIconCanvasItemBoundsUsage usage)
+spatial_index_invalidate (NemoIconContainer *container)
 {
-	EelCanvasItem *child;
-	GList *list;
-	double tx1, ty1, tx2, ty2;
-	double minx, miny, maxx, maxy;
-	int set;
+	NemoIconSpatialIndex *index;
 
-	/* Get the bounds of the first visible item */
+	index = &container->details->spatial_index;
+	index->valid = FALSE;
+	memset (index->total_bounds_valid, 0, sizeof (index->total_bounds_valid));
+}
 
-	child = NULL; /* Unnecessary but eliminates a warning. */
+static void
+spatial_index_free (NemoIconSpatialIndex *index)
+{
+	g_free (index->bucket_offsets);
+	index->bucket_offsets = NULL;
+	g_free (index->bucket_icons);
+	index->bucket_icons = NULL;
+	index->num_columns = 0;
+	index->num_rows = 0;
+	index->valid = FALSE;
+}
 
-	set = FALSE;
+static gboolean
+icon_is_indexed (NemoIcon *icon)
+{
+	/* Icons that were not shown yet have never been updated and
+	 * can't be hit by anything.
+	 */
+	return (EEL_CANVAS_ITEM (icon->item)->flags & EEL_CANVAS_ITEM_VISIBLE) != 0;
+}
 
-	for (list = group->item_list; list; list = list->next) {
-		child = list->data;
+static void
+icon_get_index_bounds (NemoIcon *icon,
+		       EelDRect *bounds)
+{
+	EelDRect entire;
 
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child)) {
-			continue;
-		}
+	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+				    &bounds->x0, &bounds->y0,
+				    &bounds->x1, &bounds->y1);
+	nemo_icon_canvas_item_get_bounds_for_entire_item (icon->item,
+							  &entire.x0, &entire.y0,
+							  &entire.x1, &entire.y1);
+	eel_drect_union (bounds, bounds, &entire);
+}
 
-		if (child->flags & EEL_CANVAS_ITEM_VISIBLE) {
-			set = TRUE;
-			if (!NEMO_IS_ICON_CANVAS_ITEM (child) ||
-			    usage == BOUNDS_USAGE_FOR_DISPLAY) {
-				eel_canvas_item_get_bounds (child, &minx, &miny, &maxx, &maxy);
-			} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-				nemo_icon_canvas_item_get_bounds_for_layout (NEMO_ICON_CANVAS_ITEM (child),
-										 &minx, &miny, &maxx, &maxy);
-			} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-				nemo_icon_canvas_item_get_bounds_for_entire_item (NEMO_ICON_CANVAS_ITEM (child),
-										      &minx, &miny, &maxx, &maxy);
-			} else {
-				g_assert_not_reached ();
-			}
-			break;
-		}
+/* Returns FALSE if @rect doesn't touch any bucket. */
+static gboolean
+spatial_index_get_bucket_range (NemoIconSpatialIndex *index,
+				const EelDRect *rect,
+				EelIRect *range)
+{
+	if (index->num_columns == 0 ||
+	    rect->x1 < index->bounds.x0 || rect->x0 > index->bounds.x1 ||
+	    rect->y1 < index->bounds.y0 || rect->y0 > index->bounds.y1) {
+		return FALSE;
 	}
 
-	/* If there were no visible items, return an empty bounding box */
+	range->x0 = floor ((MAX (rect->x0, index->bounds.x0) - index->bounds.x0) / index->bucket_size);
+	range->y0 = floor ((MAX (rect->y0, index->bounds.y0) - index->bounds.y0) / index->bucket_size);
+	range->x1 = floor ((MIN (rect->x1, index->bounds.x1) - index->bounds.x0) / index->bucket_size);
+	range->y1 = floor ((MIN (rect->y1, index->bounds.y1) - index->bounds.y0) / index->bucket_size);
 
-	if (!set) {
-		*x1 = *y1 = *x2 = *y2 = 0.0;
-		return;
-	}
+	range->x0 = CLAMP (range->x0, 0, index->num_columns - 1);
+	range->y0 = CLAMP (range->y0, 0, index->num_rows - 1);
+	range->x1 = CLAMP (range->x1, range->x0, index->num_columns - 1);
+	range->y1 = CLAMP (range->y1, range->y0, index->num_rows - 1);
+
+	return TRUE;
+}
 
-	/* Now we can grow the bounds using the rest of the items */
+static void
+spatial_index_ensure (NemoIconContainer *container)
+{
+	NemoIconSpatialIndex *index;
+	GList *p, *indexed_icons;
+	NemoIcon *icon;
+	EelDRect *icon_bounds;
+	EelIRect range;
+	guint *fill;
+	guint n_icons, n_buckets, i, n;
+	int x, y;
 
-	list = list->next;
+	index = &container->details->spatial_index;
+	if (index->valid) {
+		return;
+	}
 
-	for (; list; list = list->next) {
-		child = list->data;
+	spatial_index_free (index);
+	index->valid = TRUE;
 
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child)) {
-			continue;
+	indexed_icons = NULL;
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+		if (icon_is_indexed (icon)) {
+			indexed_icons = g_list_prepend (indexed_icons, icon);
 		}
+	}
 
-		if (!(child->flags & EEL_CANVAS_ITEM_VISIBLE))
-			continue;
+	if (indexed_icons == NULL) {
+		return;
+	}
 
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child) ||
-		    usage == BOUNDS_USAGE_FOR_DISPLAY) {
-			eel_canvas_item_get_bounds (child, &tx1, &ty1, &tx2, &ty2);
-		} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-			nemo_icon_canvas_item_get_bounds_for_layout (NEMO_ICON_CANVAS_ITEM (child),
-									 &tx1, &ty1, &tx2, &ty2);
-		} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-			nemo_icon_canvas_item_get_bounds_for_entire_item (NEMO_ICON_CANVAS_ITEM (child),
-									      &tx1, &ty1, &tx2, &ty2);
+	n_icons = g_list_length (indexed_icons);
+	icon_bounds = g_new (EelDRect, n_icons);
+	for (p = indexed_icons, i = 0; p != NULL; p = p->next, i++) {
+		icon_get_index_bounds (p->data, &icon_bounds[i]);
+		if (i == 0) {
+			index->bounds = icon_bounds[i];
 		} else {
-			g_assert_not_reached ();
+			eel_drect_union (&index->bounds, &index->bounds, &icon_bounds[i]);
 		}
+	}
 
-		if (tx1 < minx)
-			minx = tx1;
+	/* Grow the buckets on huge canvases to keep the offset table small. */
+	index->bucket_size = SPATIAL_INDEX_BUCKET_SIZE;
+	for (;;) {
+		index->num_columns = (index->bounds.x1 - index->bounds.x0) / index->bucket_size + 1;
+		index->num_rows = (index->bounds.y1 - index->bounds.y0) / index->bucket_size + 1;
+		if ((gint64) index->num_columns * index->num_rows <= SPATIAL_INDEX_MAX_BUCKETS) {
+			break;
+		}
+		index->bucket_size *= 2;
+	}
 
-		if (ty1 < miny)
-			miny = ty1;
+	n_buckets = index->num_columns * index->num_rows;
+	index->bucket_offsets = g_new0 (guint, n_buckets + 1);
 
-		if (tx2 > maxx)
-			maxx = tx2;
+	/* Count the entries of every bucket, then turn the counts into offsets. */
+	for (i = 0; i < n_icons; i++) {
+		if (!spatial_index_get_bucket_range (index, &icon_bounds[i], &range)) {
+			continue;
+		}
+		for (y = range.y0; y <= range.y1; y++) {
+			for (x = range.x0; x <= range.x1; x++) {
+				index->bucket_offsets[y * index->num_columns + x + 1]++;
+			}
+		}
+	}
+	for (n = 1; n <= n_buckets; n++) {
+		index->bucket_offsets[n] += index->bucket_offsets[n - 1];
+	}
 
-		if (ty2 > maxy)
-			maxy = ty2;
+	index->bucket_icons = g_new (NemoIcon *, index->bucket_offsets[n_buckets]);
+	fill = g_memdup (index->bucket_offsets, n_buckets * sizeof (guint));
+	for (p = indexed_icons, i = 0; p != NULL; p = p->next, i++) {
+		if (!spatial_index_get_bucket_range (index, &icon_bounds[i], &range)) {
+			continue;
+		}
+		for (y = range.y0; y <= range.y1; y++) {
+			for (x = range.x0; x <= range.x1; x++) {
+				index->bucket_icons[fill[y * index->num_columns + x]++] = p->data;
+			}
+		}
 	}
 
-	/* Make the bounds be relative to our parent's coordinate system */
+	g_free (fill);
+	g_free (icon_bounds);
+	g_list_free (indexed_icons);
+}
 
-	if (EEL_CANVAS_ITEM (group)->parent) {
-		minx += group->xpos;
-		miny += group->ypos;
-		maxx += group->xpos;
-		maxy += group->ypos;
-	}
-	
-	if (x1 != NULL) {
-		*x1 = minx;
+/* Returns the icons whose bounds may intersect @rect. This is a
+ * bucket-level answer: callers still have to do their exact test.
+ */
+static GList *
+spatial_index_query (NemoIconContainer *container,
+		     const EelDRect *rect)
+{
+	NemoIconSpatialIndex *index;
+	NemoIcon *icon;
+	EelIRect range;
+	GList *result, *p;
+	guint bucket, n;
+	int x, y;
+
+	index = &container->details->spatial_index;
+	spatial_index_ensure (container);
+
+	if (!spatial_index_get_bucket_range (index, rect, &range)) {
+		return NULL;
 	}
 
-	if (y1 != NULL) {
-		*y1 = miny;
+	if (++index->query_stamp == 0) {
+		for (p = container->details->icons; p != NULL; p = p->next) {
+			icon = p->data;
+			icon->spatial_query_stamp = 0;
+		}
+		index->query_stamp = 1;
+	}
+
+	result = NULL;
+	for (y = range.y0; y <= range.y1; y++) {
+		for (x = range.x0; x <= range.x1; x++) {
+			bucket = y * index->num_columns + x;
+			for (n = index->bucket_offsets[bucket]; n < index->bucket_offsets[bucket + 1]; n++) {
+				icon = index->bucket_icons[n];
+				if (icon->spatial_query_stamp != index->query_stamp) {
+					icon->spatial_query_stamp = index->query_stamp;
+					result = g_list_prepend (result, icon);
+				}
+			}
+		}
 	}
 
-	if (x2 != NULL) {
-		*x2 = maxx;
+	return result;
+}
+
+static void
+compute_all_icon_bounds (NemoIconContainer *container,
+			 EelDRect *bounds,
+			 NemoIconCanvasItemBoundsUsage usage)
+{
+	GList *p;
+	NemoIcon *icon;
+	EelDRect icon_bounds;
+	gboolean set;
+
+	set = FALSE;
+
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+
+		if (!icon_is_indexed (icon)) {
+			continue;
+		}
+
+		if (usage == BOUNDS_USAGE_FOR_DISPLAY) {
+			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+						    &icon_bounds.x0, &icon_bounds.y0,
+						    &icon_bounds.x1, &icon_bounds.y1);
+		} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
+			nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
+								     &icon_bounds.x0, &icon_bounds.y0,
+								     &icon_bounds.x1, &icon_bounds.y1);
+		} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
+			nemo_icon_canvas_item_get_bounds_for_entire_item (icon->item,
+									  &icon_bounds.x0, &icon_bounds.y0,
+									  &icon_bounds.x1, &icon_bounds.y1);
+		} else {
+			g_assert_not_reached ();
+		}
+
+		if (!set) {
+			*bounds = icon_bounds;
+			set = TRUE;
+		} else {
+			bounds->x0 = MIN (bounds->x0, icon_bounds.x0);
+			bounds->y0 = MIN (bounds->y0, icon_bounds.y0);
+			bounds->x1 = MAX (bounds->x1, icon_bounds.x1);
+			bounds->y1 = MAX (bounds->y1, icon_bounds.y1);
+		}
 	}
 
-	if (y2 != NULL) {
-		*y2 = maxy;
+	/* If there were no visible items, return an empty bounding box */
+	if (!set) {
+		bounds->x0 = bounds->y0 = bounds->x1 = bounds->y1 = 0.0;
 	}
 }
 
@@ -985,11 +1197,35 @@ get_all_icon_bounds (NemoIconContainer *container,
 		     double *x2, double *y2,
 		     NemoIconCanvasItemBoundsUsage usage)
 {
+	NemoIconSpatialIndex *index;
+	EelDRect *bounds;
+
 	/* FIXME bugzilla.gnome.org 42477: Do we have to do something about the rubberband
 	 * here? Any other non-icon items?
 	 */
-	get_icon_bounds_for_canvas_bounds (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
-					   x1, y1, x2, y2, usage);
+	index = &container->details->spatial_index;
+	bounds = &index->total_bounds[usage];
+
+	if (!index->total_bounds_valid[usage]) {
+		compute_all_icon_bounds (container, bounds, usage);
+		index->total_bounds_valid[usage] = TRUE;
+	}
+
+	if (x1 != NULL) {
+		*x1 = bounds->x0;
+	}
+
+	if (y1 != NULL) {
+		*y1 = bounds->y0;
+	}
+
+	if (x2 != NULL) {
+		*x2 = bounds->x1;
+	}
+
+	if (y2 != NULL) {
+		*y2 = bounds->y1;
+	}
 }
 
 /* Don't preserve visible white space the next time the scroll region
@@ -1168,6 +1404,124 @@ static void
 resort (NemoIconContainer *container)
 {
 	sort_icons (container, &container->details->icons);
+	invalidate_icon_array (container);
+}
+
+/* Give up on an incremental resort when more than this fraction of the
+ * icons changed; sorting the whole list is cheaper then.
+ */
+#define INCREMENTAL_RESORT_MAX_FRACTION 8
+
+static void
+insert_icon_link (GList **list,
+		  GList *link,
+		  GList *sibling,
+		  GList **tail)
+{
+	if (sibling != NULL) {
+		link->next = sibling;
+		link->prev = sibling->prev;
+		if (sibling->prev != NULL) {
+			sibling->prev->next = link;
+		} else {
+			*list = link;
+		}
+		sibling->prev = link;
+	} else {
+		link->next = NULL;
+		link->prev = *tail;
+		if (*tail != NULL) {
+			(*tail)->next = link;
+		} else {
+			*list = link;
+		}
+		*tail = link;
+	}
+}
+
+/* Moves the icons in resort_icons to their place in the otherwise sorted
+ * icons list, using binary search instead of sorting the whole list.
+ * The moved icons, and the icons that followed them before, are added
+ * to relayout_icons. Returns FALSE if too many icons changed.
+ */
+static gboolean
+resort_incrementally (NemoIconContainer *container)
+{
+	NemoIconContainerDetails *details;
+	GHashTableIter iter;
+	gpointer key, value;
+	GList *moved, *p, *neighbor, *tail;
+	NemoIcon *icon;
+	guint n_icons, n_moved, low, high, middle;
+
+	details = container->details;
+
+	n_moved = g_hash_table_size (details->resort_icons);
+	if (n_moved == 0) {
+		return TRUE;
+	}
+
+	n_icons = g_hash_table_size (details->icon_set);
+	if (n_moved > n_icons / INCREMENTAL_RESORT_MAX_FRACTION) {
+		return FALSE;
+	}
+
+	/* Take the changed icons out of the list. The icons are flagged as
+	 * not yet placed when they were just added, their neighbors then
+	 * don't have to move.
+	 */
+	moved = NULL;
+	g_hash_table_iter_init (&iter, details->resort_icons);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		icon = key;
+
+		if (GPOINTER_TO_INT (value)) {
+			neighbor = icon->link->next ? icon->link->next : icon->link->prev;
+			if (neighbor != NULL) {
+				g_hash_table_insert (details->relayout_icons, neighbor->data, neighbor->data);
+			}
+		}
+
+		details->icons = g_list_remove_link (details->icons, icon->link);
+		icon->is_line_start = FALSE;
+		moved = g_list_prepend (moved, icon);
+	}
+	invalidate_icon_array (container);
+	ensure_icon_array (container);
+
+	sort_icons (container, &moved);
+
+	/* Insert each one after all icons that don't sort after it. Icons
+	 * are inserted in order, so equal ones keep their sorted order.
+	 */
+	tail = details->icon_array->len > 0 ?
+		((NemoIcon *) g_ptr_array_index (details->icon_array, details->icon_array->len - 1))->link : NULL;
+	for (p = moved; p != NULL; p = p->next) {
+		icon = p->data;
+
+		low = 0;
+		high = details->icon_array->len;
+		while (low < high) {
+			middle = low + (high - low) / 2;
+			if (compare_icons (g_ptr_array_index (details->icon_array, middle), icon, container) > 0) {
+				high = middle;
+			} else {
+				low = middle + 1;
+			}
+		}
+
+		insert_icon_link (&details->icons, icon->link,
+				  low < details->icon_array->len ?
+				  ((NemoIcon *) g_ptr_array_index (details->icon_array, low))->link : NULL,
+				  &tail);
+		g_hash_table_insert (details->relayout_icons, icon, icon);
+	}
+	g_list_free (moved);
+
+	invalidate_icon_array (container);
+	g_hash_table_remove_all (details->resort_icons);
+
+	return TRUE;
 }
 
 #if 0
@@ -1385,6 +1739,12 @@ lay_down_icons_horizontal (NemoIconContainer *container,
 			}
 		}
 		
+		/* Remember where lines start so a later layout can resume here. */
+		icon->is_line_start = (p == line_start);
+		if (icon->is_line_start) {
+			icon->line_y = y;
+		}
+
 		g_array_set_size (positions, i + 1);
 		position = &g_array_index (positions, IconPositions, i++);
 		position->width = icon_width;
@@ -1961,6 +2321,40 @@ nemo_icon_container_set_rtl_positions (NemoIconContainer *container)
 	}
 }
 
+/* Places the icons in the first free grid locations, going down the
+ * columns from the top left.
+ */
+static void
+place_icons_in_grid (NemoIconContainer *container,
+		     PlacementGrid *grid,
+		     GList *icons)
+{
+	GList *p;
+	NemoIcon *icon;
+	EelDRect icon_rect;
+	int x, y;
+
+	for (p = icons; p != NULL; p = p->next) {
+		icon = p->data;
+
+		icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+
+		/* Start the icon in the first column */
+		x = DESKTOP_PAD_HORIZONTAL + (SNAP_SIZE_X / 2) - ((icon_rect.x1 - icon_rect.x0) / 2);
+		y = DESKTOP_PAD_VERTICAL + SNAP_SIZE_Y - (icon_rect.y1 - icon_rect.y0);
+
+		find_empty_location (container,
+				     grid,
+				     icon,
+				     x, y,
+				     &x, &y);
+
+		icon_set_position (icon, x, y);
+		icon->saved_ltr_x = x;
+		placement_grid_mark_icon (grid, icon);
+	}
+}
+
 static void
 lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 {
@@ -1980,7 +2374,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 	placed_icons = NULL;
 	unplaced_icons = NULL;
 	
-	total = g_list_length (container->details->icons);
+	total = g_hash_table_size (container->details->icon_set);
 	new_length = g_list_length (icons);
 	placed = total - new_length;
 	if (placed > 0) {
@@ -2008,26 +2402,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 					(grid, (NemoIcon*)p->data);
 			}
 			
-			/* Place unplaced icons in the best locations */
-			for (p = unplaced_icons; p != NULL; p = p->next) {
-				icon = p->data;
-				
-				icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
-				
-				/* Start the icon in the first column */
-				x = DESKTOP_PAD_HORIZONTAL + (SNAP_SIZE_X / 2) - ((icon_rect.x1 - icon_rect.x0) / 2);
-				y = DESKTOP_PAD_VERTICAL + SNAP_SIZE_Y - (icon_rect.y1 - icon_rect.y0);
-
-				find_empty_location (container,
-						     grid,
-						     icon,
-						     x, y,
-						     &x, &y);
-				
-				icon_set_position (icon, x, y);
-				icon->saved_ltr_x = x;
-				placement_grid_mark_icon (grid, icon);
-			}
+			place_icons_in_grid (container, grid, unplaced_icons);
 
 			placement_grid_free (grid);
 		}
@@ -2167,9 +2542,60 @@ lay_down_icons (NemoIconContainer *container, GList *icons, double start_y)
 	}
 }
 
+/* Lays down the icons again from the line holding the first icon in
+ * relayout_icons on, leaving the lines before it alone. Only the
+ * horizontal layout with labels below the icons can be resumed in the
+ * middle; returns FALSE if everything has to be laid down again.
+ */
+static gboolean
+lay_down_icons_incrementally (NemoIconContainer *container)
+{
+	NemoIconContainerDetails *details;
+	GHashTableIter iter;
+	gpointer key;
+	NemoIcon *icon;
+	guint index, first_index;
+	int i;
+
+	details = container->details;
+
+	if ((details->layout_mode != NEMO_ICON_LAYOUT_L_R_T_B &&
+	     details->layout_mode != NEMO_ICON_LAYOUT_R_L_T_B) ||
+	    details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
+		return FALSE;
+	}
+
+	if (g_hash_table_size (details->relayout_icons) == 0) {
+		return TRUE;
+	}
+
+	first_index = G_MAXUINT;
+	g_hash_table_iter_init (&iter, details->relayout_icons);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		index = get_icon_index (container, key);
+		first_index = MIN (first_index, index);
+	}
+
+	for (i = first_index; i >= 0; i--) {
+		icon = get_nth_icon (container, i);
+		if (icon->is_line_start) {
+			lay_down_icons_horizontal (container, icon->link,
+						   icon->line_y - CONTAINER_PAD_TOP);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 static void
 redo_layout_internal (NemoIconContainer *container)
 {
+	NemoIconContainerDetails *details;
+
+	details = container->details;
+
+	spatial_index_invalidate (container);
 	finish_adding_new_icons (container);
 
 	/* Don't do any re-laying-out during stretching. Later we
@@ -2177,13 +2603,29 @@ redo_layout_internal (NemoIconContainer *container)
 	 * the stretched icon, but if we do it we want it to be fast
 	 * and only re-lay-out when it's really needed.
 	 */
-	if (container->details->auto_layout
-	    && container->details->drag_state != DRAG_STATE_STRETCH) {
-		if (container->details->needs_resort) {
-			resort (container);
-			container->details->needs_resort = FALSE;
+	if (details->auto_layout
+	    && details->drag_state != DRAG_STATE_STRETCH) {
+		/* After icons were added, removed or changed, only the
+		 * icons from the first change on have to move.
+		 */
+		if (details->needs_full_layout
+		    || details->needs_resort
+		    || !resort_incrementally (container)
+		    || !lay_down_icons_incrementally (container)) {
+			if (details->needs_resort
+			    || g_hash_table_size (details->resort_icons) > 0) {
+				resort (container);
+				details->needs_resort = FALSE;
+			}
+			lay_down_icons (container, details->icons, 0);
 		}
-		lay_down_icons (container, container->details->icons, 0);
+	}
+
+	if (!details->auto_layout
+	    || details->drag_state != DRAG_STATE_STRETCH) {
+		g_hash_table_remove_all (details->resort_icons);
+		g_hash_table_remove_all (details->relayout_icons);
+		details->needs_full_layout = FALSE;
 	}
 
 	if (nemo_icon_container_is_layout_rtl (container)) {
@@ -2218,8 +2660,11 @@ unschedule_redo_layout (NemoIconContainer *container)
 	}
 }
 
+/* Schedules a layout that only moves the icons affected by the
+ * additions, removals and updates recorded since the last one.
+ */
 static void
-schedule_redo_layout (NemoIconContainer *container)
+schedule_incremental_layout (NemoIconContainer *container)
 {
 	if (container->details->idle_id == 0
 	    && container->details->has_been_allocated) {
@@ -2228,9 +2673,17 @@ schedule_redo_layout (NemoIconContainer *container)
 	}
 }
 
+static void
+schedule_redo_layout (NemoIconContainer *container)
+{
+	container->details->needs_full_layout = TRUE;
+	schedule_incremental_layout (container);
+}
+
 static void
 redo_layout (NemoIconContainer *container)
 {
+	container->details->needs_full_layout = TRUE;
 	unschedule_redo_layout (container);
 	redo_layout_internal (container);
 }
@@ -2300,17 +2753,38 @@ button_event_modifies_selection (GdkEventButton *event)
 }
 
 /* invalidate the cached label sizes for all the icons */
+static void
+clear_label_measure_layout (NemoIconContainer *container)
+{
+	NemoIconContainerDetails *details;
+
+	details = container->details;
+
+	if (details->label_measure_layout != NULL) {
+		g_object_unref (details->label_measure_layout);
+		details->label_measure_layout = NULL;
+	}
+	g_free (details->label_measure_font_key);
+	details->label_measure_font_key = NULL;
+	g_free (details->label_measure_text);
+	details->label_measure_text = NULL;
+}
+
 static void
 invalidate_label_sizes (NemoIconContainer *container)
 {
 	GList *p;
 	NemoIcon *icon;
+
+	clear_label_measure_layout (container);
 	
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
 
 		nemo_icon_canvas_item_invalidate_label_size (icon->item);		
 	}
+
+	spatial_index_invalidate (container);
 }
 
 /* invalidate the entire labels (i.e. their attributes) for all the icons */
@@ -2319,12 +2793,16 @@ invalidate_labels (NemoIconContainer *container)
 {
 	GList *p;
 	NemoIcon *icon;
+
+	clear_label_measure_layout (container);
 	
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
 
 		nemo_icon_canvas_item_invalidate_label (icon->item);		
 	}
+
+	spatial_index_invalidate (container);
 }
 
 static gboolean
@@ -2475,36 +2953,36 @@ rubberband_select (NemoIconContainer *container,
 		   const EelDRect *previous_rect,
 		   const EelDRect *current_rect)
 {
-	GList *p;
-	gboolean selection_changed, is_in, canvas_rect_calculated;
+	GList *p, *icons;
+	gboolean selection_changed, is_in;
 	NemoIcon *icon;
 	EelIRect canvas_rect;
+	EelDRect query_rect;
 	EelCanvas *canvas;
 			
 	selection_changed = FALSE;
-	canvas_rect_calculated = FALSE;
 
-	for (p = container->details->icons; p != NULL; p = p->next) {
+	canvas = EEL_CANVAS (container);
+	eel_canvas_w2c (canvas,
+			current_rect->x0,
+			current_rect->y0,
+			&canvas_rect.x0,
+			&canvas_rect.y0);
+	eel_canvas_w2c (canvas,
+			current_rect->x1,
+			current_rect->y1,
+			&canvas_rect.x1,
+			&canvas_rect.y1);
+
+	/* Only icons under the previous or the current rectangle can
+	 * change their selection state.
+	 */
+	eel_drect_union (&query_rect, previous_rect, current_rect);
+	icons = spatial_index_query (container, &query_rect);
+
+	for (p = icons; p != NULL; p = p->next) {
 		icon = p->data;
 		
-		if (!canvas_rect_calculated) {
-			/* Only do this calculation once, since all the canvas items
-			 * we are interating are in the same coordinate space
-			 */
-			canvas = EEL_CANVAS_ITEM (icon->item)->canvas;
-			eel_canvas_w2c (canvas,
-					current_rect->x0,
-					current_rect->y0,
-					&canvas_rect.x0,
-					&canvas_rect.y0);
-			eel_canvas_w2c (canvas,
-					current_rect->x1,
-					current_rect->y1,
-					&canvas_rect.x1,
-					&canvas_rect.y1);
-			canvas_rect_calculated = TRUE;
-		}
-		
 		is_in = nemo_icon_canvas_item_hit_test_rectangle (icon->item, canvas_rect);
 
 		selection_changed |= icon_set_selected
@@ -2512,6 +2990,8 @@ rubberband_select (NemoIconContainer *container,
 			 is_in ^ icon->was_selected_before_rubberband);
 	}
 
+	g_list_free (icons);
+
 	if (selection_changed) {
 		g_signal_emit (container,
 				 signals[SELECTION_CHANGED], 0);
@@ -2668,6 +3148,10 @@ start_rubberbanding (NemoIconContainer *container,
 		(EEL_CANVAS (container), event->x, event->y,
 		 &band_info->start_x, &band_info->start_y);
 
+	/* Nothing was selected by the band yet. */
+	band_info->prev_rect.x0 = band_info->prev_rect.x1 = band_info->start_x;
+	band_info->prev_rect.y0 = band_info->prev_rect.y1 = band_info->start_y;
+
 	context = gtk_widget_get_style_context (GTK_WIDGET (container));
 	gtk_style_context_save (context);
 	gtk_style_context_add_class (context, GTK_STYLE_CLASS_RUBBERBAND);
@@ -2719,7 +3203,6 @@ stop_rubberbanding (NemoIconContainer *container,
 		    guint32 time)
 {
 	NemoIconRubberbandInfo *band_info;
-	GList *icons;
 	gboolean enable_animation;
 
 	band_info = &container->details->rubberband_info;
@@ -2744,11 +3227,9 @@ stop_rubberbanding (NemoIconContainer *container,
 
 	/* if only one item has been selected, use it as range
 	 * selection base (cf. handle_icon_button_press) */
-	icons = nemo_icon_container_get_selected_icons (container);
-	if (g_list_length (icons) == 1) {
-		container->details->range_selection_base_icon = icons->data;
+	if (container->details->n_selected == 1) {
+		container->details->range_selection_base_icon = get_first_selected_icon (container);
 	}
-	g_list_free (icons);
 
 	g_signal_emit (container,
 			 signals[BAND_SELECT_ENDED], 0);
@@ -3955,7 +4436,7 @@ select_previous_or_next_icon (NemoIconContainer *container,
 	if (icon != NULL) {
 		/* must have at least @icon in the list */
 		g_assert (container->details->icons != NULL);
-		item = g_list_find (container->details->icons, icon);
+		item = icon->link;
 		g_assert (item != NULL);
 		
 		item = next ? item->next : item->prev;
@@ -4048,6 +4529,15 @@ finalize (GObject *object)
 	g_hash_table_destroy (details->icon_set);
 	details->icon_set = NULL;
 
+	g_hash_table_destroy (details->visible_icons);
+	g_hash_table_destroy (details->resort_icons);
+	g_hash_table_destroy (details->relayout_icons);
+	clear_label_measure_layout (NEMO_ICON_CONTAINER (object));
+	details->visible_icons = NULL;
+	g_ptr_array_free (details->icon_array, TRUE);
+	details->icon_array = NULL;
+	spatial_index_free (&details->spatial_index);
+
 	g_free (details->font);
 
 	if (details->a11y_item_action_queue != NULL) {
@@ -6163,6 +6653,11 @@ nemo_icon_container_init (NemoIconContainer *container)
 	details = g_new0 (NemoIconContainerDetails, 1);
 
 	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->visible_icons = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->resort_icons = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->relayout_icons = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->needs_full_layout = TRUE;
+	details->icon_array = g_ptr_array_new ();
 	details->layout_timestamp = UNDEFINED_TIME;
 	details->zoom_level = NEMO_ZOOM_LEVEL_STANDARD;
 
@@ -6448,6 +6943,14 @@ nemo_icon_container_clear (NemoIconContainer *container)
 	details->icons = NULL;
 	g_list_free (details->new_icons);
 	details->new_icons = NULL;
+	invalidate_icon_array (container);
+	details->n_selected = 0;
+	details->selection_serial++;
+	g_hash_table_remove_all (details->visible_icons);
+	g_hash_table_remove_all (details->resort_icons);
+	g_hash_table_remove_all (details->relayout_icons);
+	details->needs_full_layout = TRUE;
+	spatial_index_invalidate (container);
 	
  	g_hash_table_destroy (details->icon_set);
  	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -6639,18 +7142,36 @@ icon_destroy (NemoIconContainer *container,
 	gboolean was_selected;
 	NemoIcon *icon_to_focus;
 	GList *item;
+	gpointer value;
  
 	details = container->details;
 
-	item = g_list_find (details->icons, icon);
-	item = item->next ? item->next : item->prev;
+	item = icon->link->next ? icon->link->next : icon->link->prev;
 	icon_to_focus = (item != NULL) ? item->data : NULL;
+
+	/* The icons after this one have to move up, unless it was never
+	 * laid down.
+	 */
+	if (item != NULL &&
+	    (!g_hash_table_lookup_extended (details->resort_icons, icon, NULL, &value) ||
+	     GPOINTER_TO_INT (value))) {
+		g_hash_table_insert (details->relayout_icons, item->data, item->data);
+	}
+	g_hash_table_remove (details->resort_icons, icon);
+	g_hash_table_remove (details->relayout_icons, icon);
  
-	details->icons = g_list_remove (details->icons, icon);
-	details->new_icons = g_list_remove (details->new_icons, icon);
+	details->icons = g_list_delete_link (details->icons, icon->link);
+	if (icon->new_link != NULL) {
+		details->new_icons = g_list_delete_link (details->new_icons, icon->new_link);
+	}
 	g_hash_table_remove (details->icon_set, icon->data);
+	invalidate_icon_array (container);
 
 	was_selected = icon->is_selected;
+	if (was_selected) {
+		details->n_selected--;
+		details->selection_serial++;
+	}
 
 	if (details->keyboard_focus == icon ||
 	    details->keyboard_focus == NULL) {
@@ -6689,6 +7210,8 @@ icon_destroy (NemoIconContainer *container,
 							       icon->data,
 							       icon);
 	}
+	g_hash_table_remove (details->visible_icons, icon);
+	spatial_index_invalidate (container);
 	icon_free (icon);
 
 	if (was_selected) {
@@ -6870,10 +7393,14 @@ nemo_icon_container_update_visible_icons (NemoIconContainer *container)
 	double min_y, max_y;
 	double min_x, max_x;
 	double x0, y0, x1, y1;
-	GList *node;
+	GList *node, *candidates, *visible_icons;
 	NemoIcon *icon;
 	gboolean visible;
 	GtkAllocation allocation;
+	EelDRect visible_rect;
+	GHashTable *visible_set;
+	GHashTableIter iter;
+	gpointer key;
 
 	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
 	vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
@@ -6889,11 +7416,25 @@ nemo_icon_container_update_visible_icons (NemoIconContainer *container)
 			min_x, min_y, &min_x, &min_y);
 	eel_canvas_c2w (EEL_CANVAS (container),
 			max_x, max_y, &max_x, &max_y);
-	
-	/* Do the iteration in reverse to get the render-order from top to
-	 * bottom for the prioritized thumbnails.
-	 */
-	for (node = g_list_last (container->details->icons); node != NULL; node = node->prev) {
+
+	if (nemo_icon_container_is_layout_vertical (container)) {
+		visible_rect.x0 = min_x;
+		visible_rect.x1 = max_x;
+		visible_rect.y0 = -G_MAXDOUBLE;
+		visible_rect.y1 = G_MAXDOUBLE;
+	} else {
+		visible_rect.x0 = -G_MAXDOUBLE;
+		visible_rect.x1 = G_MAXDOUBLE;
+		visible_rect.y0 = min_y;
+		visible_rect.y1 = max_y;
+	}
+
+	/* Only icons near the visible area can become visible. */
+	candidates = spatial_index_query (container, &visible_rect);
+
+	visible_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	visible_icons = NULL;
+	for (node = candidates; node != NULL; node = node->next) {
 		icon = node->data;
 
 		if (icon_is_positioned (icon)) {
@@ -6916,14 +7457,36 @@ nemo_icon_container_update_visible_icons (NemoIconContainer *container)
 			}
 
 			if (visible) {
-				nemo_icon_canvas_item_set_is_visible (icon->item, TRUE);
-				nemo_icon_container_prioritize_thumbnailing (container,
-										 icon);
-			} else {
-				nemo_icon_canvas_item_set_is_visible (icon->item, FALSE);
+				g_hash_table_insert (visible_set, icon, icon);
+				visible_icons = g_list_prepend (visible_icons, icon);
 			}
 		}
 	}
+	g_list_free (candidates);
+
+	/* Let the icons that scrolled out of view drop their drawing state. */
+	g_hash_table_iter_init (&iter, container->details->visible_icons);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (g_hash_table_lookup (visible_set, key) == NULL) {
+			icon = key;
+			nemo_icon_canvas_item_set_is_visible (icon->item, FALSE);
+		}
+	}
+	g_hash_table_destroy (container->details->visible_icons);
+	container->details->visible_icons = visible_set;
+
+	/* Do the iteration in reverse to get the render-order from top to
+	 * bottom for the prioritized thumbnails.
+	 */
+	visible_icons = g_list_sort_with_data (visible_icons, compare_icons, container);
+	for (node = g_list_last (visible_icons); node != NULL; node = node->prev) {
+		icon = node->data;
+
+		nemo_icon_canvas_item_set_is_visible (icon->item, TRUE);
+		nemo_icon_container_prioritize_thumbnailing (container,
+							     icon);
+	}
+	g_list_free (visible_icons);
 }
 
 static void
@@ -7057,6 +7620,8 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
 	nemo_icon_canvas_item_set_embedded_text_rect (icon->item, &embedded_text_rect);
 	nemo_icon_canvas_item_set_embedded_text (icon->item, embedded_text);
 
+	spatial_index_invalidate (container);
+
 	/* Let the pixbufs go. */
 	g_object_unref (pixbuf);
 
@@ -7097,6 +7662,7 @@ finish_adding_icon (NemoIconContainer *container,
 {
 	nemo_icon_container_update_icon (container, icon);
 	eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
+	spatial_index_invalidate (container);
 
 	g_signal_connect_object (icon->item, "event",
 				 G_CALLBACK (item_event_callback), container, 0);
@@ -7110,15 +7676,19 @@ finish_adding_new_icons (NemoIconContainer *container)
 	GList *p, *new_icons, *no_position_icons, *semi_position_icons;
 	NemoIcon *icon;
 	double bottom;
+	PlacementGrid *grid;
+	gboolean use_grid_for_no_position_icons;
 
 	new_icons = container->details->new_icons;
 	container->details->new_icons = NULL;
+	grid = NULL;
 
 	/* Position most icons (not unpositioned manual-layout icons). */
 	new_icons = g_list_reverse (new_icons);
 	no_position_icons = semi_position_icons = NULL;
 	for (p = new_icons; p != NULL; p = p->next) {
 		icon = p->data;
+		icon->new_link = NULL;
 		if (icon->has_lazy_position) {
 			assign_icon_position (container, icon);
 			semi_position_icons = g_list_prepend (semi_position_icons, icon);
@@ -7130,8 +7700,17 @@ finish_adding_new_icons (NemoIconContainer *container)
 	}
 	g_list_free (new_icons);
 
-	if (semi_position_icons != NULL) {
-		PlacementGrid *grid;
+	/* Unpositioned icons on a desktop that already has icons on it go
+	 * into the free spots of the same grid, rather than marking all
+	 * icons again in lay_down_icons_vertical_desktop.
+	 */
+	use_grid_for_no_position_icons = no_position_icons != NULL
+		&& nemo_icon_container_get_is_desktop (container)
+		&& (container->details->layout_mode == NEMO_ICON_LAYOUT_T_B_L_R
+		    || container->details->layout_mode == NEMO_ICON_LAYOUT_T_B_R_L)
+		&& g_hash_table_size (container->details->icon_set) > g_list_length (no_position_icons);
+
+	if (semi_position_icons != NULL || use_grid_for_no_position_icons) {
 		time_t now;
 		gboolean dummy;
 
@@ -7142,8 +7721,11 @@ finish_adding_new_icons (NemoIconContainer *container)
 		/* This is currently only used on the desktop.
 		 * Thus, we pass FALSE for tight, like lay_down_icons_tblr */
 		grid = placement_grid_new (container, FALSE);
+		if (grid == NULL) {
+			use_grid_for_no_position_icons = FALSE;
+		}
 
-		for (p = container->details->icons; p != NULL; p = p->next) {
+		for (p = container->details->icons; grid != NULL && p != NULL; p = p->next) {
 			icon = p->data;
 
 			if (icon_is_positioned (icon) && !icon->has_lazy_position) {
@@ -7181,8 +7763,6 @@ finish_adding_new_icons (NemoIconContainer *container)
 			icon->has_lazy_position = FALSE;
 		}
 
-		placement_grid_free (grid);
-
 		g_list_free (semi_position_icons);
 	}
 
@@ -7191,7 +7771,21 @@ finish_adding_new_icons (NemoIconContainer *container)
 		g_assert (!container->details->auto_layout);
 		
 		sort_icons (container, &no_position_icons);
-		if (nemo_icon_container_get_is_desktop (container)) {
+		if (use_grid_for_no_position_icons) {
+			NemoIconPosition position;
+
+			place_icons_in_grid (container, grid, no_position_icons);
+
+			for (p = no_position_icons; p != NULL; p = p->next) {
+				icon = p->data;
+
+				position.x = icon->saved_ltr_x;
+				position.y = icon->y;
+				position.scale = icon->scale;
+				g_signal_emit (container, signals[ICON_POSITION_CHANGED], 0,
+					       icon->data, &position);
+			}
+		} else if (nemo_icon_container_get_is_desktop (container)) {
 			lay_down_icons (container, no_position_icons, CONTAINER_PAD_TOP);
 		} else {
 			get_all_icon_bounds (container, NULL, NULL, NULL, &bottom, BOUNDS_USAGE_FOR_LAYOUT);
@@ -7200,6 +7794,10 @@ finish_adding_new_icons (NemoIconContainer *container)
 		g_list_free (no_position_icons);
 	}
 
+	if (grid != NULL) {
+		placement_grid_free (grid);
+	}
+
 	if (container->details->store_layout_timestamps_when_finishing_new_icons) {
 		store_layout_timestamps_now (container);
 		container->details->store_layout_timestamps_when_finishing_new_icons = FALSE;
@@ -7278,13 +7876,17 @@ nemo_icon_container_add (NemoIconContainer *container,
 	/* Put it on both lists. */
 	details->icons = g_list_prepend (details->icons, icon);
 	details->new_icons = g_list_prepend (details->new_icons, icon);
+	icon->link = details->icons;
+	icon->new_link = details->new_icons;
+	invalidate_icon_array (container);
 
 	g_hash_table_insert (details->icon_set, data, icon);
 
-	details->needs_resort = TRUE;
+	/* Not placed yet, so nothing has to move to make room for it. */
+	g_hash_table_insert (details->resort_icons, icon, GINT_TO_POINTER (FALSE));
 
 	/* Run an idle function to add the icons. */
-	schedule_redo_layout (container);
+	schedule_incremental_layout (container);
 	
 	return TRUE;
 }
@@ -7329,7 +7931,7 @@ nemo_icon_container_remove (NemoIconContainer *container,
 
     gtk_widget_set_tooltip_text (GTK_WIDGET (EEL_CANVAS_ITEM (icon->item)->canvas), "");
 	icon_destroy (container, icon);
-	schedule_redo_layout (container);
+	schedule_incremental_layout (container);
 
 	g_signal_emit (container, signals[ICON_REMOVED], 0, icon);
 
@@ -7356,8 +7958,12 @@ nemo_icon_container_request_update (NemoIconContainer *container,
 
 	if (icon != NULL) {
 		nemo_icon_container_update_icon (container, icon);
-		container->details->needs_resort = TRUE;
-		schedule_redo_layout (container);
+		if (!g_hash_table_lookup_extended (container->details->resort_icons,
+						   icon, NULL, NULL)) {
+			g_hash_table_insert (container->details->resort_icons,
+					     icon, GINT_TO_POINTER (TRUE));
+		}
+		schedule_incremental_layout (container);
 	}
 }
 
@@ -7750,6 +8356,10 @@ get_nth_selected_icon (NemoIconContainer *container, int index)
 
 	g_assert (index > 0);
 
+	if (index > (int) container->details->n_selected) {
+		return NULL;
+	}
+
 	/* Find the nth selected icon. */
 	selection_count = 0;
 	for (p = container->details->icons; p != NULL; p = p->next) {
@@ -7772,28 +8382,19 @@ get_first_selected_icon (NemoIconContainer *container)
 static gboolean
 has_multiple_selection (NemoIconContainer *container)
 {
-        return get_nth_selected_icon (container, 2) != NULL;
+        return container->details->n_selected > 1;
 }
 
 static gboolean
 all_selected (NemoIconContainer *container)
 {
-	GList *p;
-	NemoIcon *icon;
-
-	for (p = container->details->icons; p != NULL; p = p->next) {
-		icon = p->data;
-		if (!icon->is_selected) {
-			return FALSE;
-		}
-	}
-	return TRUE;
+	return container->details->n_selected == g_hash_table_size (container->details->icon_set);
 }
 
 static gboolean
 has_selection (NemoIconContainer *container)
 {
-        return get_nth_selected_icon (container, 1) != NULL;
+        return container->details->n_selected > 0;
 }
 
 /**
@@ -8826,20 +9427,21 @@ nemo_icon_container_accessible_update_selection (AtkObject *accessible)
 
 	priv = accessible_get_priv (accessible);
 
-	if (priv->selection) {
-		g_list_free (priv->selection);
-		priv->selection = NULL;
+	/* Only walk the icons if the selection changed since last time. */
+	if (priv->selection->len == container->details->n_selected &&
+	    priv->selection_serial == container->details->selection_serial) {
+		return;
 	}
-	
+
+	g_ptr_array_set_size (priv->selection, 0);
 	for (l = container->details->icons; l != NULL; l = l->next) {
 		icon = l->data;
 		if (icon->is_selected) {
-			priv->selection = g_list_prepend (priv->selection, 
-							  icon);
+			g_ptr_array_add (priv->selection, icon);
 		}
 	}
 
-	priv->selection = g_list_reverse (priv->selection);
+	priv->selection_serial = container->details->selection_serial;
 }
 
 static void
@@ -8864,7 +9466,7 @@ nemo_icon_container_accessible_icon_added_cb (NemoIconContainer *container,
 		atk_parent = ATK_OBJECT (data);
 		atk_child = atk_gobject_accessible_for_object 
 			(G_OBJECT (icon->item));
-		index = g_list_index (container->details->icons, icon);
+		index = get_icon_index (container, icon);
 		
 		g_signal_emit_by_name (atk_parent, "children_changed::add",
 				       index, atk_child, NULL);
@@ -8886,7 +9488,7 @@ nemo_icon_container_accessible_icon_removed_cb (NemoIconContainer *container,
 		atk_parent = ATK_OBJECT (data);
 		atk_child = atk_gobject_accessible_for_object 
 			(G_OBJECT (icon->item));
-		index = g_list_index (container->details->icons, icon);
+		index = get_icon_index (container, icon);
 		
 		g_signal_emit_by_name (atk_parent, "children_changed::remove",
 				       index, atk_child, NULL);
@@ -8907,7 +9509,6 @@ nemo_icon_container_accessible_add_selection (AtkSelection *accessible,
 {
 	GtkWidget *widget;
 	NemoIconContainer *container;
-	GList *l;
 	GList *selection;
 	NemoIcon *icon;
 
@@ -8918,10 +9519,8 @@ nemo_icon_container_accessible_add_selection (AtkSelection *accessible,
 
         container = NEMO_ICON_CONTAINER (widget);
 	
-	l = g_list_nth (container->details->icons, i);
-	if (l) {
-		icon = l->data;
-		
+	icon = get_nth_icon (container, i);
+	if (icon) {
 		selection = nemo_icon_container_get_selection (container);
 		selection = g_list_prepend (selection, 
 					    icon->data);
@@ -8958,16 +9557,13 @@ nemo_icon_container_accessible_ref_selection (AtkSelection *accessible,
 {
 	AtkObject *atk_object;
 	NemoIconContainerAccessiblePrivate *priv;
-	GList *item;
 	NemoIcon *icon;
 
 	nemo_icon_container_accessible_update_selection (ATK_OBJECT (accessible));
 	priv = accessible_get_priv (ATK_OBJECT (accessible));
 
-	item = (g_list_nth (priv->selection, i));
-
-	if (item) {
-		icon = item->data;
+	if (i >= 0 && i < (int) priv->selection->len) {
+		icon = g_ptr_array_index (priv->selection, i);
 		atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
 		if (atk_object) {
 			g_object_ref (atk_object);
@@ -8982,15 +9578,17 @@ nemo_icon_container_accessible_ref_selection (AtkSelection *accessible,
 static int
 nemo_icon_container_accessible_get_selection_count (AtkSelection *accessible)
 {
-	int count;
-	NemoIconContainerAccessiblePrivate *priv;
+	NemoIconContainer *container;
+	GtkWidget *widget;
 
-	nemo_icon_container_accessible_update_selection (ATK_OBJECT (accessible));
-	priv = accessible_get_priv (ATK_OBJECT (accessible));
+	widget = gtk_accessible_get_widget (GTK_ACCESSIBLE (accessible));
+	if (!widget) {
+		return 0;
+	}
 
-	count = g_list_length (priv->selection);
-	
-	return count;
+	container = NEMO_ICON_CONTAINER (widget);
+
+	return container->details->n_selected;
 }
 
 static gboolean
@@ -8998,7 +9596,6 @@ nemo_icon_container_accessible_is_child_selected (AtkSelection *accessible,
 						      int i)
 {
 	NemoIconContainer *container;
-	GList *l;
 	NemoIcon *icon;
 	GtkWidget *widget;
 
@@ -9009,9 +9606,8 @@ nemo_icon_container_accessible_is_child_selected (AtkSelection *accessible,
 
         container = NEMO_ICON_CONTAINER (widget);
 
-	l = g_list_nth (container->details->icons, i);
-	if (l) {
-		icon = l->data;
+	icon = get_nth_icon (container, i);
+	if (icon) {
 		return icon->is_selected;
 	}
 	return FALSE;
@@ -9023,7 +9619,6 @@ nemo_icon_container_accessible_remove_selection (AtkSelection *accessible,
 {
 	NemoIconContainer *container;
 	NemoIconContainerAccessiblePrivate *priv;
-	GList *l;
 	GList *selection;
 	NemoIcon *icon;
 	GtkWidget *widget;
@@ -9038,9 +9633,8 @@ nemo_icon_container_accessible_remove_selection (AtkSelection *accessible,
 
         container = NEMO_ICON_CONTAINER (widget);
 	
-	l = g_list_nth (priv->selection, i);
-	if (l) {
-		icon = l->data;
+	if (i >= 0 && i < (int) priv->selection->len) {
+		icon = g_ptr_array_index (priv->selection, i);
 		
 		selection = nemo_icon_container_get_selection (container);
 		selection = g_list_remove (selection, icon->data);
@@ -9131,7 +9725,6 @@ nemo_icon_container_accessible_ref_child (AtkObject *accessible, int i)
 {
         AtkObject *atk_object;
         NemoIconContainer *container;
-        GList *item;
         NemoIcon *icon;
 	GtkWidget *widget;
         
@@ -9142,17 +9735,16 @@ nemo_icon_container_accessible_ref_child (AtkObject *accessible, int i)
 
         container = NEMO_ICON_CONTAINER (widget);
         
-        item = (g_list_nth (container->details->icons, i));
+        icon = get_nth_icon (container, i);
         
-        if (item) {
-                icon = item->data;
+        if (icon) {
                 
                 atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
                 g_object_ref (atk_object);
                 
                 return atk_object;
         } else {
-		if (i == g_list_length (container->details->icons)) {
+		if (i == (int) g_hash_table_size (container->details->icon_set)) {
 			if (container->details->rename_widget) {
 				atk_object = gtk_widget_get_accessible (container->details->rename_widget);
 				g_object_ref (atk_object);
@@ -9176,6 +9768,7 @@ nemo_icon_container_accessible_initialize (AtkObject *accessible,
 	}
 
 	priv = g_new0 (NemoIconContainerAccessiblePrivate, 1);
+	priv->selection = g_ptr_array_new ();
 	g_object_set_qdata (G_OBJECT (accessible), 
 			    accessible_private_data_quark, 
 			    priv);
@@ -9207,9 +9800,7 @@ nemo_icon_container_accessible_finalize (GObject *object)
 	int i;
 
 	priv = accessible_get_priv (ATK_OBJECT (object));
-	if (priv->selection) {
-		g_list_free (priv->selection);
-	}
+	g_ptr_array_free (priv->selection, TRUE);
 
 	for (i = 0; i < LAST_ACTION; i++) {
 		if (priv->action_descriptions[i]) {
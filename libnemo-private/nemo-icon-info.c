@@ -253,9 +253,14 @@ schedule_reap_cache (void)
 	}
 }
 
+/* Bumped whenever the caches are cleared, e.g. on icon theme changes */
+static guint cache_serial = 0;
+
 void
 nemo_icon_info_clear_caches (void)
 {
+	cache_serial++;
+
 	if (loadable_icon_cache) {
 		g_hash_table_remove_all (loadable_icon_cache);
 	}
@@ -265,6 +270,12 @@ nemo_icon_info_clear_caches (void)
 	}
 }
 
+guint
+nemo_icon_info_get_cache_serial (void)
+{
+	return cache_serial;
+}
+
 static guint
 loadable_icon_key_hash (LoadableIconKey *key)
 {
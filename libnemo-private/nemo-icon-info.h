@@ -81,6 +81,7 @@ const char *          nemo_icon_info_get_display_name             (NemoIconInfo
 const char *          nemo_icon_info_get_used_name                (NemoIconInfo  *icon);
 
 void                  nemo_icon_info_clear_caches                 (void);
+guint                 nemo_icon_info_get_cache_serial             (void);
 
 /* Relationship between zoom levels and icons sizes. */
 guint nemo_get_icon_size_for_zoom_level          (NemoZoomLevel  zoom_level);
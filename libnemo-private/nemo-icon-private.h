@@ -39,6 +39,15 @@ typedef struct {
 	/* Canvas item for the icon. */
 	NemoIconCanvasItem *item;
 
+	/* Position handles of this icon in the icons and new_icons lists,
+	 * so removing an icon doesn't have to search the lists.
+	 */
+	GList *link;
+	GList *new_link;
+
+	/* Position in the icons list, valid while icon_array_valid is set. */
+	guint index;
+
 	/* X/Y coordinates. */
 	double x, y;
 
@@ -66,6 +75,18 @@ typedef struct {
 	eel_boolean_bit is_monitored : 1;
 
 	eel_boolean_bit has_lazy_position : 1;
+
+	/* Whether this icon started a line in the last horizontal layout,
+	 * and the y the line was started at; used to resume a layout in the
+	 * middle of the list.
+	 */
+	eel_boolean_bit is_line_start : 1;
+	double line_y;
+
+	/* Stamp of the last spatial index query that returned this icon,
+	 * so icons spanning several buckets are only reported once.
+	 */
+	guint spatial_query_stamp;
 } NemoIcon;
 
 
@@ -86,6 +107,32 @@ typedef struct {
 	int last_adj_y;
 } NemoIconRubberbandInfo;
 
+/* Uniform grid of buckets over the icon bounds, used to find the icons
+ * near a rectangle without walking every icon. The buckets are stored
+ * as one compact array of icon pointers plus per-bucket offsets, and the
+ * whole index is rebuilt lazily after icons were added, moved, resized
+ * or removed.
+ */
+typedef struct {
+	gboolean valid;
+
+	/* Union of the indexed icon bounds, in world coordinates. */
+	EelDRect bounds;
+	double bucket_size;
+	int num_columns;
+	int num_rows;
+
+	/* num_columns * num_rows + 1 offsets into bucket_icons. */
+	guint *bucket_offsets;
+	NemoIcon **bucket_icons;
+
+	guint query_stamp;
+
+	/* Cached union of the icon bounds, per NemoIconCanvasItemBoundsUsage. */
+	EelDRect total_bounds[BOUNDS_USAGE_FOR_DISPLAY + 1];
+	gboolean total_bounds_valid[BOUNDS_USAGE_FOR_DISPLAY + 1];
+} NemoIconSpatialIndex;
+
 typedef enum {
 	DRAG_STATE_INITIAL,
 	DRAG_STATE_MOVE_OR_COPY,
@@ -124,6 +171,40 @@ struct NemoIconContainerDetails {
 	GList *new_icons;
 	GHashTable *icon_set;
 
+	/* Array view of the icons list for indexed access, rebuilt lazily
+	 * after the list changed order or contents.
+	 */
+	GPtrArray *icon_array;
+	gboolean icon_array_valid;
+
+	/* Number of selected icons, and a serial bumped on every selection
+	 * change so cached views of the selection know when to refresh.
+	 */
+	guint n_selected;
+	guint selection_serial;
+
+	/* Spatial index used for hit-testing and visible area updates. */
+	NemoIconSpatialIndex spatial_index;
+
+	/* Icons whose canvas items currently keep their drawing state. */
+	GHashTable *visible_icons;
+
+	/* Icons whose sort position may have changed since the last layout,
+	 * and icons from which the layout has to be redone. Used to update
+	 * the layout incrementally unless needs_full_layout is set.
+	 */
+	GHashTable *resort_icons;
+	GHashTable *relayout_icons;
+	gboolean needs_full_layout;
+
+	/* Layout shared by all icons for measuring labels, with the font
+	 * settings it was made for and the text it currently holds. Thrown
+	 * away whenever the labels are invalidated.
+	 */
+	PangoLayout *label_measure_layout;
+	char *label_measure_font_key;
+	char *label_measure_text;
+
 	/* Current icon for keyboard navigation. */
 	NemoIcon *keyboard_focus;
 	NemoIcon *keyboard_rubberband_start;
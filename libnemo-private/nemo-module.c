@@ -25,8 +25,17 @@
 #include <config.h>
 #include "nemo-module.h"
 
+#include "nemo-global-preferences.h"
+#include "nemo-trace.h"
+
 #include <eel/eel-debug.h>
+#include <errno.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
+#include <string.h>
+
+#define DEBUG_FLAG NEMO_DEBUG_EXTENSIONS
+#include "nemo-debug.h"
 
 #define NEMO_TYPE_MODULE    	(nemo_module_get_type ())
 #define NEMO_MODULE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), NEMO_TYPE_MODULE, NemoModule))
@@ -50,6 +59,12 @@ struct _NemoModule {
 	void (*list_types) (const GType **types,
 			    int          *num_types);
 
+	/* Whether all the types the module listed were registered through
+	 * it, as opposed to by a loader such as nemo-python, whose types
+	 * come from scripts that can change without the module changing.
+	 */
+	gboolean registers_own_types;
+
 };
 
 struct _NemoModuleClass {
@@ -58,6 +73,33 @@ struct _NemoModuleClass {
 
 static GList *module_objects = NULL;
 
+/* Modules that were seen before are not loaded at startup, only once
+ * one of the extension types they provided last time is asked for.
+ * What each module provides is remembered in a manifest in the user's
+ * cache directory, and modules are loaded again whenever they change.
+ */
+#define MANIFEST_KEY_MTIME "mtime"
+#define MANIFEST_KEY_SIZE  "size"
+#define MANIFEST_KEY_TYPES "types"
+/* FALSE for modules that must always be loaded at startup */
+#define MANIFEST_KEY_DEFER "defer"
+
+typedef struct {
+	char *path;
+	char **types;
+} PendingModule;
+
+static GList *pending_modules = NULL;
+static guint preload_idle_id = 0;
+
+typedef struct {
+	GType type;
+	GFunc func;
+	gpointer user_data;
+} ExtensionWatch;
+
+static GList *extension_watches = NULL;
+
 static GType nemo_module_get_type (void);
 
 G_DEFINE_TYPE (NemoModule, nemo_module, G_TYPE_TYPE_MODULE);
@@ -173,11 +215,16 @@ add_module_objects (NemoModule *module)
 	int i;
 	
 	module->list_types (&types, &num_types);
+
+	module->registers_own_types = num_types > 0 && types[0] != 0;
 	
 	for (i = 0; i < num_types; i++) {
 		if (types[i] == 0) { /* Work around broken extensions */
 			break;
 		}
+		if (g_type_get_plugin (types[i]) != G_TYPE_PLUGIN (module)) {
+			module->registers_own_types = FALSE;
+		}
 		nemo_module_add_type (types[i]);
 	}
 }
@@ -186,6 +233,9 @@ static NemoModule *
 nemo_module_load_file (const char *filename)
 {
 	NemoModule *module;
+	gint64 start;
+
+	start = g_get_monotonic_time ();
 	
 	module = g_object_new (NEMO_TYPE_MODULE, NULL);
 	module->path = g_strdup (filename);
@@ -193,6 +243,9 @@ nemo_module_load_file (const char *filename)
 	if (g_type_module_use (G_TYPE_MODULE (module))) {
 		add_module_objects (module);
 		g_type_module_unuse (G_TYPE_MODULE (module));
+		nemo_trace_end (start, "extensions", "Load module", filename);
+		DEBUG ("Loaded extension module %s in %.1f ms", filename,
+		       (g_get_monotonic_time () - start) / 1000.0);
 		return module;
 	} else {
 		g_object_unref (module);
@@ -200,10 +253,180 @@ nemo_module_load_file (const char *filename)
 	}
 }
 
+static gboolean
+strv_has_string (char **strv, const char *str)
+{
+	int i;
+
+	for (i = 0; strv[i] != NULL; i++) {
+		if (strcmp (strv[i], str) == 0) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* The names of the extension interfaces implemented by the objects in
+ * module_objects up to (but not including) stop.
+ */
+static char **
+get_extension_types (GList *stop)
+{
+	GPtrArray *names;
+	GList *l;
+	GType *interfaces;
+	guint n_interfaces, i, j;
+	const char *name;
+
+	names = g_ptr_array_new ();
+
+	for (l = module_objects; l != stop; l = l->next) {
+		interfaces = g_type_interfaces (G_OBJECT_TYPE (l->data), &n_interfaces);
+		for (i = 0; i < n_interfaces; i++) {
+			name = g_type_name (interfaces[i]);
+			for (j = 0; j < names->len; j++) {
+				if (strcmp (g_ptr_array_index (names, j), name) == 0) {
+					break;
+				}
+			}
+			if (j == names->len) {
+				g_ptr_array_add (names, g_strdup (name));
+			}
+		}
+		g_free (interfaces);
+	}
+
+	g_ptr_array_add (names, NULL);
+
+	return (char **) g_ptr_array_free (names, FALSE);
+}
+
+static char *
+get_manifest_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "nemo",
+				 "extensions-manifest", NULL);
+}
+
+static gboolean
+manifest_entry_is_current (GKeyFile *manifest,
+			   const char *filename,
+			   GStatBuf *buf)
+{
+	return g_key_file_has_group (manifest, filename) &&
+		g_key_file_get_int64 (manifest, filename, MANIFEST_KEY_MTIME, NULL) == (gint64) buf->st_mtime &&
+		g_key_file_get_int64 (manifest, filename, MANIFEST_KEY_SIZE, NULL) == (gint64) buf->st_size &&
+		g_key_file_has_key (manifest, filename, MANIFEST_KEY_TYPES, NULL) &&
+		g_key_file_has_key (manifest, filename, MANIFEST_KEY_DEFER, NULL);
+}
+
+static void
+add_pending_module (GKeyFile *manifest,
+		    const char *filename)
+{
+	PendingModule *pending;
+
+	pending = g_new0 (PendingModule, 1);
+	pending->path = g_strdup (filename);
+	pending->types = g_key_file_get_string_list (manifest, filename,
+						     MANIFEST_KEY_TYPES, NULL, NULL);
+	if (pending->types == NULL) {
+		pending->types = g_new0 (char *, 1);
+	}
+
+	pending_modules = g_list_append (pending_modules, pending);
+
+	DEBUG ("Deferring extension module %s", filename);
+}
+
+static void
+pending_module_free (PendingModule *pending)
+{
+	g_free (pending->path);
+	g_strfreev (pending->types);
+	g_free (pending);
+}
+
+/* Loads a module that is new or has changed and records what it
+ * provides. Returns TRUE if the manifest was changed.
+ */
+static gboolean
+load_and_record_module (GKeyFile *manifest,
+			const char *filename,
+			GStatBuf *buf)
+{
+	NemoModule *module;
+	GList *stop;
+	char **types;
+
+	stop = module_objects;
+
+	module = nemo_module_load_file (filename);
+	if (module == NULL) {
+		/* Try it again next time */
+		return g_key_file_remove_group (manifest, filename, NULL);
+	}
+
+	types = get_extension_types (stop);
+
+	/* Without types of its own, what the module provides next time
+	 * can't be told from the module file alone.
+	 */
+	g_key_file_set_boolean (manifest, filename, MANIFEST_KEY_DEFER,
+				module->registers_own_types);
+
+	g_key_file_set_int64 (manifest, filename, MANIFEST_KEY_MTIME, buf->st_mtime);
+	g_key_file_set_int64 (manifest, filename, MANIFEST_KEY_SIZE, buf->st_size);
+	g_key_file_set_string_list (manifest, filename, MANIFEST_KEY_TYPES,
+				    (const char * const *) types, g_strv_length (types));
+
+	g_strfreev (types);
+
+	return TRUE;
+}
+
+static void
+save_manifest (GKeyFile *manifest)
+{
+	char *path, *dirname, *data;
+	gsize length;
+	GError *error;
+
+	path = get_manifest_path ();
+	dirname = g_path_get_dirname (path);
+	data = g_key_file_to_data (manifest, &length, NULL);
+
+	error = NULL;
+	if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+	    !g_file_set_contents (path, data, length, &error)) {
+		DEBUG ("Could not save the extension manifest: %s",
+		       error != NULL ? error->message : g_strerror (errno));
+		g_clear_error (&error);
+	}
+
+	g_free (data);
+	g_free (dirname);
+	g_free (path);
+}
+
 static void
 load_module_dir (const char *dirname)
 {
 	GDir *dir;
+	GKeyFile *manifest;
+	char *manifest_path;
+	char **groups;
+	gboolean manifest_changed;
+	GStatBuf buf;
+	int i;
+
+	manifest_path = get_manifest_path ();
+	manifest = g_key_file_new ();
+	g_key_file_load_from_file (manifest, manifest_path, G_KEY_FILE_NONE, NULL);
+	g_free (manifest_path);
+
+	manifest_changed = FALSE;
 	
 	dir = g_dir_open (dirname, 0, NULL);
 	
@@ -217,19 +440,117 @@ load_module_dir (const char *dirname)
 				filename = g_build_filename (dirname, 
 							     name, 
 							     NULL);
-				nemo_module_load_file (filename);
+				if (g_stat (filename, &buf) != 0) {
+					/* Nothing to record it by */
+					nemo_module_load_file (filename);
+				} else if (!manifest_entry_is_current (manifest, filename, &buf)) {
+					manifest_changed |= load_and_record_module (manifest, filename, &buf);
+				} else if (g_key_file_get_boolean (manifest, filename,
+								   MANIFEST_KEY_DEFER, NULL)) {
+					add_pending_module (manifest, filename);
+				} else {
+					nemo_module_load_file (filename);
+				}
 				g_free (filename);
 			}
 		}
 
 		g_dir_close (dir);
 	}
+
+	/* Forget modules that are gone */
+	groups = g_key_file_get_groups (manifest, NULL);
+	for (i = 0; groups[i] != NULL; i++) {
+		if (!g_file_test (groups[i], G_FILE_TEST_EXISTS)) {
+			g_key_file_remove_group (manifest, groups[i], NULL);
+			manifest_changed = TRUE;
+		}
+	}
+	g_strfreev (groups);
+
+	if (manifest_changed) {
+		save_manifest (manifest);
+	}
+
+	g_key_file_free (manifest);
+}
+
+static void
+load_pending_modules_for_type (GType type)
+{
+	GList *l, *next, *to_load;
+	PendingModule *pending;
+	const char *name;
+
+	if (pending_modules == NULL) {
+		return;
+	}
+
+	name = g_type_name (type);
+
+	/* Take them off the list first; loading may ask for extensions */
+	to_load = NULL;
+	for (l = pending_modules; l != NULL; l = next) {
+		next = l->next;
+		pending = l->data;
+		if (!G_TYPE_IS_INTERFACE (type) ||
+		    strv_has_string (pending->types, name)) {
+			pending_modules = g_list_remove_link (pending_modules, l);
+			to_load = g_list_concat (to_load, l);
+		}
+	}
+
+	for (l = to_load; l != NULL; l = l->next) {
+		pending = l->data;
+		nemo_module_load_file (pending->path);
+		pending_module_free (pending);
+	}
+	g_list_free (to_load);
+}
+
+/* Loads the remaining modules one at a time while nemo is idle, so
+ * the first use of an extension doesn't have to wait for it.
+ */
+static gboolean
+preload_next_module (gpointer user_data)
+{
+	PendingModule *pending;
+
+	if (pending_modules == NULL ||
+	    !g_settings_get_boolean (nemo_preferences, NEMO_PREFERENCES_PRELOAD_EXTENSIONS)) {
+		preload_idle_id = 0;
+		return FALSE;
+	}
+
+	pending = pending_modules->data;
+	pending_modules = g_list_delete_link (pending_modules, pending_modules);
+
+	nemo_module_load_file (pending->path);
+	pending_module_free (pending);
+
+	if (pending_modules == NULL) {
+		preload_idle_id = 0;
+		return FALSE;
+	}
+
+	return TRUE;
 }
 
 static void
 free_module_objects (void)
 {
 	GList *l, *next;
+
+	if (preload_idle_id != 0) {
+		g_source_remove (preload_idle_id);
+		preload_idle_id = 0;
+	}
+
+	g_list_free_full (pending_modules, (GDestroyNotify) pending_module_free);
+	pending_modules = NULL;
+
+	g_list_free_full (extension_watches, g_free);
+	extension_watches = NULL;
 	
 	for (l = module_objects; l != NULL; l = next) {
 		next = l->next;
@@ -249,6 +570,12 @@ nemo_module_setup (void)
 		
 		load_module_dir (NEMO_EXTENSIONDIR);
 
+		if (pending_modules != NULL) {
+			preload_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+							   preload_next_module,
+							   NULL, NULL);
+		}
+
 		eel_debug_call_at_shutdown (free_module_objects);
 	}
 }
@@ -258,6 +585,8 @@ nemo_module_get_extensions_for_type (GType type)
 {
 	GList *l;
 	GList *ret = NULL;
+
+	load_pending_modules_for_type (type);
 	
 	for (l = module_objects; l != NULL; l = l->next) {
 		if (G_TYPE_CHECK_INSTANCE_TYPE (G_OBJECT (l->data),
@@ -286,6 +615,8 @@ void
 nemo_module_add_type (GType type)
 {
 	GObject *object;
+	ExtensionWatch *watch;
+	GList *l;
 	
 	object = g_object_new (type, NULL);
 	g_object_weak_ref (object, 
@@ -293,4 +624,33 @@ nemo_module_add_type (GType type)
 			   NULL);
 
 	module_objects = g_list_prepend (module_objects, object);
+
+	for (l = extension_watches; l != NULL; l = l->next) {
+		watch = l->data;
+		if (G_TYPE_CHECK_INSTANCE_TYPE (object, watch->type)) {
+			watch->func (object, watch->user_data);
+		}
+	}
+}
+
+void
+nemo_module_watch_extensions_for_type (GType    type,
+				       GFunc    func,
+				       gpointer user_data)
+{
+	ExtensionWatch *watch;
+	GList *l;
+
+	watch = g_new0 (ExtensionWatch, 1);
+	watch->type = type;
+	watch->func = func;
+	watch->user_data = user_data;
+
+	extension_watches = g_list_prepend (extension_watches, watch);
+
+	for (l = module_objects; l != NULL; l = l->next) {
+		if (G_TYPE_CHECK_INSTANCE_TYPE (l->data, type)) {
+			func (l->data, user_data);
+		}
+	}
 }
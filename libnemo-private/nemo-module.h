@@ -32,6 +32,12 @@ void   nemo_module_setup                   (void);
 GList *nemo_module_get_extensions_for_type (GType  type);
 void   nemo_module_extension_list_free     (GList *list);
 
+/* Calls func for each extension of type, now and whenever one is
+ * loaded later. Does not load any modules itself. */
+void   nemo_module_watch_extensions_for_type (GType    type,
+                                              GFunc    func,
+                                              gpointer user_data);
+
 
 /* Add a type to the module interface - allows nemo to add its own modules
  * without putting them in separate shared libraries */
@@ -27,14 +27,24 @@
 #include <config.h>
 #include "nemo-monitor.h"
 #include "nemo-file-changes-queue.h"
+#include "nemo-directory-private.h"
 #include "nemo-file-utilities.h"
 
 #include <gio/gio.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 struct NemoMonitor {
 	GFileMonitor *monitor;
     GVolumeMonitor *volume_monitor;
     GFile *location;
+    /* Watch in the shared inotify instance, 0 if none */
+    int watch_descriptor;
 };
 
 gboolean
@@ -61,22 +71,36 @@ nemo_monitor_active (void)
 	return monitor_success;
 }
 
-static gboolean call_consume_changes_idle_id = 0;
+/* Changes that come within this long of the last pass are part of a
+ * burst; they wait up to CONSUME_CHANGES_LATENCY_MSEC so that they can be
+ * coalesced, instead of each being sent off on its own.
+ */
+#define CONSUME_CHANGES_BURST_USEC (250 * 1000)
+#define CONSUME_CHANGES_LATENCY_MSEC 100
+
+static guint call_consume_changes_idle_id = 0;
+static gint64 last_consume_changes_time = 0;
 
 static gboolean
 call_consume_changes_idle_cb (gpointer not_used)
 {
-	nemo_file_changes_consume_changes (TRUE);
+	last_consume_changes_time = g_get_monotonic_time ();
 	call_consume_changes_idle_id = 0;
+	nemo_file_changes_consume_changes (TRUE);
 	return FALSE;
 }
 
-
+static void
 schedule_call_consume_changes (void)
 {
   if (call_consume_changes_idle_id == 0) {
-      call_consume_changes_idle_id =
-          g_idle_add (call_consume_changes_idle_cb, NULL);
+      if (g_get_monotonic_time () - last_consume_changes_time < CONSUME_CHANGES_BURST_USEC) {
+          call_consume_changes_idle_id =
+              g_timeout_add (CONSUME_CHANGES_LATENCY_MSEC, call_consume_changes_idle_cb, NULL);
+      } else {
+          call_consume_changes_idle_id =
+              g_idle_add (call_consume_changes_idle_cb, NULL);
+      }
   }
 }
 
@@ -105,14 +129,6 @@ dir_changed (GFileMonitor* monitor,
 	     GFileMonitorEvent event_type,
 	     gpointer user_data)
 {
-	char *uri, *to_uri;
-	
-	uri = g_file_get_uri (child);
-	to_uri = NULL;
-	if (other_file) {
-		to_uri = g_file_get_uri (other_file);
-	}
-
 	switch (event_type) {
 	default:
 	case G_FILE_MONITOR_EVENT_CHANGED:
@@ -137,11 +153,552 @@ dir_changed (GFileMonitor* monitor,
 		break;
 	}
 
-	g_free (uri);
-	g_free (to_uri);
-
     schedule_call_consume_changes ();
 }
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Local directories are all watched through one inotify instance, rather
+ * than a GFileMonitor (and with it, a GIO inotify watch and main loop
+ * dispatch) each. A worker thread reads the events and merges the ones
+ * for the same file that arrive within INOTIFY_COALESCE_USEC of the first
+ * one, so a file created and deleted right away is never reported, and
+ * many changes to one file are reported once. The batch is then handed
+ * to the file changes queue from the main loop.
+ *
+ * A file that is being written to is reported at most once every
+ * INOTIFY_MODIFY_INTERVAL_USEC, and once more when it is closed, so that
+ * a long download or copy shows its size growing without a reload for
+ * every write.
+ */
+
+#define INOTIFY_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+			    IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | \
+			    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+#define INOTIFY_COALESCE_USEC (50 * 1000)
+#define INOTIFY_MODIFY_INTERVAL_USEC (1000 * 1000)
+
+/* Most distinct files in one batch */
+#define INOTIFY_MAX_BATCH_FILES 4096
+
+typedef enum {
+	MONITOR_EVENT_NONE,
+	MONITOR_EVENT_ADDED,
+	MONITOR_EVENT_CHANGED,
+	MONITOR_EVENT_REMOVED,
+	/* removed, then added again */
+	MONITOR_EVENT_REPLACED
+} MonitorEventKind;
+
+typedef struct {
+	MonitorEventKind kind;
+	char *path;
+} MonitorEvent;
+
+typedef struct {
+	/* in the order the files were first seen */
+	GArray *events;
+	/* path -> index in events + 1 */
+	GHashTable *indices;
+	/* The kernel dropped events, so none of the above can be trusted */
+	gboolean overflowed;
+} MonitorEventBatch;
+
+typedef struct {
+	char *path;
+	int n_monitors;
+} InotifyWatch;
+
+typedef struct {
+	gint64 reported_time;
+	/* Written to again since it was reported */
+	gboolean pending;
+} ModifiedFile;
+
+static int inotify_fd = -1;
+/* wd -> InotifyWatch, shared with the worker thread */
+static GHashTable *inotify_watches = NULL;
+static GMutex inotify_watches_mutex;
+/* path -> ModifiedFile, only used by the worker thread */
+static GHashTable *modified_files = NULL;
+
+static MonitorEventKind
+merge_event_kinds (MonitorEventKind old_kind, MonitorEventKind new_kind)
+{
+	switch (old_kind) {
+	case MONITOR_EVENT_ADDED:
+		if (new_kind == MONITOR_EVENT_REMOVED) {
+			/* Came and went, nobody needs to know */
+			return MONITOR_EVENT_NONE;
+		}
+		return MONITOR_EVENT_ADDED;
+	case MONITOR_EVENT_CHANGED:
+		return new_kind;
+	case MONITOR_EVENT_REMOVED:
+	case MONITOR_EVENT_REPLACED:
+		if (new_kind == MONITOR_EVENT_REMOVED) {
+			return MONITOR_EVENT_REMOVED;
+		}
+		return MONITOR_EVENT_REPLACED;
+	case MONITOR_EVENT_NONE:
+	default:
+		return new_kind;
+	}
+}
+
+static MonitorEventBatch *
+monitor_event_batch_new (void)
+{
+	MonitorEventBatch *batch;
+
+	batch = g_new0 (MonitorEventBatch, 1);
+	batch->events = g_array_new (FALSE, FALSE, sizeof (MonitorEvent));
+	batch->indices = g_hash_table_new (g_str_hash, g_str_equal);
+
+	return batch;
+}
+
+static void
+monitor_event_batch_free (MonitorEventBatch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->events->len; i++) {
+		g_free (g_array_index (batch->events, MonitorEvent, i).path);
+	}
+	g_array_free (batch->events, TRUE);
+	g_hash_table_destroy (batch->indices);
+	g_free (batch);
+}
+
+/* Takes ownership of path */
+static void
+monitor_event_batch_add (MonitorEventBatch *batch,
+			 char *path,
+			 MonitorEventKind kind)
+{
+	MonitorEvent event, *existing;
+	guint index;
+
+	index = GPOINTER_TO_UINT (g_hash_table_lookup (batch->indices, path));
+	if (index != 0) {
+		existing = &g_array_index (batch->events, MonitorEvent, index - 1);
+		existing->kind = merge_event_kinds (existing->kind, kind);
+		g_free (path);
+		return;
+	}
+
+	event.kind = kind;
+	event.path = path;
+	g_array_append_val (batch->events, event);
+	g_hash_table_insert (batch->indices, path,
+			     GUINT_TO_POINTER (batch->events->len));
+}
+
+/* Returns whether a write to path should be reported now; if not, it is
+ * reported once the interval is over.
+ */
+static gboolean
+note_modified_file (const char *path)
+{
+	ModifiedFile *modified;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+
+	modified = g_hash_table_lookup (modified_files, path);
+	if (modified == NULL) {
+		modified = g_new0 (ModifiedFile, 1);
+		g_hash_table_insert (modified_files, g_strdup (path), modified);
+	} else if (now - modified->reported_time < INOTIFY_MODIFY_INTERVAL_USEC) {
+		modified->pending = TRUE;
+		return FALSE;
+	}
+
+	modified->reported_time = now;
+	modified->pending = FALSE;
+
+	return TRUE;
+}
+
+/* Adds the writes whose interval is over to batch, and forgets the files
+ * that weren't written to during it. Returns how many milliseconds until
+ * the next one is due, or -1 if none is waiting.
+ */
+static int
+add_due_modified_files (MonitorEventBatch *batch)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	ModifiedFile *modified;
+	gint64 now, due, next_due;
+
+	now = g_get_monotonic_time ();
+	next_due = -1;
+
+	g_hash_table_iter_init (&iter, modified_files);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		modified = value;
+		due = modified->reported_time + INOTIFY_MODIFY_INTERVAL_USEC;
+
+		if (due <= now) {
+			if (!modified->pending) {
+				g_hash_table_iter_remove (&iter);
+				continue;
+			}
+			monitor_event_batch_add (batch, g_strdup (key), MONITOR_EVENT_CHANGED);
+			modified->reported_time = now;
+			modified->pending = FALSE;
+			due = now + INOTIFY_MODIFY_INTERVAL_USEC;
+		}
+
+		if (next_due < 0 || due < next_due) {
+			next_due = due;
+		}
+	}
+
+	if (next_due < 0) {
+		return -1;
+	}
+	return (next_due - now + 999) / 1000;
+}
+
+static void
+add_inotify_events (MonitorEventBatch *batch,
+		    const char *buffer,
+		    gssize length)
+{
+	const struct inotify_event *event;
+	InotifyWatch *watch;
+	MonitorEventKind kind;
+	const char *p;
+	char *path;
+
+	g_mutex_lock (&inotify_watches_mutex);
+
+	for (p = buffer; p < buffer + length; p += sizeof (struct inotify_event) + event->len) {
+		event = (const struct inotify_event *) p;
+
+		if (event->mask & IN_Q_OVERFLOW) {
+			batch->overflowed = TRUE;
+			continue;
+		}
+
+		watch = g_hash_table_lookup (inotify_watches, GINT_TO_POINTER (event->wd));
+		if (watch == NULL) {
+			continue;
+		}
+
+		if (event->mask & IN_IGNORED) {
+			/* The directory is gone, and the kernel dropped the watch */
+			g_hash_table_remove (inotify_watches, GINT_TO_POINTER (event->wd));
+			continue;
+		}
+
+		if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+			kind = MONITOR_EVENT_ADDED;
+		} else if (event->mask & (IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF)) {
+			kind = MONITOR_EVENT_REMOVED;
+		} else if (event->mask & (IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE)) {
+			kind = MONITOR_EVENT_CHANGED;
+		} else {
+			continue;
+		}
+
+		if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+			path = g_strdup (watch->path);
+		} else if (event->len > 0) {
+			path = g_build_filename (watch->path, event->name, NULL);
+		} else {
+			continue;
+		}
+
+		if (event->mask & IN_MODIFY) {
+			if (!note_modified_file (path)) {
+				g_free (path);
+				continue;
+			}
+		} else if (event->mask & (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM)) {
+			/* Done writing, or gone */
+			g_hash_table_remove (modified_files, path);
+		}
+
+		monitor_event_batch_add (batch, path, kind);
+
+		if (event->mask & IN_MOVE_SELF) {
+			/* The watch follows the directory, but its path is
+			 * stale now; it is watched again if it is reloaded.
+			 */
+			g_hash_table_remove (inotify_watches, GINT_TO_POINTER (event->wd));
+			inotify_rm_watch (inotify_fd, event->wd);
+		}
+	}
+
+	g_mutex_unlock (&inotify_watches_mutex);
+}
+
+/* After an overflow there is no telling what changed, so every
+ * watched directory is read again.
+ */
+static void
+reload_watched_directories (void)
+{
+	GHashTableIter iter;
+	InotifyWatch *watch;
+	NemoDirectory *directory;
+	GList *locations, *l;
+
+	locations = NULL;
+
+	g_mutex_lock (&inotify_watches_mutex);
+	g_hash_table_iter_init (&iter, inotify_watches);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &watch)) {
+		locations = g_list_prepend (locations, g_file_new_for_path (watch->path));
+	}
+	g_mutex_unlock (&inotify_watches_mutex);
+
+	for (l = locations; l != NULL; l = l->next) {
+		directory = nemo_directory_get_existing (l->data);
+		if (directory != NULL) {
+			nemo_directory_force_reload (directory);
+			nemo_directory_unref (directory);
+		}
+	}
+
+	g_list_free_full (locations, g_object_unref);
+}
+
+static gboolean
+deliver_monitor_event_batch (gpointer data)
+{
+	MonitorEventBatch *batch = data;
+	MonitorEvent *event;
+	GFile *file;
+	guint i;
+
+	if (batch->overflowed) {
+		monitor_event_batch_free (batch);
+		reload_watched_directories ();
+		return FALSE;
+	}
+
+	for (i = 0; i < batch->events->len; i++) {
+		event = &g_array_index (batch->events, MonitorEvent, i);
+		if (event->kind == MONITOR_EVENT_NONE) {
+			continue;
+		}
+
+		file = g_file_new_for_path (event->path);
+
+		switch (event->kind) {
+		case MONITOR_EVENT_ADDED:
+			nemo_file_changes_queue_file_added (file);
+			break;
+		case MONITOR_EVENT_CHANGED:
+			nemo_file_changes_queue_file_changed (file);
+			break;
+		case MONITOR_EVENT_REMOVED:
+			nemo_file_changes_queue_file_removed (file);
+			break;
+		case MONITOR_EVENT_REPLACED:
+			nemo_file_changes_queue_file_removed (file);
+			nemo_file_changes_queue_file_added (file);
+			break;
+		case MONITOR_EVENT_NONE:
+		default:
+			break;
+		}
+
+		g_object_unref (file);
+	}
+
+	monitor_event_batch_free (batch);
+
+	schedule_call_consume_changes ();
+
+	return FALSE;
+}
+
+static gpointer
+inotify_thread_func (gpointer data)
+{
+	/* struct inotify_event needs the alignment of an int */
+	int buffer[4096];
+	MonitorEventBatch *batch;
+	struct pollfd poll_fd;
+	gint64 deadline, remaining;
+	gssize length;
+	int timeout, n_ready;
+
+	poll_fd.fd = inotify_fd;
+	poll_fd.events = POLLIN;
+
+	for (;;) {
+		batch = monitor_event_batch_new ();
+
+		/* Wait for the first event, unless a write is due... */
+		timeout = add_due_modified_files (batch);
+		if (batch->events->len == 0) {
+			n_ready = poll (&poll_fd, 1, timeout);
+			if (n_ready <= 0) {
+				monitor_event_batch_free (batch);
+				if (n_ready == 0 || errno == EINTR) {
+					continue;
+				}
+				g_warning ("Waiting for file change events failed: %s", g_strerror (errno));
+				return NULL;
+			}
+
+			length = read (inotify_fd, buffer, sizeof (buffer));
+			if (length < 0) {
+				monitor_event_batch_free (batch);
+				if (errno == EINTR) {
+					continue;
+				}
+				g_warning ("Reading file change events failed: %s", g_strerror (errno));
+				return NULL;
+			}
+
+			add_inotify_events (batch, (const char *) buffer, length);
+		}
+
+		/* ...and for the ones that follow it closely */
+		deadline = g_get_monotonic_time () + INOTIFY_COALESCE_USEC;
+		while (g_hash_table_size (batch->indices) < INOTIFY_MAX_BATCH_FILES) {
+			remaining = deadline - g_get_monotonic_time ();
+			if (remaining <= 0 ||
+			    poll (&poll_fd, 1, (remaining + 999) / 1000) <= 0) {
+				break;
+			}
+
+			length = read (inotify_fd, buffer, sizeof (buffer));
+			if (length <= 0) {
+				break;
+			}
+			add_inotify_events (batch, (const char *) buffer, length);
+		}
+
+		if (batch->events->len > 0 || batch->overflowed) {
+			g_idle_add (deliver_monitor_event_batch, batch);
+		} else {
+			monitor_event_batch_free (batch);
+		}
+	}
+
+	return NULL;
+}
+
+static void
+inotify_watch_free (InotifyWatch *watch)
+{
+	g_free (watch->path);
+	g_free (watch);
+}
+
+static gboolean
+ensure_inotify (void)
+{
+	static gboolean tried_inotify = FALSE;
+	GThread *thread;
+
+	if (tried_inotify) {
+		return inotify_fd >= 0;
+	}
+	tried_inotify = TRUE;
+
+	inotify_fd = inotify_init ();
+	if (inotify_fd < 0) {
+		return FALSE;
+	}
+
+	inotify_watches = g_hash_table_new_full (NULL, NULL, NULL,
+						 (GDestroyNotify) inotify_watch_free);
+	modified_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	thread = g_thread_new ("nemo-monitor", inotify_thread_func, NULL);
+	g_thread_unref (thread);
+
+	return TRUE;
+}
+
+/* Returns the watch descriptor, or 0 if the directory couldn't be
+ * watched this way, in which case a GFileMonitor is used.
+ */
+static int
+add_inotify_watch (GFile *location)
+{
+	InotifyWatch *watch;
+	char *path;
+	int wd;
+
+	/* gvfs mounts have a FUSE path too, but changes made on the
+	 * remote side never show up there; those need GIO's own monitor.
+	 */
+	if (!g_file_is_native (location)) {
+		return 0;
+	}
+
+	path = g_file_get_path (location);
+	if (path == NULL || !ensure_inotify ()) {
+		g_free (path);
+		return 0;
+	}
+
+	/* Watching the same directory twice gives the same descriptor */
+	wd = inotify_add_watch (inotify_fd, path, INOTIFY_WATCH_MASK);
+	if (wd <= 0) {
+		g_free (path);
+		return 0;
+	}
+
+	g_mutex_lock (&inotify_watches_mutex);
+
+	watch = g_hash_table_lookup (inotify_watches, GINT_TO_POINTER (wd));
+	if (watch == NULL) {
+		watch = g_new0 (InotifyWatch, 1);
+		watch->path = path;
+		g_hash_table_insert (inotify_watches, GINT_TO_POINTER (wd), watch);
+	} else {
+		g_free (path);
+	}
+	watch->n_monitors++;
+
+	g_mutex_unlock (&inotify_watches_mutex);
+
+	return wd;
+}
+
+static void
+remove_inotify_watch (int wd)
+{
+	InotifyWatch *watch;
+
+	g_mutex_lock (&inotify_watches_mutex);
+
+	watch = g_hash_table_lookup (inotify_watches, GINT_TO_POINTER (wd));
+	if (watch != NULL && --watch->n_monitors == 0) {
+		g_hash_table_remove (inotify_watches, GINT_TO_POINTER (wd));
+		inotify_rm_watch (inotify_fd, wd);
+	}
+
+	g_mutex_unlock (&inotify_watches_mutex);
+}
+
+#else
+
+static int
+add_inotify_watch (GFile *location)
+{
+	return 0;
+}
+
+static void
+remove_inotify_watch (int wd)
+{
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
  
 NemoMonitor *
 nemo_monitor_directory (GFile *location)
@@ -150,6 +707,12 @@ nemo_monitor_directory (GFile *location)
 	NemoMonitor *ret;
 
     ret = g_new0 (NemoMonitor, 1);
+
+    ret->watch_descriptor = add_inotify_watch (location);
+    if (ret->watch_descriptor != 0) {
+        return ret;
+    }
+
 	dir_monitor = g_file_monitor_directory (location, G_FILE_MONITOR_WATCH_MOUNTS, NULL, NULL);
 
     if (dir_monitor != NULL) {
@@ -177,6 +740,10 @@ nemo_monitor_directory (GFile *location)
 void 
 nemo_monitor_cancel (NemoMonitor *monitor)
 {
+	if (monitor->watch_descriptor != 0) {
+		remove_inotify_watch (monitor->watch_descriptor);
+	}
+
 	if (monitor->monitor != NULL) {
 		g_signal_handlers_disconnect_by_func (monitor->monitor, dir_changed, monitor);
 		g_file_monitor_cancel (monitor->monitor);
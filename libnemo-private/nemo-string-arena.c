@@ -0,0 +1,210 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-string-arena.c: Block allocator for many small, long-lived strings.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-string-arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Blocks are aligned to their size, so the block a string lives in
+ * can be found by masking its address.
+ */
+#define ARENA_BLOCK_SIZE 16384
+
+/* Longer strings get a block of their own */
+#define ARENA_MAX_PACKED_STRING (ARENA_BLOCK_SIZE / 8)
+
+typedef struct {
+	NemoStringArena *arena;
+	gsize size;
+	gsize used;
+	guint n_live;
+} ArenaBlock;
+
+#define ARENA_BLOCK_HEADER_SIZE \
+	((sizeof (ArenaBlock) + sizeof (gpointer) - 1) & ~(sizeof (gpointer) - 1))
+
+struct NemoStringArena {
+	/* One for the owner and one for each block */
+	int ref_count;
+	ArenaBlock *current;
+
+	gsize allocated;
+	gsize used;
+};
+
+NemoStringArena *
+nemo_string_arena_new (void)
+{
+	NemoStringArena *arena;
+
+	arena = g_new0 (NemoStringArena, 1);
+	arena->ref_count = 1;
+
+	return arena;
+}
+
+static void
+arena_unref (NemoStringArena *arena)
+{
+	if (--arena->ref_count == 0) {
+		g_assert (arena->current == NULL);
+		g_free (arena);
+	}
+}
+
+static ArenaBlock *
+block_new (NemoStringArena *arena, gsize size)
+{
+	ArenaBlock *block;
+	gpointer mem;
+
+	if (posix_memalign (&mem, ARENA_BLOCK_SIZE, size) != 0) {
+		g_error ("%s: failed to allocate %" G_GSIZE_FORMAT " bytes",
+			 G_STRLOC, size);
+	}
+
+	block = mem;
+	block->arena = arena;
+	block->size = size;
+	block->used = ARENA_BLOCK_HEADER_SIZE;
+	block->n_live = 0;
+
+	arena->ref_count++;
+	arena->allocated += size;
+
+	return block;
+}
+
+static void
+block_free (ArenaBlock *block)
+{
+	NemoStringArena *arena;
+
+	arena = block->arena;
+	arena->allocated -= block->size;
+	free (block);
+
+	arena_unref (arena);
+}
+
+static void
+retire_current_block (NemoStringArena *arena)
+{
+	ArenaBlock *block;
+
+	block = arena->current;
+	arena->current = NULL;
+
+	if (block != NULL && block->n_live == 0) {
+		block_free (block);
+	}
+}
+
+void
+nemo_string_arena_unref (NemoStringArena *arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	/* Nothing more will be allocated. Blocks that still hold
+	 * strings keep the arena alive until they are released.
+	 */
+	retire_current_block (arena);
+	arena_unref (arena);
+}
+
+char *
+nemo_string_arena_strdup (NemoStringArena *arena,
+			  const char *str)
+{
+	ArenaBlock *block;
+	gsize len;
+	char *copy;
+
+	if (str == NULL) {
+		return NULL;
+	}
+
+	len = strlen (str) + 1;
+
+	if (len > ARENA_MAX_PACKED_STRING) {
+		block = block_new (arena, ARENA_BLOCK_HEADER_SIZE + len);
+	} else {
+		block = arena->current;
+		if (block == NULL || block->used + len > block->size) {
+			retire_current_block (arena);
+			block = block_new (arena, ARENA_BLOCK_SIZE);
+			arena->current = block;
+		}
+	}
+
+	copy = (char *) block + block->used;
+	memcpy (copy, str, len);
+	block->used += len;
+	block->n_live++;
+	arena->used += len;
+
+	return copy;
+}
+
+void
+nemo_string_arena_release (char *str)
+{
+	ArenaBlock *block;
+	NemoStringArena *arena;
+
+	if (str == NULL) {
+		return;
+	}
+
+	block = (ArenaBlock *) ((guintptr) str & ~((guintptr) ARENA_BLOCK_SIZE - 1));
+	arena = block->arena;
+
+	g_assert (block->n_live > 0);
+
+	arena->used -= strlen (str) + 1;
+
+	if (--block->n_live > 0) {
+		return;
+	}
+
+	if (block == arena->current) {
+		/* Start filling the empty block again from the top */
+		block->used = ARENA_BLOCK_HEADER_SIZE;
+	} else {
+		block_free (block);
+	}
+}
+
+void
+nemo_string_arena_get_size (NemoStringArena *arena,
+			    gsize *allocated,
+			    gsize *used)
+{
+	if (allocated != NULL) {
+		*allocated = arena->allocated;
+	}
+	if (used != NULL) {
+		*used = arena->used;
+	}
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-string-arena.h: Block allocator for many small, long-lived strings.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_STRING_ARENA_H
+#define NEMO_STRING_ARENA_H
+
+#include <glib.h>
+
+/* Strings are packed into large blocks instead of being malloced one
+ * by one. A block is freed once every string in it has been released,
+ * so strings can outlive the arena they came from.
+ */
+typedef struct NemoStringArena NemoStringArena;
+
+NemoStringArena *nemo_string_arena_new      (void);
+void             nemo_string_arena_unref    (NemoStringArena *arena);
+
+char *           nemo_string_arena_strdup   (NemoStringArena *arena,
+					     const char      *str);
+/* Does not need the arena; the block is found from the string. */
+void             nemo_string_arena_release  (char            *str);
+
+/* Bytes held in blocks, and bytes of those in use by live strings. */
+void             nemo_string_arena_get_size (NemoStringArena *arena,
+					     gsize           *allocated,
+					     gsize           *used);
+
+#endif /* NEMO_STRING_ARENA_H */
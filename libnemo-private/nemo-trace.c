@@ -0,0 +1,267 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-trace.c: Lightweight timing spans for profiling startup and loading.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-trace.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Nemo can run for a long time; stop recording rather than grow forever */
+#define MAX_EVENTS 100000
+
+#define FLUSH_DELAY_SECONDS 2
+
+typedef struct {
+	const char *category;
+	const char *name;
+	char *detail;
+	gint64 start;
+	gint64 duration; /* -1 for instant events */
+	gpointer thread;
+} TraceEvent;
+
+static gboolean enabled = FALSE;
+static char *trace_filename = NULL;
+static gint64 trace_epoch;
+
+static GMutex trace_lock;
+static GArray *events = NULL;
+static guint flush_timeout_id = 0;
+
+gboolean
+nemo_trace_enabled (void)
+{
+	return enabled;
+}
+
+static void
+flush_at_exit (void)
+{
+	nemo_trace_flush ();
+}
+
+void
+nemo_trace_init (void)
+{
+	const char *filename;
+
+	if (enabled) {
+		return;
+	}
+
+	filename = g_getenv ("NEMO_TRACE");
+	if (filename == NULL || filename[0] == '\0') {
+		return;
+	}
+
+	trace_filename = g_strdup (filename);
+	trace_epoch = g_get_monotonic_time ();
+
+	g_mutex_init (&trace_lock);
+	events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+
+	enabled = TRUE;
+
+	atexit (flush_at_exit);
+}
+
+gint64
+nemo_trace_begin (void)
+{
+	if (!enabled) {
+		return 0;
+	}
+
+	return g_get_monotonic_time ();
+}
+
+static gboolean
+flush_timeout (gpointer user_data)
+{
+	g_mutex_lock (&trace_lock);
+	flush_timeout_id = 0;
+	g_mutex_unlock (&trace_lock);
+
+	nemo_trace_flush ();
+
+	return FALSE;
+}
+
+static void
+add_event (const char *category,
+	   const char *name,
+	   const char *detail,
+	   gint64 start,
+	   gint64 duration)
+{
+	TraceEvent event;
+
+	g_mutex_lock (&trace_lock);
+
+	if (events->len < MAX_EVENTS) {
+		/* Categories and names are always string literals */
+		event.category = category;
+		event.name = name;
+		event.detail = g_strdup (detail);
+		event.start = start;
+		event.duration = duration;
+		event.thread = g_thread_self ();
+		g_array_append_val (events, event);
+
+		if (flush_timeout_id == 0) {
+			flush_timeout_id = g_timeout_add_seconds (FLUSH_DELAY_SECONDS,
+								  flush_timeout, NULL);
+		}
+	}
+
+	g_mutex_unlock (&trace_lock);
+}
+
+void
+nemo_trace_end (gint64 start,
+		const char *category,
+		const char *name,
+		const char *detail)
+{
+	if (!enabled || start == 0) {
+		return;
+	}
+
+	add_event (category, name, detail,
+		   start, g_get_monotonic_time () - start);
+}
+
+void
+nemo_trace_instant (const char *category,
+		    const char *name,
+		    const char *detail)
+{
+	if (!enabled) {
+		return;
+	}
+
+	add_event (category, name, detail, g_get_monotonic_time (), -1);
+}
+
+static void
+append_json_string (GString *json,
+		    const char *str)
+{
+	const char *p;
+
+	g_string_append_c (json, '"');
+	for (p = str; *p != '\0'; p++) {
+		switch (*p) {
+		case '"':
+			g_string_append (json, "\\\"");
+			break;
+		case '\\':
+			g_string_append (json, "\\\\");
+			break;
+		default:
+			if ((guchar) *p < 0x20) {
+				g_string_append_printf (json, "\\u%04x", (guchar) *p);
+			} else {
+				g_string_append_c (json, *p);
+			}
+			break;
+		}
+	}
+	g_string_append_c (json, '"');
+}
+
+/* Thread ids only need to tell threads apart within one trace */
+static guint
+get_thread_id (GHashTable *thread_ids,
+	       gpointer thread)
+{
+	guint id;
+
+	id = GPOINTER_TO_UINT (g_hash_table_lookup (thread_ids, thread));
+	if (id == 0) {
+		id = g_hash_table_size (thread_ids) + 1;
+		g_hash_table_insert (thread_ids, thread, GUINT_TO_POINTER (id));
+	}
+
+	return id;
+}
+
+void
+nemo_trace_flush (void)
+{
+	GString *json;
+	GHashTable *thread_ids;
+	TraceEvent *event;
+	GError *error;
+	guint i;
+
+	if (!enabled) {
+		return;
+	}
+
+	json = g_string_new ("{\"traceEvents\":[\n");
+	thread_ids = g_hash_table_new (NULL, NULL);
+
+	g_mutex_lock (&trace_lock);
+
+	for (i = 0; i < events->len; i++) {
+		event = &g_array_index (events, TraceEvent, i);
+
+		g_string_append (json, "{\"cat\":");
+		append_json_string (json, event->category);
+		g_string_append (json, ",\"name\":");
+		append_json_string (json, event->name);
+		if (event->duration >= 0) {
+			g_string_append_printf (json,
+						",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT
+						",\"dur\":%" G_GINT64_FORMAT,
+						event->start - trace_epoch,
+						event->duration);
+		} else {
+			g_string_append_printf (json,
+						",\"ph\":\"i\",\"s\":\"p\",\"ts\":%" G_GINT64_FORMAT,
+						event->start - trace_epoch);
+		}
+		g_string_append_printf (json, ",\"pid\":%d,\"tid\":%u",
+					(int) getpid (),
+					get_thread_id (thread_ids, event->thread));
+		if (event->detail != NULL) {
+			g_string_append (json, ",\"args\":{\"detail\":");
+			append_json_string (json, event->detail);
+			g_string_append_c (json, '}');
+		}
+		g_string_append (json, i + 1 < events->len ? "},\n" : "}\n");
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	g_string_append (json, "]}\n");
+
+	error = NULL;
+	if (!g_file_set_contents (trace_filename, json->str, json->len, &error)) {
+		g_warning ("Could not write trace to %s: %s",
+			   trace_filename, error->message);
+		g_error_free (error);
+	}
+
+	g_hash_table_destroy (thread_ids);
+	g_string_free (json, TRUE);
+}
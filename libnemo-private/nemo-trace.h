@@ -0,0 +1,53 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-trace.h: Lightweight timing spans for profiling startup and loading.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_TRACE_H
+#define NEMO_TRACE_H
+
+#include <glib.h>
+
+/* Tracing is off unless NEMO_TRACE is set to the name of a file, which
+ * is then written in Chrome's trace event format (load it in
+ * chrome://tracing or Perfetto). When off, every call is a single
+ * check of a flag.
+ *
+ *	gint64 start = nemo_trace_begin ();
+ *	...
+ *	nemo_trace_end (start, "startup", "Load modules", NULL);
+ */
+
+void     nemo_trace_init     (void);
+gboolean nemo_trace_enabled  (void);
+
+/* Returns 0 when tracing is off; nemo_trace_end ignores such spans. */
+gint64   nemo_trace_begin    (void);
+void     nemo_trace_end      (gint64      start,
+			      const char *category,
+			      const char *name,
+			      const char *detail);
+void     nemo_trace_instant  (const char *category,
+			      const char *name,
+			      const char *detail);
+
+/* Writes out everything recorded so far. This also happens shortly
+ * after new events come in, and at exit. */
+void     nemo_trace_flush    (void);
+
+#endif /* NEMO_TRACE_H */
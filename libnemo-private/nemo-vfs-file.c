@@ -30,6 +30,7 @@
 #include "nemo-directory-private.h"
 #include "nemo-file-private.h"
 #include <glib/gi18n.h>
+#include <string.h>
 
 G_DEFINE_TYPE (NemoVFSFile, nemo_vfs_file, NEMO_TYPE_FILE);
 
@@ -82,6 +83,97 @@ vfs_file_check_if_ready (NemoFile *file,
 		 file_attributes);
 }
 
+/* Metadata writes are collected for a short while and then written with
+ * one g_file_set_attributes_async() call per file, grouped by directory.
+ * The file's metadata is updated right away, so it doesn't have to be
+ * read back after the write.
+ */
+#define METADATA_WRITE_DELAY_MSEC 100
+
+typedef struct {
+	NemoFile *file;
+	GFileInfo *info;
+	gboolean changed;
+	guint serial;
+} MetadataWrite;
+
+/* NemoFile -> MetadataWrite */
+static GHashTable *pending_metadata_writes = NULL;
+static guint pending_metadata_writes_timeout_id = 0;
+
+/* NemoFile -> (GIO key -> serial of the newest write that sets it).
+ * A write that finishes only re-applies the keys it is still the
+ * newest writer of.
+ */
+static GHashTable *newest_metadata_writes = NULL;
+static guint metadata_write_serial = 0;
+
+static void
+set_newest_metadata_write (MetadataWrite *write,
+			   const char *gio_key)
+{
+	GHashTable *keys;
+
+	if (newest_metadata_writes == NULL) {
+		newest_metadata_writes = g_hash_table_new_full
+			(NULL, NULL, NULL, (GDestroyNotify) g_hash_table_destroy);
+	}
+
+	keys = g_hash_table_lookup (newest_metadata_writes, write->file);
+	if (keys == NULL) {
+		keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (newest_metadata_writes, write->file, keys);
+	}
+
+	g_hash_table_insert (keys, g_strdup (gio_key),
+			     GUINT_TO_POINTER (write->serial));
+}
+
+static gboolean
+is_newest_metadata_write (MetadataWrite *write,
+			  const char *gio_key)
+{
+	GHashTable *keys;
+
+	keys = g_hash_table_lookup (newest_metadata_writes, write->file);
+	return keys != NULL &&
+		GPOINTER_TO_UINT (g_hash_table_lookup (keys, gio_key)) == write->serial;
+}
+
+/* Forgets the keys this write was the newest writer of */
+static void
+metadata_write_done (MetadataWrite *write)
+{
+	GHashTable *keys;
+	char **attributes;
+	int i;
+
+	keys = g_hash_table_lookup (newest_metadata_writes, write->file);
+	if (keys == NULL) {
+		return;
+	}
+
+	attributes = g_file_info_list_attributes (write->info, "metadata");
+	for (i = 0; attributes[i] != NULL; i++) {
+		if (is_newest_metadata_write (write, attributes[i])) {
+			g_hash_table_remove (keys, attributes[i]);
+		}
+	}
+	g_strfreev (attributes);
+
+	if (g_hash_table_size (keys) == 0) {
+		g_hash_table_remove (newest_metadata_writes, write->file);
+	}
+}
+
+static void
+metadata_write_free (MetadataWrite *write)
+{
+	nemo_file_unref (write->file);
+	g_object_unref (write->info);
+	g_free (write);
+}
+
 static void
 set_metadata_get_info_callback (GObject *source_object,
 				GAsyncResult *res,
@@ -107,16 +199,50 @@ set_metadata_get_info_callback (GObject *source_object,
 	}
 }
 
+/* Applies the written keys to the file's metadata again, in case it was
+ * read from disk while the write was in progress. Keys set again since
+ * are left alone; their newer value is already in the metadata.
+ */
+static gboolean
+update_metadata_from_write (MetadataWrite *write)
+{
+	char **attributes;
+	GFileAttributeType type;
+	gpointer value;
+	gboolean changed;
+	int i;
+
+	changed = FALSE;
+	attributes = g_file_info_list_attributes (write->info, "metadata");
+
+	for (i = 0; attributes[i] != NULL; i++) {
+		if (!is_newest_metadata_write (write, attributes[i]) ||
+		    !g_file_info_get_attribute_data (write->info, attributes[i],
+						     &type, &value, NULL)) {
+			continue;
+		}
+
+		changed |= nemo_file_update_metadata_value
+			(write->file, attributes[i] + strlen ("metadata::"),
+			 type == G_FILE_ATTRIBUTE_TYPE_STRINGV,
+			 type == G_FILE_ATTRIBUTE_TYPE_INVALID ? NULL : value);
+	}
+
+	g_strfreev (attributes);
+
+	return changed;
+}
+
 static void
 set_metadata_callback (GObject *source_object,
 		       GAsyncResult *result,
 		       gpointer callback_data)
 {
-	NemoFile *file;
+	MetadataWrite *write;
 	GError *error;
 	gboolean res;
 
-	file = callback_data;
+	write = callback_data;
 
 	error = NULL;
 	res = g_file_set_attributes_finish (G_FILE (source_object),
@@ -125,16 +251,165 @@ set_metadata_callback (GObject *source_object,
 					    &error);
 
 	if (res) {
+		if (update_metadata_from_write (write)) {
+			nemo_file_changed (write->file);
+		}
+	} else {
+		/* Read back what is actually stored. */
 		g_file_query_info_async (G_FILE (source_object),
 					 NEMO_FILE_DEFAULT_ATTRIBUTES,
 					 0,
 					 G_PRIORITY_DEFAULT,
 					 NULL,
-					 set_metadata_get_info_callback, file);
-	} else {
-		nemo_file_unref (file);
+					 set_metadata_get_info_callback,
+					 nemo_file_ref (write->file));
 		g_error_free (error);
 	}
+
+	metadata_write_done (write);
+	metadata_write_free (write);
+}
+
+static int
+compare_metadata_writes_by_directory (gconstpointer a,
+				      gconstpointer b)
+{
+	const MetadataWrite *write_a, *write_b;
+
+	write_a = a;
+	write_b = b;
+
+	if (write_a->file->details->directory < write_b->file->details->directory) {
+		return -1;
+	}
+	if (write_a->file->details->directory > write_b->file->details->directory) {
+		return 1;
+	}
+	return 0;
+}
+
+/* Takes all the pending writes, sorted by directory */
+static GList *
+steal_pending_metadata_writes (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	GList *writes;
+
+	writes = NULL;
+	g_hash_table_iter_init (&iter, pending_metadata_writes);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		writes = g_list_prepend (writes, value);
+	}
+	g_hash_table_steal_all (pending_metadata_writes);
+
+	return g_list_sort (writes, compare_metadata_writes_by_directory);
+}
+
+static gboolean
+write_pending_metadata (gpointer callback_data)
+{
+	GList *writes, *l;
+	MetadataWrite *write;
+	GFile *location;
+
+	pending_metadata_writes_timeout_id = 0;
+
+	writes = steal_pending_metadata_writes ();
+
+	for (l = writes; l != NULL; l = l->next) {
+		write = l->data;
+
+		if (write->changed) {
+			nemo_file_changed (write->file);
+		}
+
+		location = nemo_file_get_location (write->file);
+		g_file_set_attributes_async (location,
+					     write->info,
+					     0,
+					     G_PRIORITY_DEFAULT,
+					     NULL,
+					     set_metadata_callback,
+					     write);
+		g_object_unref (location);
+	}
+	g_list_free (writes);
+
+	return FALSE;
+}
+
+/* Writes out the pending metadata changes right away, blocking until
+ * they are on disk. Used when quitting, when the delayed write would
+ * never happen.
+ */
+void
+nemo_vfs_file_flush_metadata_writes (void)
+{
+	GList *writes, *l;
+	MetadataWrite *write;
+	GFile *location;
+	GError *error;
+
+	if (pending_metadata_writes_timeout_id != 0) {
+		g_source_remove (pending_metadata_writes_timeout_id);
+		pending_metadata_writes_timeout_id = 0;
+	}
+
+	if (pending_metadata_writes == NULL) {
+		return;
+	}
+
+	writes = steal_pending_metadata_writes ();
+
+	for (l = writes; l != NULL; l = l->next) {
+		write = l->data;
+
+		location = nemo_file_get_location (write->file);
+		error = NULL;
+		if (!g_file_set_attributes_from_info (location,
+						      write->info,
+						      0,
+						      NULL,
+						      &error)) {
+			g_warning ("Couldn't save the metadata of %s: %s",
+				   write->file->details->name,
+				   error->message);
+			g_error_free (error);
+		}
+		g_object_unref (location);
+
+		metadata_write_done (write);
+		metadata_write_free (write);
+	}
+	g_list_free (writes);
+}
+
+static MetadataWrite *
+get_pending_metadata_write (NemoFile *file)
+{
+	MetadataWrite *write;
+
+	if (pending_metadata_writes == NULL) {
+		pending_metadata_writes = g_hash_table_new (NULL, NULL);
+	}
+
+	write = g_hash_table_lookup (pending_metadata_writes, file);
+	if (write == NULL) {
+		write = g_new0 (MetadataWrite, 1);
+		write->file = nemo_file_ref (file);
+		write->info = g_file_info_new ();
+		write->serial = ++metadata_write_serial;
+		g_hash_table_insert (pending_metadata_writes, file, write);
+	}
+
+	if (pending_metadata_writes_timeout_id == 0) {
+		pending_metadata_writes_timeout_id =
+			g_timeout_add (METADATA_WRITE_DELAY_MSEC,
+				       write_pending_metadata, NULL);
+	}
+
+	return write;
 }
 
 static void
@@ -142,33 +417,24 @@ vfs_file_set_metadata (NemoFile           *file,
 		       const char             *key,
 		       const char             *value)
 {
-	GFileInfo *info;
-	GFile *location;
+	MetadataWrite *write;
 	char *gio_key;
 
-	info = g_file_info_new ();
-	
+	write = get_pending_metadata_write (file);
+
 	gio_key = g_strconcat ("metadata::", key, NULL);
 	if (value != NULL) {
-		g_file_info_set_attribute_string (info, gio_key, value);
+		g_file_info_set_attribute_string (write->info, gio_key, value);
 	} else {
 		/* Unset the key */
-		g_file_info_set_attribute (info, gio_key,
+		g_file_info_set_attribute (write->info, gio_key,
 					   G_FILE_ATTRIBUTE_TYPE_INVALID,
 					   NULL);
 	}
+	set_newest_metadata_write (write, gio_key);
 	g_free (gio_key);
 
-	location = nemo_file_get_location (file);
-	g_file_set_attributes_async (location,
-				     info,
-				     0,
-				     G_PRIORITY_DEFAULT,
-				     NULL,
-				     set_metadata_callback,
-				     nemo_file_ref (file));
-	g_object_unref (location);
-	g_object_unref (info);
+	write->changed |= nemo_file_update_metadata_value (file, key, FALSE, value);
 }
 
 static void
@@ -176,26 +442,17 @@ vfs_file_set_metadata_as_list (NemoFile           *file,
 			       const char             *key,
 			       char                  **value)
 {
-	GFile *location;
-	GFileInfo *info;
+	MetadataWrite *write;
 	char *gio_key;
 
-	info = g_file_info_new ();
+	write = get_pending_metadata_write (file);
 
 	gio_key = g_strconcat ("metadata::", key, NULL);
-	g_file_info_set_attribute_stringv (info, gio_key, value);
+	g_file_info_set_attribute_stringv (write->info, gio_key, value);
+	set_newest_metadata_write (write, gio_key);
 	g_free (gio_key);
 
-	location = nemo_file_get_location (file);
-	g_file_set_attributes_async (location,
-				     info,
-				     0,
-				     G_PRIORITY_DEFAULT,
-				     NULL,
-				     set_metadata_callback,
-				     nemo_file_ref (file));
-	g_object_unref (info);
-	g_object_unref (location);
+	write->changed |= nemo_file_update_metadata_value (file, key, TRUE, value);
 }
 
 static gboolean
@@ -251,19 +508,19 @@ vfs_file_get_deep_counts (NemoFile *file,
 
 	if (file->details->deep_counts_status != NEMO_REQUEST_NOT_STARTED) {
 		if (directory_count != NULL) {
-			*directory_count = file->details->deep_directory_count;
+			*directory_count = nemo_file_peek_extras (file)->deep_directory_count;
 		}
 		if (file_count != NULL) {
-			*file_count = file->details->deep_file_count;
+			*file_count = nemo_file_peek_extras (file)->deep_file_count;
 		}
 		if (unreadable_directory_count != NULL) {
-			*unreadable_directory_count = file->details->deep_unreadable_count;
+			*unreadable_directory_count = nemo_file_peek_extras (file)->deep_unreadable_count;
 		}
 		if (total_size != NULL) {
-			*total_size = file->details->deep_size;
+			*total_size = nemo_file_peek_extras (file)->deep_size;
 		}
         if (hidden_count != NULL) {
-            *hidden_count = file->details->deep_hidden_count;
+            *hidden_count = nemo_file_peek_extras (file)->deep_hidden_count;
         }
 		return file->details->deep_counts_status;
 	}
@@ -314,11 +571,11 @@ vfs_file_get_date (NemoFile *file,
 		return TRUE;
 	case NEMO_DATE_TYPE_TRASHED:
 		/* Before we have info on a file, the date is unknown. */
-		if (file->details->trash_time == 0) {
+		if (nemo_file_peek_extras (file)->trash_time == 0) {
 			return FALSE;
 		}
 		if (date != NULL) {
-			*date = file->details->trash_time;
+			*date = nemo_file_peek_extras (file)->trash_time;
 		}
 		return TRUE;
 	case NEMO_DATE_TYPE_PERMISSIONS_CHANGED:
@@ -52,4 +52,6 @@ typedef struct {
 
 GType   nemo_vfs_file_get_type (void);
 
+void    nemo_vfs_file_flush_metadata_writes (void);
+
 #endif /* NEMO_VFS_FILE_H */
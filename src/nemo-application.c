@@ -59,8 +59,10 @@
 #include <libnemo-private/nemo-lib-self-check-functions.h>
 #include <libnemo-private/nemo-module.h>
 #include <libnemo-private/nemo-signaller.h>
+#include <libnemo-private/nemo-trace.h>
 #include <libnemo-private/nemo-ui-utilities.h>
 #include <libnemo-private/nemo-undo-manager.h>
+#include <libnemo-private/nemo-vfs-file.h>
 #include <libnemo-extension/nemo-menu-provider.h>
 
 #define DEBUG_FLAG NEMO_DEBUG_APPLICATION
@@ -243,22 +245,20 @@ menu_provider_items_updated_handler (NemoMenuProvider *provider, GtkWidget* pare
 }
 
 static void
-menu_provider_init_callback (void)
+menu_provider_added (gpointer data, gpointer user_data)
 {
-        GList *providers;
-        GList *l;
-
-        providers = nemo_module_get_extensions_for_type (NEMO_TYPE_MENU_PROVIDER);
-
-        for (l = providers; l != NULL; l = l->next) {
-                NemoMenuProvider *provider = NEMO_MENU_PROVIDER (l->data);
-
-		g_signal_connect_after (G_OBJECT (provider), "items_updated",
-                           (GCallback)menu_provider_items_updated_handler,
-                           NULL);
-        }
+	g_signal_connect_after (G_OBJECT (data), "items_updated",
+				(GCallback)menu_provider_items_updated_handler,
+				NULL);
+}
 
-        nemo_module_extension_list_free (providers);
+static void
+menu_provider_init_callback (void)
+{
+	/* Extension modules are loaded lazily, so connect to each
+	 * provider as it shows up instead of loading them all now */
+	nemo_module_watch_extensions_for_type (NEMO_TYPE_MENU_PROVIDER,
+					       menu_provider_added, NULL);
 }
 
 static void 
@@ -459,6 +459,24 @@ another_navigation_window_already_showing (NemoApplication *application,
 	return FALSE;
 }
 
+static gboolean
+trace_first_paint (GtkWidget *widget,
+		   cairo_t *cr,
+		   gpointer user_data)
+{
+	static gboolean painted = FALSE;
+
+	g_signal_handlers_disconnect_by_func (widget, trace_first_paint, user_data);
+
+	if (!painted) {
+		painted = TRUE;
+		nemo_trace_instant ("startup", "First paint", NULL);
+		nemo_trace_flush ();
+	}
+
+	return FALSE;
+}
+
 NemoWindow *
 nemo_application_create_window (NemoApplication *application,
 				    GdkScreen           *screen)
@@ -496,6 +514,11 @@ nemo_application_create_window (NemoApplication *application,
 	}
 	g_free (geometry_string);
 
+	if (nemo_trace_enabled ()) {
+		g_signal_connect (window, "draw",
+				  G_CALLBACK (trace_first_paint), NULL);
+	}
+
 	DEBUG ("Creating a new navigation window");
 	
 	return window;
@@ -1189,10 +1212,16 @@ static void
 nemo_application_startup (GApplication *app)
 {
 	NemoApplication *self = NEMO_APPLICATION (app);
+	gint64 startup_start, trace;
+
+	startup_start = nemo_trace_begin ();
+
 	/* chain up to the GTK+ implementation early, so gtk_init()
 	 * is called for us.
 	 */
+	trace = nemo_trace_begin ();
 	G_APPLICATION_CLASS (nemo_application_parent_class)->startup (app);
+	nemo_trace_end (trace, "startup", "GTK startup", NULL);
 
 	/* initialize the previewer singleton */
 	//nemo_previewer_get_singleton ();
@@ -1201,13 +1230,18 @@ nemo_application_startup (GApplication *app)
 	self->undo_manager = nemo_undo_manager_new ();
 
 	/* create DBus manager */
+	trace = nemo_trace_begin ();
 	nemo_dbus_manager_start (app);
 	nemo_freedesktop_dbus_start (self);
+	nemo_trace_end (trace, "startup", "DBus managers", NULL);
 
 	/* initialize preferences and create the global GSettings objects */
+	trace = nemo_trace_begin ();
 	nemo_global_preferences_init ();
+	nemo_trace_end (trace, "startup", "Preferences", NULL);
 
 	/* register views */
+	trace = nemo_trace_begin ();
 	nemo_icon_view_register ();
 	nemo_desktop_icon_view_register ();
 	nemo_list_view_register ();
@@ -1218,13 +1252,18 @@ nemo_application_startup (GApplication *app)
 
 	/* register property pages */
 	nemo_image_properties_page_register ();
+	nemo_trace_end (trace, "startup", "Register views", NULL);
 
 	/* initialize theming */
+	trace = nemo_trace_begin ();
 	init_icons_and_styles ();
 	init_gtk_accels ();
+	nemo_trace_end (trace, "startup", "Icons and styles", NULL);
 	
 	/* initialize nemo modules */
+	trace = nemo_trace_begin ();
 	nemo_module_setup ();
+	nemo_trace_end (trace, "startup", "Extension modules", NULL);
 
 	/* attach menu-provider module callback */
 	menu_provider_init_callback ();
@@ -1248,7 +1287,12 @@ nemo_application_startup (GApplication *app)
 	 * if there are problems.
 	 */
 	check_required_directories (self);
+
+	trace = nemo_trace_begin ();
 	init_desktop (self);
+	nemo_trace_end (trace, "startup", "Desktop", NULL);
+
+	nemo_trace_end (startup_start, "startup", "Application startup", NULL);
 }
 
 static void
@@ -1258,6 +1302,7 @@ nemo_application_quit_mainloop (GApplication *app)
 
 	nemo_icon_info_clear_caches ();
  	nemo_application_save_accel_map (NULL);
+	nemo_vfs_file_flush_metadata_writes ();
 
     nemo_application_notify_unmount_done (NEMO_APPLICATION (app), NULL);
 
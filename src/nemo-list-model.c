@@ -52,6 +52,12 @@ static GQuark attribute_name_q,
 /* msec delay after Loading... dummy row turns into (empty) */
 #define LOADING_TO_EMPTY_DELAY 100
 
+/* Rows keeping their rendered icon around; a few screenfuls */
+#define MAX_CACHED_ROW_ICONS 1024
+
+/* Rows add_files steps over before searching for a new row's place */
+#define ADD_FILES_MERGE_STEPS 8
+
 static guint list_model_signals[LAST_SIGNAL] = { 0 };
 
 static int nemo_list_model_file_entry_compare_func (gconstpointer a,
@@ -76,6 +82,10 @@ struct NemoListModelDetails {
 	GtkTreeView *drag_view;
 	int drag_begin_x;
 	int drag_begin_y;
+	/* Row the drag is over, looked up once per redraw of drag_view */
+	GSequenceIter *drag_dest_ptr;
+
+	GQueue *cached_icon_entries;
 
 	GPtrArray *columns;
 
@@ -99,6 +109,23 @@ struct FileEntry {
 	GSequence *files;
 	GSequenceIter *ptr;
 	guint loaded : 1;
+
+	/* Icon last rendered for the row, and what it was rendered for */
+	cairo_surface_t *icon_surface;
+	guint icon_file_serial;
+	guint icon_theme_serial;
+	int icon_size;
+	int icon_scale;
+	NemoFileIconFlags icon_flags;
+	guint icon_emblem_flags;
+	GQueue *icon_queue;
+	GList *icon_link;
+};
+
+/* What else a row's icon depends on, see render_file_icon */
+enum {
+	ICON_EMBLEM_PARENT_CANT_WRITE = 1 << 0,
+	ICON_EMBLEM_HIGHLIGHT = 1 << 1
 };
 
 G_DEFINE_TYPE_WITH_CODE (NemoListModel, nemo_list_model, G_TYPE_OBJECT,
@@ -116,9 +143,24 @@ static const GtkTargetEntry drag_types [] = {
 
 static GtkTargetList *drag_target_list = NULL;
 
+static void
+file_entry_clear_icon (FileEntry *file_entry)
+{
+	if (file_entry->icon_surface != NULL) {
+		cairo_surface_destroy (file_entry->icon_surface);
+		file_entry->icon_surface = NULL;
+	}
+	if (file_entry->icon_link != NULL) {
+		g_queue_delete_link (file_entry->icon_queue, file_entry->icon_link);
+		file_entry->icon_link = NULL;
+		file_entry->icon_queue = NULL;
+	}
+}
+
 static void
 file_entry_free (FileEntry *file_entry)
 {
+	file_entry_clear_icon (file_entry);
 	nemo_file_unref (file_entry->file);
 	if (file_entry->reverse_map) {
 		g_hash_table_destroy (file_entry->reverse_map);
@@ -260,25 +302,130 @@ nemo_list_model_get_icon_scale (NemoListModel *model)
    return retval;
 }
 
+/* Renders the icon of a row, with the first emblem that fits */
+static cairo_surface_t *
+render_file_icon (NemoFile *file,
+		  int icon_size,
+		  int icon_scale,
+		  NemoFileIconFlags flags,
+		  guint emblem_flags)
+{
+	GdkPixbuf *pixbuf, *icon, *rendered_icon;
+	GIcon *gicon, *emblemed_icon, *emblem_icon;
+	NemoIconInfo *icon_info;
+	GEmblem *emblem;
+	GList *emblem_icons, *l;
+	char *emblems_to_ignore[3];
+	cairo_surface_t *surface;
+	gint w, h, s, i;
+	gboolean bad_ratio;
+
+	pixbuf = nemo_file_get_icon_pixbuf (file, icon_size, TRUE, icon_scale, flags);
+
+	w = gdk_pixbuf_get_width (pixbuf);
+	h = gdk_pixbuf_get_height (pixbuf);
+
+	s = MAX (w, h);
+	if (s < icon_size)
+		icon_size = s;
+
+	bad_ratio = nemo_icon_get_emblem_size_for_icon_size (icon_size) * icon_scale > w ||
+		    nemo_icon_get_emblem_size_for_icon_size (icon_size) * icon_scale > h;
+
+	gicon = G_ICON (pixbuf);
+
+	/* render emblems with GEmblemedIcon */
+	i = 0;
+	emblems_to_ignore[i++] = NEMO_FILE_EMBLEM_NAME_TRASH;
+	if (emblem_flags & ICON_EMBLEM_PARENT_CANT_WRITE) {
+		emblems_to_ignore[i++] = NEMO_FILE_EMBLEM_NAME_CANT_WRITE;
+	}
+	emblems_to_ignore[i++] = NULL;
+
+	emblem_icons = nemo_file_get_emblem_icons (file,
+						   emblems_to_ignore);
+
+	/* pick only the first emblem we can render for the list view */
+	for (l = emblem_icons; !bad_ratio && l != NULL; l = l->next) {
+		emblem_icon = l->data;
+		if (nemo_icon_theme_can_render (G_THEMED_ICON (emblem_icon))) {
+			emblem = g_emblem_new (emblem_icon);
+			emblemed_icon = g_emblemed_icon_new (gicon, emblem);
+
+			g_object_unref (gicon);
+			g_object_unref (emblem);
+			gicon = emblemed_icon;
+
+			break;
+		}
+	}
+
+	g_list_free_full (emblem_icons, g_object_unref);
+
+	icon_info = nemo_icon_info_lookup (gicon, icon_size, icon_scale);
+	icon = nemo_icon_info_get_pixbuf_at_size (icon_info, icon_size);
+
+	g_object_unref (icon_info);
+	g_object_unref (gicon);
+
+	if (emblem_flags & ICON_EMBLEM_HIGHLIGHT) {
+		rendered_icon = eel_create_spotlight_pixbuf (icon);
+
+		if (rendered_icon != NULL) {
+			g_object_unref (icon);
+			icon = rendered_icon;
+		}
+	}
+
+	surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
+	g_object_unref (icon);
+
+	return surface;
+}
+
+static gboolean
+file_entry_icon_is_valid (FileEntry *file_entry,
+			  int icon_size,
+			  int icon_scale,
+			  NemoFileIconFlags flags,
+			  guint emblem_flags)
+{
+	return file_entry->icon_surface != NULL &&
+		file_entry->icon_file_serial == nemo_file_get_change_serial (file_entry->file) &&
+		file_entry->icon_theme_serial == nemo_icon_info_get_cache_serial () &&
+		file_entry->icon_size == icon_size &&
+		file_entry->icon_scale == icon_scale &&
+		file_entry->icon_flags == flags &&
+		file_entry->icon_emblem_flags == emblem_flags;
+}
+
+/* Keeps the icons of the MAX_CACHED_ROW_ICONS rows rendered last */
+static void
+file_entry_cache_icon (NemoListModel *model, FileEntry *file_entry)
+{
+	FileEntry *oldest;
+
+	g_queue_push_head (model->details->cached_icon_entries, file_entry);
+	file_entry->icon_queue = model->details->cached_icon_entries;
+	file_entry->icon_link = file_entry->icon_queue->head;
+
+	if (g_queue_get_length (model->details->cached_icon_entries) > MAX_CACHED_ROW_ICONS) {
+		oldest = g_queue_peek_tail (model->details->cached_icon_entries);
+		file_entry_clear_icon (oldest);
+	}
+}
+
 static void
 nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int column, GValue *value)
 {
 	NemoListModel *model;
 	FileEntry *file_entry;
 	NemoFile *file;
-	char *str;
-	GdkPixbuf *icon, *rendered_icon;
-	GIcon *gicon, *emblemed_icon, *emblem_icon;
-	NemoIconInfo *icon_info;
-	GEmblem *emblem;
-	GList *emblem_icons, *l;
 	int icon_size, icon_scale;
 	NemoZoomLevel zoom_level;
 	NemoFile *parent_file;
-	char *emblems_to_ignore[3];
-	int i;
 	NemoFileIconFlags flags;
-    cairo_surface_t *surface;
+	guint emblem_flags;
 	
 	model = (NemoListModel *)tree_model;
 
@@ -316,93 +463,42 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
 			flags = NEMO_FILE_ICON_FLAGS_USE_THUMBNAILS |
 				NEMO_FILE_ICON_FLAGS_FORCE_THUMBNAIL_SIZE |
 				NEMO_FILE_ICON_FLAGS_USE_MOUNT_ICON_AS_EMBLEM;
-			if (model->details->drag_view != NULL) {
-				GtkTreePath *path_a, *path_b;
-				
-				gtk_tree_view_get_drag_dest_row (model->details->drag_view,
-								 &path_a,
-								 NULL);
-				if (path_a != NULL) {
-					path_b = gtk_tree_model_get_path (tree_model, iter);
-
-					if (gtk_tree_path_compare (path_a, path_b) == 0) {
-						flags |= NEMO_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
-					}
-						
-					gtk_tree_path_free (path_a);
-					gtk_tree_path_free (path_b);
-				}
+			if (model->details->drag_view != NULL &&
+			    model->details->drag_dest_ptr == iter->user_data) {
+				flags |= NEMO_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
 			}
 
-            GdkPixbuf *pixbuf = nemo_file_get_icon_pixbuf (file, icon_size, TRUE, icon_scale, flags);
-
-            gint w, h, s;
-            gboolean bad_ratio;
-            w = gdk_pixbuf_get_width (pixbuf);
-            h = gdk_pixbuf_get_height (pixbuf);
-
-            s = MAX (w, h);
-            if (s < icon_size)
-                icon_size = s;
-
-            bad_ratio = nemo_icon_get_emblem_size_for_icon_size (icon_size) * icon_scale > w ||
-                        nemo_icon_get_emblem_size_for_icon_size (icon_size) * icon_scale > h;
-
-			gicon = G_ICON (pixbuf);
-
-			/* render emblems with GEmblemedIcon */
+			emblem_flags = 0;
 			parent_file = nemo_file_get_parent (file);
-			i = 0;
-			emblems_to_ignore[i++] = NEMO_FILE_EMBLEM_NAME_TRASH;
 			if (parent_file) {
 				if (!nemo_file_can_write (parent_file)) {
-					emblems_to_ignore[i++] = NEMO_FILE_EMBLEM_NAME_CANT_WRITE;
+					emblem_flags |= ICON_EMBLEM_PARENT_CANT_WRITE;
 				}
 				nemo_file_unref (parent_file);
 			}
-			emblems_to_ignore[i++] = NULL;
-
-			emblem_icons = nemo_file_get_emblem_icons (file,
-								       emblems_to_ignore);
-
-			/* pick only the first emblem we can render for the list view */
-			for (l = emblem_icons; !bad_ratio && l != NULL; l = l->next) {
-				emblem_icon = l->data;
-				if (nemo_icon_theme_can_render (G_THEMED_ICON (emblem_icon))) {
-					emblem = g_emblem_new (emblem_icon);
-					emblemed_icon = g_emblemed_icon_new (gicon, emblem);
-
-					g_object_unref (gicon);
-					g_object_unref (emblem);
-					gicon = emblemed_icon;
-
-					break;
-				}
+			if (model->details->highlight_files != NULL &&
+			    g_list_find_custom (model->details->highlight_files,
+			                        file, (GCompareFunc) nemo_file_compare_location)) {
+				emblem_flags |= ICON_EMBLEM_HIGHLIGHT;
 			}
 
-			g_list_free_full (emblem_icons, g_object_unref);
-
-			icon_info = nemo_icon_info_lookup (gicon, icon_size, icon_scale);
-			icon = nemo_icon_info_get_pixbuf_at_size (icon_info, icon_size);
+			if (!file_entry_icon_is_valid (file_entry, icon_size, icon_scale,
+						       flags, emblem_flags)) {
+				file_entry_clear_icon (file_entry);
 
-			g_object_unref (icon_info);
-			g_object_unref (gicon);
-
-			if (model->details->highlight_files != NULL &&
-			    g_list_find_custom (model->details->highlight_files,
-			                        file, (GCompareFunc) nemo_file_compare_location))
-			{
-				rendered_icon = eel_create_spotlight_pixbuf (icon);
+				file_entry->icon_surface = render_file_icon (file, icon_size, icon_scale,
+									     flags, emblem_flags);
+				file_entry->icon_file_serial = nemo_file_get_change_serial (file);
+				file_entry->icon_theme_serial = nemo_icon_info_get_cache_serial ();
+				file_entry->icon_size = icon_size;
+				file_entry->icon_scale = icon_scale;
+				file_entry->icon_flags = flags;
+				file_entry->icon_emblem_flags = emblem_flags;
 
-				if (rendered_icon != NULL) {
-					g_object_unref (icon);
-					icon = rendered_icon;
-				}
+				file_entry_cache_icon (model, file_entry);
 			}
 
-            surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
-            g_value_take_boxed (value, surface);
-			g_object_unref (icon);
+			g_value_set_boxed (value, file_entry->icon_surface);
 		}
 		break;
 	case NEMO_LIST_MODEL_FILE_NAME_IS_EDITABLE_COLUMN:
@@ -421,9 +517,10 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
 				      "attribute_q", &attribute, 
 				      NULL);
 			if (file != NULL) {
-				str = nemo_file_get_string_attribute_with_default_q (file, 
-											 attribute);
-				g_value_take_string (value, str);
+				/* The cell renderer copies the text straight away,
+				 * so lend it the file's cached string */
+				g_value_set_static_string (value,
+							   nemo_file_peek_string_attribute_with_default_q (file, attribute));
 			} else if (attribute == attribute_name_q) {
 				if (file_entry->parent->loaded) {
 					g_value_set_string (value, _("(Empty)"));
@@ -955,74 +1052,85 @@ add_dummy_row (NemoListModel *model, FileEntry *parent_entry)
 	gtk_tree_path_free (path);
 }
 
-gboolean
-nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
-			      NemoDirectory *directory)
+/* Finds where files from directory go: the sequence and reverse map to
+ * add them to, and their parent entry if they are not top level.
+ */
+static GSequence *
+get_files_for_directory (NemoListModel *model,
+			 NemoDirectory *directory,
+			 FileEntry **parent_entry,
+			 GHashTable **parent_hash)
 {
-	GtkTreeIter iter;
-	GtkTreePath *path;
-	FileEntry *file_entry;
-	GSequenceIter *ptr, *parent_ptr;
-	GSequence *files;
-	gboolean replace_dummy;
-	GHashTable *parent_hash;
+	GSequenceIter *parent_ptr;
 
 	parent_ptr = g_hash_table_lookup (model->details->directory_reverse_map,
 					  directory);
-	if (parent_ptr) {
-		file_entry = g_sequence_get (parent_ptr);
-		ptr = g_hash_table_lookup (file_entry->reverse_map, file);
-	} else {
-		file_entry = NULL;
-		ptr = g_hash_table_lookup (model->details->top_reverse_map, file);
+	if (parent_ptr != NULL) {
+		*parent_entry = g_sequence_get (parent_ptr);
+		*parent_hash = (*parent_entry)->reverse_map;
+		return (*parent_entry)->files;
 	}
 
-	if (ptr != NULL) {
-		g_warning ("file already in tree (parent_ptr: %p)!!!\n", parent_ptr);
-		return FALSE;
-	}
-	
+	*parent_entry = NULL;
+	*parent_hash = model->details->top_reverse_map;
+	return model->details->files;
+}
+
+static FileEntry *
+file_entry_new (NemoFile *file, FileEntry *parent_entry)
+{
+	FileEntry *file_entry;
+
 	file_entry = g_new0 (FileEntry, 1);
 	file_entry->file = nemo_file_ref (file);
-	file_entry->parent = NULL;
+	file_entry->parent = parent_entry;
 	file_entry->subdirectory = NULL;
 	file_entry->files = NULL;
-	
-	files = model->details->files;
-	parent_hash = model->details->top_reverse_map;
-	
-	replace_dummy = FALSE;
 
-	if (parent_ptr != NULL) {
-		file_entry->parent = g_sequence_get (parent_ptr);
-		/* At this point we set loaded. Either we saw
-		 * "done" and ignored it waiting for this, or we do this
-		 * earlier, but then we replace the dummy row anyway,
-		 * so it doesn't matter */
-		file_entry->parent->loaded = 1;
-		parent_hash = file_entry->parent->reverse_map;
-		files = file_entry->parent->files;
-		if (g_sequence_get_length (files) == 1) {
-			GSequenceIter *dummy_ptr = g_sequence_get_iter_at_pos (files, 0);
-			FileEntry *dummy_entry = g_sequence_get (dummy_ptr);
-			if (dummy_entry->file == NULL) {
-				/* replace the dummy loading entry */
-				model->details->stamp++;
-				g_sequence_remove (dummy_ptr);
-				
-				replace_dummy = TRUE;
-			}
+	return file_entry;
+}
+
+/* Removes the "Loading..." row of parent_entry if it is the only one.
+ * Returns TRUE if it did; the row of the first file added takes its place.
+ */
+static gboolean
+remove_dummy_row (NemoListModel *model, FileEntry *parent_entry)
+{
+	GSequenceIter *dummy_ptr;
+	FileEntry *dummy_entry;
+
+	/* At this point we set loaded. Either we saw
+	 * "done" and ignored it waiting for this, or we do this
+	 * earlier, but then we replace the dummy row anyway,
+	 * so it doesn't matter */
+	parent_entry->loaded = 1;
+
+	if (g_sequence_get_length (parent_entry->files) == 1) {
+		dummy_ptr = g_sequence_get_iter_at_pos (parent_entry->files, 0);
+		dummy_entry = g_sequence_get (dummy_ptr);
+		if (dummy_entry->file == NULL) {
+			/* replace the dummy loading entry */
+			model->details->stamp++;
+			g_sequence_remove (dummy_ptr);
+
+			return TRUE;
 		}
 	}
 
-	if (model->details->temp_unsorted)
-        file_entry->ptr = g_sequence_append (files, file_entry);
-    else
-        file_entry->ptr = g_sequence_insert_sorted (files, file_entry,
-                                                    nemo_list_model_file_entry_compare_func, model);
+	return FALSE;
+}
+
+/* Tells the tree view about a row that was just put in the sequence */
+static void
+file_entry_inserted (NemoListModel *model,
+		     FileEntry *file_entry,
+		     gboolean replace_dummy)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	gboolean add_child;
+	gint count;
 
-	g_hash_table_insert (parent_hash, file, file_entry->ptr);
-	
 	iter.stamp = model->details->stamp;
 	iter.user_data = file_entry->ptr;
 
@@ -1033,31 +1141,171 @@ nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
 		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
 	}
 
-    gboolean add_child = FALSE;
+	add_child = FALSE;
 
-    if (nemo_file_is_directory (file)) {
-        gint count;
-        if (nemo_file_get_directory_item_count (file, &count, NULL)) {
-            add_child = count > 0;
-        } else {
-            add_child = TRUE;
-        }
-    }
+	if (nemo_file_is_directory (file_entry->file)) {
+		if (nemo_file_get_directory_item_count (file_entry->file, &count, NULL)) {
+			add_child = count > 0;
+		} else {
+			add_child = TRUE;
+		}
+	}
 
-    if (add_child) {
-        file_entry->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+	if (add_child) {
+		file_entry->files = g_sequence_new ((GDestroyNotify)file_entry_free);
 
-        add_dummy_row (model, file_entry);
+		add_dummy_row (model, file_entry);
 
-        gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
-                                                      path, &iter);
-    }
+		gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
+						      path, &iter);
+	}
 
 	gtk_tree_path_free (path);
+}
+
+gboolean
+nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
+			      NemoDirectory *directory)
+{
+	FileEntry *file_entry, *parent_entry;
+	GSequence *files;
+	gboolean replace_dummy;
+	GHashTable *parent_hash;
+
+	files = get_files_for_directory (model, directory, &parent_entry, &parent_hash);
+
+	if (g_hash_table_lookup (parent_hash, file) != NULL) {
+		g_warning ("file already in tree (parent_ptr: %p)!!!\n",
+			   parent_entry != NULL ? parent_entry->ptr : NULL);
+		return FALSE;
+	}
+
+	file_entry = file_entry_new (file, parent_entry);
+
+	replace_dummy = FALSE;
+
+	if (parent_entry != NULL) {
+		replace_dummy = remove_dummy_row (model, parent_entry);
+	}
+
+	if (model->details->temp_unsorted)
+        file_entry->ptr = g_sequence_append (files, file_entry);
+    else
+        file_entry->ptr = g_sequence_insert_sorted (files, file_entry,
+                                                    nemo_list_model_file_entry_compare_func, model);
+
+	g_hash_table_insert (parent_hash, file, file_entry->ptr);
+
+	file_entry_inserted (model, file_entry, replace_dummy);
 
 	return TRUE;
 }
 
+static int
+file_entry_ptr_compare_func (gconstpointer a,
+			     gconstpointer b,
+			     gpointer      user_data)
+{
+	return nemo_list_model_file_entry_compare_func (*(FileEntry **) a,
+							*(FileEntry **) b,
+							user_data);
+}
+
+/* Adds files, all from directory, in one go. The new files are sorted
+ * among themselves once and then merged into the rows already there in a
+ * single pass, instead of a binary search of the whole model for each.
+ * Returns the number of files added.
+ */
+int
+nemo_list_model_add_files (NemoListModel *model, GList *files,
+			       NemoDirectory *directory)
+{
+	FileEntry *file_entry, *parent_entry;
+	GSequence *sequence;
+	GSequenceIter *ptr;
+	GHashTable *parent_hash, *batch_files;
+	GPtrArray *entries;
+	gboolean replace_dummy;
+	GList *l;
+	guint i;
+	int n_added, steps;
+
+	sequence = get_files_for_directory (model, directory, &parent_entry, &parent_hash);
+
+	/* parent_hash only ever holds sequence iters, so files listed twice
+	 * in the batch are kept out with a set of their own.
+	 */
+	batch_files = g_hash_table_new (NULL, NULL);
+	entries = g_ptr_array_new ();
+	for (l = files; l != NULL; l = l->next) {
+		if (g_hash_table_lookup (parent_hash, l->data) != NULL ||
+		    g_hash_table_lookup (batch_files, l->data) != NULL) {
+			g_warning ("file already in tree (parent_ptr: %p)!!!\n",
+				   parent_entry != NULL ? parent_entry->ptr : NULL);
+			continue;
+		}
+
+		g_hash_table_insert (batch_files, l->data, l->data);
+		file_entry = file_entry_new (l->data, parent_entry);
+		g_ptr_array_add (entries, file_entry);
+	}
+	g_hash_table_destroy (batch_files);
+
+	if (entries->len == 0) {
+		g_ptr_array_free (entries, TRUE);
+		return 0;
+	}
+
+	replace_dummy = FALSE;
+	if (parent_entry != NULL) {
+		replace_dummy = remove_dummy_row (model, parent_entry);
+	}
+
+	if (!model->details->temp_unsorted) {
+		g_qsort_with_data (entries->pdata, entries->len, sizeof (gpointer),
+				   file_entry_ptr_compare_func, model);
+	}
+
+	/* Each row is signalled as soon as it is in, so the tree view
+	 * never sees rows it wasn't told about.
+	 */
+	ptr = NULL;
+	for (i = 0; i < entries->len; i++) {
+		file_entry = g_ptr_array_index (entries, i);
+
+		if (model->details->temp_unsorted) {
+			ptr = g_sequence_get_end_iter (sequence);
+		} else {
+			/* The entries are sorted, so each one goes at or after
+			 * the previous one. Look a few rows ahead for it, and
+			 * binary search when the gap is bigger than that.
+			 */
+			for (steps = 0; ptr != NULL && steps < ADD_FILES_MERGE_STEPS; steps++) {
+				if (g_sequence_iter_is_end (ptr) ||
+				    nemo_list_model_file_entry_compare_func (g_sequence_get (ptr),
+									     file_entry, model) > 0) {
+					break;
+				}
+				ptr = g_sequence_iter_next (ptr);
+			}
+			if (ptr == NULL || steps == ADD_FILES_MERGE_STEPS) {
+				ptr = g_sequence_search (sequence, file_entry,
+							 nemo_list_model_file_entry_compare_func, model);
+			}
+		}
+
+		file_entry->ptr = g_sequence_insert_before (ptr, file_entry);
+		g_hash_table_insert (parent_hash, file_entry->file, file_entry->ptr);
+
+		file_entry_inserted (model, file_entry, replace_dummy && i == 0);
+	}
+
+	n_added = entries->len;
+	g_ptr_array_free (entries, TRUE);
+
+	return n_added;
+}
+
 void
 nemo_list_model_file_changed (NemoListModel *model, NemoFile *file,
 				  NemoDirectory *directory)
@@ -1467,6 +1715,31 @@ nemo_list_model_get_column_id_from_zoom_level (NemoZoomLevel zoom_level)
 	}
 }
 
+/* Looks up the drag destination row before the rows get drawn, rather
+ * than for each of them.
+ */
+static gboolean
+drag_view_draw_cb (GtkWidget *widget,
+		   cairo_t *cr,
+		   NemoListModel *model)
+{
+	GtkTreePath *path;
+	GtkTreeIter iter;
+
+	model->details->drag_dest_ptr = NULL;
+
+	gtk_tree_view_get_drag_dest_row (GTK_TREE_VIEW (widget), &path, NULL);
+	if (path != NULL) {
+		if (gtk_tree_view_get_model (GTK_TREE_VIEW (widget)) == GTK_TREE_MODEL (model) &&
+		    gtk_tree_model_get_iter (GTK_TREE_MODEL (model), &iter, path)) {
+			model->details->drag_dest_ptr = iter.user_data;
+		}
+		gtk_tree_path_free (path);
+	}
+
+	return FALSE;
+}
+
 void
 nemo_list_model_set_drag_view (NemoListModel *model,
 				   GtkTreeView *view,
@@ -1477,6 +1750,18 @@ nemo_list_model_set_drag_view (NemoListModel *model,
 	g_return_if_fail (NEMO_IS_LIST_MODEL (model));
 	g_return_if_fail (!view || GTK_IS_TREE_VIEW (view));
 	
+	if (model->details->drag_view != view) {
+		if (model->details->drag_view != NULL) {
+			g_signal_handlers_disconnect_by_func (model->details->drag_view,
+							      drag_view_draw_cb, model);
+		}
+		if (view != NULL) {
+			g_signal_connect_object (view, "draw",
+						 G_CALLBACK (drag_view_draw_cb), model, 0);
+		}
+		model->details->drag_dest_ptr = NULL;
+	}
+
 	model->details->drag_view = view;
 	model->details->drag_begin_x = drag_begin_x;
 	model->details->drag_begin_y = drag_begin_y;
@@ -1572,6 +1857,9 @@ nemo_list_model_finalize (GObject *object)
 		model->details->highlight_files = NULL;
 	}
 
+	/* The rows took themselves out when they were freed */
+	g_queue_free (model->details->cached_icon_entries);
+
 	g_free (model->details);
 
 	G_OBJECT_CLASS (nemo_list_model_parent_class)->finalize (object);
@@ -1582,6 +1870,7 @@ nemo_list_model_init (NemoListModel *model)
 {
 	model->details = g_new0 (NemoListModelDetails, 1);
 	model->details->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+	model->details->cached_icon_entries = g_queue_new ();
 	model->details->top_reverse_map = g_hash_table_new (g_direct_hash, g_direct_equal);
 	model->details->directory_reverse_map = g_hash_table_new (g_direct_hash, g_direct_equal);
 	model->details->stamp = g_random_int ();
@@ -75,6 +75,9 @@ GType    nemo_list_model_get_type                          (void);
 gboolean nemo_list_model_add_file                          (NemoListModel          *model,
 								NemoFile         *file,
 								NemoDirectory    *directory);
+int      nemo_list_model_add_files                         (NemoListModel          *model,
+								GList            *files,
+								NemoDirectory    *directory);
 void     nemo_list_model_file_changed                      (NemoListModel          *model,
 								NemoFile         *file,
 								NemoDirectory    *directory);
@@ -111,6 +111,12 @@ struct NemoListViewDetails {
 
     gboolean tooltip_flags;
     gboolean show_tooltips;
+
+	/* The model is kept away from the tree view while the first files
+	 * are added, see nemo_list_view_add_files.
+	 */
+	gboolean model_detached;
+	int detached_search_column;
 };
 
 struct SelectionForeachData {
@@ -2135,6 +2141,43 @@ nemo_list_view_add_file (NemoView *view, NemoFile *file, NemoDirectory *director
 	nemo_list_model_add_file (model, file, directory);
 }
 
+static void
+nemo_list_view_add_files (NemoView *view, GList *files, NemoDirectory *directory)
+{
+	NemoListView *list_view;
+
+	list_view = NEMO_LIST_VIEW (view);
+
+	/* The tree view does work for every row inserted, but sets itself
+	 * up for all the rows at once when it is given a model. So the
+	 * files filling an empty view are added with the model detached,
+	 * until the end of this set of file changes.
+	 */
+	if (!list_view->details->model_detached &&
+	    nemo_list_model_is_empty (list_view->details->model)) {
+		list_view->details->detached_search_column =
+			gtk_tree_view_get_search_column (list_view->details->tree_view);
+		gtk_tree_view_set_model (list_view->details->tree_view, NULL);
+		list_view->details->model_detached = TRUE;
+	}
+
+	nemo_list_model_add_files (list_view->details->model, files, directory);
+}
+
+static void
+reattach_model (NemoListView *list_view)
+{
+	if (!list_view->details->model_detached) {
+		return;
+	}
+
+	gtk_tree_view_set_model (list_view->details->tree_view,
+				 GTK_TREE_MODEL (list_view->details->model));
+	gtk_tree_view_set_search_column (list_view->details->tree_view,
+					 list_view->details->detached_search_column);
+	list_view->details->model_detached = FALSE;
+}
+
 static char **
 get_default_visible_columns (NemoListView *list_view)
 {
@@ -2450,6 +2493,8 @@ nemo_list_view_file_changed (NemoView *view, NemoFile *file, NemoDirectory *dire
 	GtkTreePath *file_path;
 
 	listview = NEMO_LIST_VIEW (view);
+
+	reattach_model (listview);
 	
 	nemo_list_model_file_changed (listview->details->model, file, directory);
 
@@ -2730,6 +2775,8 @@ nemo_list_view_end_file_changes (NemoView *view)
 
 	list_view = NEMO_LIST_VIEW (view);
 
+	reattach_model (list_view);
+
 	if (list_view->details->new_selection_path) {
 		gtk_tree_view_set_cursor (list_view->details->tree_view,
 					  list_view->details->new_selection_path,
@@ -2755,6 +2802,8 @@ nemo_list_view_remove_file (NemoView *view, NemoFile *file, NemoDirectory *direc
 	row_reference = NULL;
 	list_view = NEMO_LIST_VIEW (view);
 	tree_model = GTK_TREE_MODEL(list_view->details->model);
+
+	reattach_model (list_view);
 	
 	if (nemo_list_model_get_tree_iter_from_file (list_view->details->model, file, directory, &iter)) {
 		selection = gtk_tree_view_get_selection (list_view->details->tree_view);
@@ -3514,6 +3563,7 @@ nemo_list_view_class_init (NemoListViewClass *class)
 	G_OBJECT_CLASS (class)->finalize = nemo_list_view_finalize;
 
 	nemo_view_class->add_file = nemo_list_view_add_file;
+	nemo_view_class->add_files = nemo_list_view_add_files;
 	nemo_view_class->begin_loading = nemo_list_view_begin_loading;
 	nemo_view_class->end_loading = nemo_list_view_end_loading;
 	nemo_view_class->bump_zoom_level = nemo_list_view_bump_zoom_level;
@@ -33,6 +33,7 @@
 #include "nemo-application.h"
 
 #include <libnemo-private/nemo-debug.h>
+#include <libnemo-private/nemo-trace.h>
 #include <eel/eel-debug.h>
 
 #include <glib/gi18n.h>
@@ -77,6 +78,9 @@ main (int argc, char *argv[])
 
 	g_type_init ();
 
+	/* As early as possible, so traces cover all of startup */
+	nemo_trace_init ();
+
 	/* This will be done by gtk+ later, but for now, force it to GNOME */
 	g_desktop_app_info_set_desktop_env ("GNOME");
 
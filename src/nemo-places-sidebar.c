@@ -144,6 +144,14 @@ typedef struct {
 
     guint popup_menu_action_index;
 
+    guint disk_usage_idle_id;
+
+    /* Where update_places has got to in the store */
+    gint update_heading_position;
+    gint update_child_position;
+    GtkTreeIter update_heading_iter;
+    gboolean update_in_heading;
+
 } NemoPlacesSidebar;
 
 typedef struct {
@@ -373,22 +381,190 @@ is_built_in_bookmark (NemoFile *file)
 	return FALSE;
 }
 
+/* update_places walks the places in display order and matches each one
+ * against the rows already in the store, so that only rows which were
+ * added, removed or changed touch the model. Rows are matched by their
+ * type, section, uri and drive/volume/mount; everything else about a
+ * row is updated in place.
+ */
+static void
+remove_rows_from (NemoPlacesSidebar *sidebar,
+                  GtkTreeIter *parent,
+                  gint position)
+{
+    GtkTreeIter iter;
+
+    if (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (sidebar->store),
+                                       &iter, parent, position)) {
+        while (gtk_tree_store_remove (sidebar->store, &iter)) {
+            ;
+        }
+    }
+}
+
+static gboolean
+row_matches (GtkTreeModel *model,
+             GtkTreeIter *iter,
+             PlaceType place_type,
+             SectionType section_type,
+             const char *uri,
+             GDrive *drive,
+             GVolume *volume,
+             GMount *mount)
+{
+    PlaceType row_place_type;
+    SectionType row_section_type;
+    char *row_uri;
+    GDrive *row_drive;
+    GVolume *row_volume;
+    GMount *row_mount;
+    gboolean match;
+
+    gtk_tree_model_get (model, iter,
+                        PLACES_SIDEBAR_COLUMN_ROW_TYPE, &row_place_type,
+                        PLACES_SIDEBAR_COLUMN_SECTION_TYPE, &row_section_type,
+                        -1);
+
+    if (row_place_type != place_type || row_section_type != section_type) {
+        return FALSE;
+    }
+
+    if (place_type == PLACES_HEADING) {
+        return TRUE;
+    }
+
+    gtk_tree_model_get (model, iter,
+                        PLACES_SIDEBAR_COLUMN_URI, &row_uri,
+                        PLACES_SIDEBAR_COLUMN_DRIVE, &row_drive,
+                        PLACES_SIDEBAR_COLUMN_VOLUME, &row_volume,
+                        PLACES_SIDEBAR_COLUMN_MOUNT, &row_mount,
+                        -1);
+
+    match = g_strcmp0 (row_uri, uri) == 0 &&
+            row_drive == drive &&
+            row_volume == volume &&
+            row_mount == mount;
+
+    g_free (row_uri);
+    if (row_drive != NULL) {
+        g_object_unref (row_drive);
+    }
+    if (row_volume != NULL) {
+        g_object_unref (row_volume);
+    }
+    if (row_mount != NULL) {
+        g_object_unref (row_mount);
+    }
+
+    return match;
+}
+
+/* Looks for a matching row at or after position among the children of
+ * parent. Rows skipped over are gone and are removed, so on success the
+ * match is left at position.
+ */
+static gboolean
+find_row (NemoPlacesSidebar *sidebar,
+          GtkTreeIter *parent,
+          gint position,
+          PlaceType place_type,
+          SectionType section_type,
+          const char *uri,
+          GDrive *drive,
+          GVolume *volume,
+          GMount *mount,
+          GtkTreeIter *iter)
+{
+    GtkTreeModel *model;
+    gint skipped;
+
+    model = GTK_TREE_MODEL (sidebar->store);
+
+    if (!gtk_tree_model_iter_nth_child (model, iter, parent, position)) {
+        return FALSE;
+    }
+
+    skipped = 0;
+    while (!row_matches (model, iter, place_type, section_type,
+                         uri, drive, volume, mount)) {
+        if (!gtk_tree_model_iter_next (model, iter)) {
+            return FALSE;
+        }
+        skipped++;
+    }
+
+    for (; skipped > 0; skipped--) {
+        gtk_tree_model_iter_nth_child (model, iter, parent, position);
+        gtk_tree_store_remove (sidebar->store, iter);
+    }
+
+    return gtk_tree_model_iter_nth_child (model, iter, parent, position);
+}
+
+static void
+update_places_begin (NemoPlacesSidebar *sidebar)
+{
+    sidebar->update_heading_position = 0;
+    sidebar->update_child_position = 0;
+    sidebar->update_in_heading = FALSE;
+}
+
+static void
+update_places_finish_heading (NemoPlacesSidebar *sidebar)
+{
+    if (sidebar->update_in_heading) {
+        remove_rows_from (sidebar, &sidebar->update_heading_iter,
+                          sidebar->update_child_position);
+        sidebar->update_in_heading = FALSE;
+    }
+}
+
+static void
+update_places_end (NemoPlacesSidebar *sidebar)
+{
+    update_places_finish_heading (sidebar);
+    remove_rows_from (sidebar, NULL, sidebar->update_heading_position);
+}
+
 static GtkTreeIter
 add_heading (NemoPlacesSidebar *sidebar,
 	     SectionType section_type,
 	     const gchar *title)
 {
 	GtkTreeIter cat_iter;
+	gchar *heading_text;
 
-	gtk_tree_store_append (sidebar->store, &cat_iter, NULL);
-	gtk_tree_store_set (sidebar->store, &cat_iter,
-			    PLACES_SIDEBAR_COLUMN_ROW_TYPE, PLACES_HEADING,
-			    PLACES_SIDEBAR_COLUMN_SECTION_TYPE, section_type,
-			    PLACES_SIDEBAR_COLUMN_HEADING_TEXT, title,
-                PLACES_SIDEBAR_COLUMN_INDEX, -1,
-			    PLACES_SIDEBAR_COLUMN_EJECT, FALSE,
-			    PLACES_SIDEBAR_COLUMN_NO_EJECT, TRUE,
-			    -1);
+	update_places_finish_heading (sidebar);
+
+	if (find_row (sidebar, NULL, sidebar->update_heading_position,
+		      PLACES_HEADING, section_type, NULL, NULL, NULL, NULL,
+		      &cat_iter)) {
+		gtk_tree_model_get (GTK_TREE_MODEL (sidebar->store), &cat_iter,
+				    PLACES_SIDEBAR_COLUMN_HEADING_TEXT, &heading_text,
+				    -1);
+		if (g_strcmp0 (heading_text, title) != 0) {
+			gtk_tree_store_set (sidebar->store, &cat_iter,
+					    PLACES_SIDEBAR_COLUMN_HEADING_TEXT, title,
+					    -1);
+		}
+		g_free (heading_text);
+	} else {
+		gtk_tree_store_insert (sidebar->store, &cat_iter, NULL,
+				       sidebar->update_heading_position);
+		gtk_tree_store_set (sidebar->store, &cat_iter,
+				    PLACES_SIDEBAR_COLUMN_ROW_TYPE, PLACES_HEADING,
+				    PLACES_SIDEBAR_COLUMN_SECTION_TYPE, section_type,
+				    PLACES_SIDEBAR_COLUMN_HEADING_TEXT, title,
+		            PLACES_SIDEBAR_COLUMN_INDEX, -1,
+				    PLACES_SIDEBAR_COLUMN_EJECT, FALSE,
+				    PLACES_SIDEBAR_COLUMN_NO_EJECT, TRUE,
+				    -1);
+	}
+
+	sidebar->update_heading_position++;
+	sidebar->update_heading_iter = cat_iter;
+	sidebar->update_child_position = 0;
+	sidebar->update_in_heading = TRUE;
 
 	return cat_iter;
 }
@@ -408,6 +584,51 @@ check_heading_for_devices (NemoPlacesSidebar *sidebar,
     return cat_iter;
 }
 
+static gboolean
+place_row_changed (GtkTreeModel *model,
+                   GtkTreeIter *iter,
+                   const char *name,
+                   GIcon *icon,
+                   const int index,
+                   const char *tooltip,
+                   gboolean show_eject_button,
+                   const int df_percent,
+                   gboolean show_df)
+{
+    char *row_name, *row_tooltip;
+    GIcon *row_icon;
+    int row_index, row_df_percent;
+    gboolean row_eject, row_show_df;
+    gboolean changed;
+
+    gtk_tree_model_get (model, iter,
+                        PLACES_SIDEBAR_COLUMN_NAME, &row_name,
+                        PLACES_SIDEBAR_COLUMN_ICON, &row_icon,
+                        PLACES_SIDEBAR_COLUMN_INDEX, &row_index,
+                        PLACES_SIDEBAR_COLUMN_TOOLTIP, &row_tooltip,
+                        PLACES_SIDEBAR_COLUMN_EJECT, &row_eject,
+                        PLACES_SIDEBAR_COLUMN_DF_PERCENT, &row_df_percent,
+                        PLACES_SIDEBAR_COLUMN_SHOW_DF, &row_show_df,
+                        -1);
+
+    changed = g_strcmp0 (row_name, name) != 0 ||
+              g_strcmp0 (row_tooltip, tooltip) != 0 ||
+              row_index != index ||
+              row_eject != show_eject_button ||
+              row_df_percent != df_percent ||
+              row_show_df != show_df ||
+              (row_icon == NULL) != (icon == NULL) ||
+              (icon != NULL && !g_icon_equal (row_icon, icon));
+
+    g_free (row_name);
+    g_free (row_tooltip);
+    if (row_icon != NULL) {
+        g_object_unref (row_icon);
+    }
+
+    return changed;
+}
+
 static GtkTreeIter
 add_place (NemoPlacesSidebar *sidebar,
 	   PlaceType place_type,
@@ -428,6 +649,7 @@ add_place (NemoPlacesSidebar *sidebar,
 	cairo_surface_t      *eject;
 	gboolean show_eject, show_unmount;
 	gboolean show_eject_button;
+	gboolean show_df, had_eject_button;
 
 	cat_iter = check_heading_for_devices (sidebar, section_type, cat_iter);
 
@@ -444,13 +666,56 @@ add_place (NemoPlacesSidebar *sidebar,
 		show_eject_button = (show_unmount || show_eject);
 	}
 
+	show_df = show_df_percent && df_percent >= 0;
+
+	if (find_row (sidebar, &cat_iter, sidebar->update_child_position,
+		      place_type, section_type, uri, drive, volume, mount,
+		      &iter)) {
+		sidebar->update_child_position++;
+
+		if (!place_row_changed (GTK_TREE_MODEL (sidebar->store), &iter,
+					name, icon, index, tooltip,
+					show_eject_button, df_percent, show_df)) {
+			return cat_iter;
+		}
+
+		gtk_tree_model_get (GTK_TREE_MODEL (sidebar->store), &iter,
+				    PLACES_SIDEBAR_COLUMN_EJECT, &had_eject_button,
+				    -1);
+
+		gtk_tree_store_set (sidebar->store, &iter,
+				    PLACES_SIDEBAR_COLUMN_ICON, icon,
+				    PLACES_SIDEBAR_COLUMN_NAME, name,
+				    PLACES_SIDEBAR_COLUMN_INDEX, index,
+				    PLACES_SIDEBAR_COLUMN_EJECT, show_eject_button,
+				    PLACES_SIDEBAR_COLUMN_NO_EJECT, !show_eject_button,
+				    PLACES_SIDEBAR_COLUMN_TOOLTIP, tooltip,
+		            PLACES_SIDEBAR_COLUMN_DF_PERCENT, df_percent,
+		            PLACES_SIDEBAR_COLUMN_SHOW_DF, show_df,
+				    -1);
+
+		/* Leave the eject icon alone unless the button comes or goes,
+		 * it may be highlighted under the pointer.
+		 */
+		if (had_eject_button != show_eject_button) {
+			eject = show_eject_button ? get_eject_icon (sidebar, FALSE) : NULL;
+			gtk_tree_store_set (sidebar->store, &iter,
+					    PLACES_SIDEBAR_COLUMN_EJECT_ICON, eject,
+					    -1);
+		}
+
+		return cat_iter;
+	}
+
 	if (show_eject_button) {
         eject = get_eject_icon (sidebar, FALSE);
 	} else {
 		eject = NULL;
 	}
 
-	gtk_tree_store_append (sidebar->store, &iter, &cat_iter);
+	gtk_tree_store_insert (sidebar->store, &iter, &cat_iter,
+			       sidebar->update_child_position);
+	sidebar->update_child_position++;
 	gtk_tree_store_set (sidebar->store, &iter,
 			    PLACES_SIDEBAR_COLUMN_ICON, icon,
 			    PLACES_SIDEBAR_COLUMN_NAME, name,
@@ -467,7 +732,7 @@ add_place (NemoPlacesSidebar *sidebar,
 			    PLACES_SIDEBAR_COLUMN_EJECT_ICON, eject,
 			    PLACES_SIDEBAR_COLUMN_SECTION_TYPE, section_type,
                 PLACES_SIDEBAR_COLUMN_DF_PERCENT, df_percent,
-                PLACES_SIDEBAR_COLUMN_SHOW_DF, show_df_percent,
+                PLACES_SIDEBAR_COLUMN_SHOW_DF, show_df,
 			    -1);
 
     return cat_iter;
@@ -597,33 +862,180 @@ sidebar_update_restore_selection (NemoPlacesSidebar *sidebar,
 	}
 }
 
-static gint
-get_disk_full (GFile *file, gchar **tooltip_info)
-{
-    GFileInfo *info = g_file_query_filesystem_info (file,
-                                                    "filesystem::*",
-                                                    NULL,
-                                                    NULL);
-        guint64 k_used, k_total, k_free;
-        gint df_percent;
-        float fraction;
-        int prefix;
-        gchar *free_string;
+/* Filesystem usage is queried asynchronously and cached per mount, so
+ * that a slow or hung mount can't block the sidebar. Until a result is
+ * in, or when the mount doesn't answer, rows show no usage bar.
+ */
+#define DISK_USAGE_REFRESH_SECONDS 30
+#define DISK_USAGE_TIMEOUT_SECONDS 5
+
+typedef struct {
+    gchar *uri;
+    gint percent; /* -1 if unknown */
+    guint64 free_space;
+    gint64 updated; /* monotonic time of the last answer, 0 for never */
+    gboolean querying;
+    gboolean timed_out;
+    guint timeout_id;
+    GCancellable *cancellable;
+} DiskUsage;
+
+static GHashTable *disk_usage_cache = NULL;
+static GList *disk_usage_sidebars = NULL;
+
+static gboolean
+disk_usage_changed_idle (gpointer user_data)
+{
+    NemoPlacesSidebar *sidebar = NEMO_PLACES_SIDEBAR (user_data);
+
+    sidebar->disk_usage_idle_id = 0;
+    update_places (sidebar);
 
+    return FALSE;
+}
+
+static void
+disk_usage_changed (DiskUsage *usage)
+{
+    NemoPlacesSidebar *sidebar;
+    GList *l;
+
+    DEBUG ("Filesystem usage of %s is now %d%%", usage->uri, usage->percent);
+
+    for (l = disk_usage_sidebars; l != NULL; l = l->next) {
+        sidebar = l->data;
+        if (sidebar->disk_usage_idle_id == 0) {
+            sidebar->disk_usage_idle_id = g_idle_add (disk_usage_changed_idle, sidebar);
+        }
+    }
+}
+
+static gboolean
+disk_usage_timeout (gpointer user_data)
+{
+    DiskUsage *usage = user_data;
+
+    usage->timeout_id = 0;
+
+    /* The query may keep running in its thread until the mount
+     * answers; it isn't reissued until it has returned.
+     */
+    g_cancellable_cancel (usage->cancellable);
+
+    if (!usage->timed_out) {
+        usage->timed_out = TRUE;
+        if (usage->percent != -1) {
+            usage->percent = -1;
+            disk_usage_changed (usage);
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+disk_usage_query_done (GObject *source_object,
+                       GAsyncResult *res,
+                       gpointer user_data)
+{
+    DiskUsage *usage = user_data;
+    GFileInfo *info;
+    guint64 k_used, k_total, k_free;
+    gint percent;
+
+    usage->querying = FALSE;
+    if (usage->timeout_id != 0) {
+        g_source_remove (usage->timeout_id);
+        usage->timeout_id = 0;
+    }
+    g_clear_object (&usage->cancellable);
+
+    info = g_file_query_filesystem_info_finish (G_FILE (source_object), res, NULL);
+
+    percent = -1;
+    k_free = 0;
+    if (info != NULL) {
         k_used = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_USED);
         k_total = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
         k_free = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-        fraction = ((float) k_used / (float) k_total) * 100.0;
-        df_percent = (gint) rintf(fraction);
+        if (k_total > 0) {
+            percent = (gint) rintf (((float) k_used / (float) k_total) * 100.0);
+            percent = (percent > -1 && percent < 101) ? percent : 0;
+        }
+        g_object_unref (info);
+        usage->timed_out = FALSE;
+    }
 
-        prefix = g_settings_get_enum (nemo_preferences, NEMO_PREFERENCES_SIZE_PREFIXES);
-        free_string = g_format_size_full (k_free, prefix);
+    /* Failed and timed out queries are retried after the same interval */
+    usage->updated = g_get_monotonic_time ();
+
+    if (usage->percent != percent || usage->free_space != k_free) {
+        usage->percent = percent;
+        usage->free_space = k_free;
+        disk_usage_changed (usage);
+    }
+}
+
+static void
+disk_usage_query (DiskUsage *usage)
+{
+    GFile *file;
+
+    usage->querying = TRUE;
+    usage->cancellable = g_cancellable_new ();
+    usage->timeout_id = g_timeout_add_seconds (DISK_USAGE_TIMEOUT_SECONDS,
+                                               disk_usage_timeout, usage);
+
+    file = g_file_new_for_uri (usage->uri);
+    g_file_query_filesystem_info_async (file, "filesystem::*",
+                                        G_PRIORITY_DEFAULT,
+                                        usage->cancellable,
+                                        disk_usage_query_done,
+                                        usage);
+    g_object_unref (file);
+}
+
+/* Returns the cached usage of the filesystem at uri, or -1 if it isn't
+ * known (yet), and starts a refresh if the cached value is old.
+ */
+static gint
+get_disk_full (const gchar *uri, gchar **tooltip_info)
+{
+    DiskUsage *usage;
+    gchar *free_string;
+    int prefix;
+
+    if (disk_usage_cache == NULL) {
+        disk_usage_cache = g_hash_table_new (g_str_hash, g_str_equal);
+    }
+
+    usage = g_hash_table_lookup (disk_usage_cache, uri);
+    if (usage == NULL) {
+        usage = g_new0 (DiskUsage, 1);
+        usage->uri = g_strdup (uri);
+        usage->percent = -1;
+        g_hash_table_insert (disk_usage_cache, usage->uri, usage);
+    }
+
+    /* Entries are never freed, since a query may still be running */
+    if (!usage->querying &&
+        (usage->updated == 0 ||
+         g_get_monotonic_time () - usage->updated > DISK_USAGE_REFRESH_SECONDS * G_USEC_PER_SEC)) {
+        disk_usage_query (usage);
+    }
 
+    if (usage->percent == -1) {
+        *tooltip_info = g_strdup (usage->timed_out ?
+                                  _("Free space: not responding") :
+                                  _("Free space: unknown"));
+    } else {
+        prefix = g_settings_get_enum (nemo_preferences, NEMO_PREFERENCES_SIZE_PREFIXES);
+        free_string = g_format_size_full (usage->free_space, prefix);
         *tooltip_info = g_strdup_printf (_("Free space: %s"), free_string);
         g_free (free_string);
-        if (info != NULL)
-            g_object_unref (info);
-        return (df_percent > -1 && df_percent < 101) ? df_percent : 0;
+    }
+
+    return usage->percent;
 }
 
 static gboolean
@@ -727,7 +1139,7 @@ update_places (NemoPlacesSidebar *sidebar)
 				    &last_iter,
 				    PLACES_SIDEBAR_COLUMN_URI, &last_uri, -1);
 	}
-	gtk_tree_store_clear (sidebar->store);
+	update_places_begin (sidebar);
 
 	sidebar->devices_header_added = FALSE;
 	sidebar->bookmarks_header_added = FALSE;
@@ -745,7 +1157,7 @@ update_places (NemoPlacesSidebar *sidebar)
     /* home folder */
     mount_uri = nemo_get_home_directory_uri ();
     icon = get_gicon (mount_uri);
-    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+    full = get_disk_full (mount_uri, &tooltip_info);
     tooltip = g_strdup_printf (_("Open your personal folder\n%s"), tooltip_info);
     g_free (tooltip_info);
     cat_iter = add_place (sidebar, PLACES_BUILT_IN,
@@ -756,6 +1168,7 @@ update_places (NemoPlacesSidebar *sidebar)
                            full, home_on_different_fs (mount_uri),
                            cat_iter);
     g_object_unref (icon);
+    g_free (sidebar->top_bookend_uri);
     sidebar->top_bookend_uri = g_strdup (mount_uri);
     g_free (mount_uri);
     g_free (tooltip);
@@ -822,13 +1235,14 @@ update_places (NemoPlacesSidebar *sidebar)
                               NULL, NULL, NULL, 0,
                               _("Recent files"), 0, FALSE, cat_iter);
         g_object_unref (icon);
+        g_free (sidebar->bottom_bookend_uri);
         sidebar->bottom_bookend_uri = g_strdup (mount_uri);
     }
 
     /* file system root */
     mount_uri = "file:///"; /* No need to strdup */
     icon = g_themed_icon_new (NEMO_ICON_FILESYSTEM);
-    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+    full = get_disk_full (mount_uri, &tooltip_info);
     tooltip = g_strdup_printf (_("Open the contents of the File System\n%s"), tooltip_info);
     g_free (tooltip_info);
     cat_iter = add_place (sidebar, PLACES_BUILT_IN,
@@ -841,8 +1255,10 @@ update_places (NemoPlacesSidebar *sidebar)
     g_object_unref (icon);
     g_free (tooltip);
 
-    if (!recent_is_supported())
+    if (!recent_is_supported()) {
+        g_free (sidebar->bottom_bookend_uri);
         sidebar->bottom_bookend_uri = g_strdup (mount_uri);
+    }
 
     mount_uri = "trash:///"; /* No need to strdup */
     icon = nemo_trash_monitor_get_icon ();
@@ -969,7 +1385,7 @@ update_places (NemoPlacesSidebar *sidebar)
                     root = g_mount_get_default_location (mount);
                     mount_uri = g_file_get_uri (root);
                     name = g_mount_get_name (mount);
-                    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+                    full = get_disk_full (mount_uri, &tooltip_info);
                     tooltip = g_strdup_printf (_("%s (%s)\n%s"),
                                                g_file_get_parse_name (root),
                                                g_volume_get_identifier (volume,
@@ -1068,7 +1484,7 @@ update_places (NemoPlacesSidebar *sidebar)
             icon = g_mount_get_icon (mount);
             root = g_mount_get_default_location (mount);
             mount_uri = g_file_get_uri (root);
-            full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+            full = get_disk_full (mount_uri, &tooltip_info);
             tooltip = g_strdup_printf (_("%s\n%s"),
                                        g_file_get_parse_name (root),
                                        tooltip_info);
@@ -1164,6 +1580,8 @@ update_places (NemoPlacesSidebar *sidebar)
                            cat_iter);
 	g_object_unref (icon);
 
+	update_places_end (sidebar);
+
 	/* restore selection */
     restore_expand_state (sidebar);
 	sidebar_update_restore_selection (sidebar, location, last_uri);
@@ -3965,6 +4383,8 @@ nemo_places_sidebar_init (NemoPlacesSidebar *sidebar)
 
     sidebar->in_drag = FALSE;
 
+    disk_usage_sidebars = g_list_prepend (disk_usage_sidebars, sidebar);
+
 	sidebar->volume_monitor = g_volume_monitor_get ();
 
     sidebar->my_computer_expanded = g_settings_get_boolean (nemo_window_state,
@@ -4219,6 +4639,12 @@ nemo_places_sidebar_dispose (GObject *object)
 	free_drag_data (sidebar);
     g_clear_object (&sidebar->unmount_notify);
 
+    disk_usage_sidebars = g_list_remove (disk_usage_sidebars, sidebar);
+    if (sidebar->disk_usage_idle_id != 0) {
+        g_source_remove (sidebar->disk_usage_idle_id);
+        sidebar->disk_usage_idle_id = 0;
+    }
+
 	if (sidebar->eject_highlight_path != NULL) {
 		gtk_tree_path_free (sidebar->eject_highlight_path);
 		sidebar->eject_highlight_path = NULL;
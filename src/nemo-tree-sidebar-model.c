@@ -77,6 +77,10 @@ struct TreeNode {
 	TreeNode *next;
 	TreeNode *prev;
 
+	/* Position among the parent's children, not counting the dummy
+	 * row. Not valid from the parent's first_stale_child on. */
+	int index;
+
 	/* part of the node used only for directories */
 	int dummy_child_ref_count;
 	int all_children_ref_count;
@@ -88,6 +92,12 @@ struct TreeNode {
 	guint files_changed_id;
 
 	TreeNode *first_child;
+	TreeNode *last_child;
+	int n_children;
+	/* Removals leave the indexes of the children after them too high.
+	 * The first such child and its real position, NULL if none. */
+	TreeNode *first_stale_child;
+	int first_stale_index;
 
 	/* misc. flags */
 	guint done_loading : 1;
@@ -213,6 +223,24 @@ tree_node_unparent (FMTreeModel *model, TreeNode *node)
 		prev->next = next;
 	}
 
+	if (parent != NULL) {
+		parent->n_children--;
+		if (next == NULL) {
+			g_assert (parent->last_child == node);
+			parent->last_child = prev;
+		}
+
+		if (node == parent->first_stale_child) {
+			parent->first_stale_child = next;
+		} else if (next != NULL &&
+			   (parent->first_stale_child == NULL ||
+			    node->index < parent->first_stale_index)) {
+			/* The siblings after this one move up */
+			parent->first_stale_child = next;
+			parent->first_stale_index = node->index;
+		}
+	}
+
 	node->parent = NULL;
 	node->next = NULL;
 	node->prev = NULL;
@@ -241,28 +269,34 @@ tree_node_destroy (FMTreeModel *model, TreeNode *node)
 	g_free (node);
 }
 
+/* Children are added at the end, so the indexes of the others stay
+ * valid and paths of new rows are cheap to work out.
+ */
 static void
 tree_node_parent (TreeNode *node, TreeNode *parent)
 {
-	TreeNode *first_child;
+	TreeNode *last_child;
 
 	g_assert (parent != NULL);
 	g_assert (node->parent == NULL);
 	g_assert (node->prev == NULL);
 	g_assert (node->next == NULL);
 
-	first_child = parent->first_child;
+	last_child = parent->last_child;
 	
 	node->parent = parent;
 	node->root = parent->root;
-	node->next = first_child;
+	node->prev = last_child;
 
-	if (first_child != NULL) {
-		g_assert (first_child->prev == NULL);
-		first_child->prev = node;
+	if (last_child != NULL) {
+		g_assert (last_child->next == NULL);
+		last_child->next = node;
+	} else {
+		parent->first_child = node;
 	}
 
-	parent->first_child = node;
+	parent->last_child = node;
+	node->index = parent->n_children++;
 }
 
 static GIcon *
@@ -428,15 +462,23 @@ tree_node_get_child_index (TreeNode *parent, TreeNode *child)
 		return 0;
 	}
 
-	i = tree_node_has_dummy_child (parent) ? 1 : 0;
-	for (node = parent->first_child; node != NULL; node = node->next, i++) {
-		if (child == node) {
-			return i;
+	g_assert (child->parent == parent);
+
+	if (parent->first_stale_child != NULL &&
+	    (child == parent->first_stale_child ||
+	     child->index >= parent->first_stale_index)) {
+		/* Renumber up to the child only; a stale index is never
+		 * lower than the real one, so those before are all valid. */
+		for (node = parent->first_stale_child, i = parent->first_stale_index;
+		     node != child; node = node->next, i++) {
+			node->index = i;
 		}
+		child->index = i;
+		parent->first_stale_child = child->next;
+		parent->first_stale_index = i + 1;
 	}
 
-	g_assert_not_reached ();
-	return 0;
+	return child->index + (tree_node_has_dummy_child (parent) ? 1 : 0);
 }
 
 static gboolean
@@ -724,8 +766,8 @@ stop_monitoring_directory (FMTreeModel *model, TreeNode *node)
 static void
 destroy_children_without_reporting (FMTreeModel *model, TreeNode *parent)
 {
-	while (parent->first_child != NULL) {
-		destroy_node_without_reporting (model, parent->first_child);
+	while (parent->last_child != NULL) {
+		destroy_node_without_reporting (model, parent->last_child);
 	}
 }
 
@@ -770,8 +812,9 @@ destroy_node (FMTreeModel *model, TreeNode *node)
 static void
 destroy_children (FMTreeModel *model, TreeNode *parent)
 {
-	while (parent->first_child != NULL) {
-		destroy_node (model, parent->first_child);
+	/* From the end, so no index has to be recomputed */
+	while (parent->last_child != NULL) {
+		destroy_node (model, parent->last_child);
 	}
 }
 
@@ -824,21 +867,26 @@ update_node_without_reporting (FMTreeModel *model, TreeNode *node)
 	return changed;
 }
 
+/* Takes ownership of nodes, which are added in order */
 static void
-insert_node (FMTreeModel *model, TreeNode *parent, TreeNode *node)
+insert_nodes (FMTreeModel *model, TreeNode *parent, GList *nodes)
 {
 	gboolean parent_empty;
+	GList *l;
 
 	parent_empty = parent->first_child == NULL;
 	if (parent_empty) {
-		/* Make sure the dummy lives as we insert the new row */
+		/* Make sure the dummy lives as we insert the new rows */
 		parent->force_has_dummy = TRUE;
 	}
 
-	tree_node_parent (node, parent);
+	for (l = nodes; l != NULL; l = l->next) {
+		tree_node_parent (l->data, parent);
 
-	update_node_without_reporting (model, node);
-	report_node_inserted (model, node);
+		update_node_without_reporting (model, l->data);
+		report_node_inserted (model, l->data);
+	}
+	g_list_free (nodes);
 
 	if (parent_empty) {
 		parent->force_has_dummy = FALSE;
@@ -852,6 +900,12 @@ insert_node (FMTreeModel *model, TreeNode *parent, TreeNode *node)
 	}
 }
 
+static void
+insert_node (FMTreeModel *model, TreeNode *parent, TreeNode *node)
+{
+	insert_nodes (model, parent, g_list_prepend (NULL, node));
+}
+
 static void
 reparent_node (FMTreeModel *model, TreeNode *node)
 {
@@ -951,14 +1005,37 @@ update_node (FMTreeModel *model, TreeNode *node)
 	}
 }
 
+/* New files are not inserted straight away but collected for their
+ * parent, so a freshly loaded directory goes in as one batch.
+ */
+typedef struct {
+	TreeNode *parent;
+	GList *nodes;
+} PendingInsertion;
+
+static void
+flush_pending_insertion (FMTreeModelRoot *root,
+			 PendingInsertion *pending)
+{
+	if (pending->nodes != NULL) {
+		insert_nodes (root->model, pending->parent,
+			      g_list_reverse (pending->nodes));
+	}
+	pending->parent = NULL;
+	pending->nodes = NULL;
+}
+
 static void
 process_file_change (FMTreeModelRoot *root,
-		     NemoFile *file)
+		     NemoFile *file,
+		     PendingInsertion *pending)
 {
 	TreeNode *node, *parent;
 
 	node = get_node_from_file (root, file);
 	if (node != NULL) {
+		/* Might be one of the pending ones, or depend on them */
+		flush_pending_insertion (root, pending);
 		update_node (root->model, node);
 		return;
 	}
@@ -972,7 +1049,12 @@ process_file_change (FMTreeModelRoot *root,
 		return;
 	}
 
-	insert_node (root->model, parent, create_node_for_file (root, file));
+	if (parent != pending->parent) {
+		flush_pending_insertion (root, pending);
+		pending->parent = parent;
+	}
+	pending->nodes = g_list_prepend (pending->nodes,
+					 create_node_for_file (root, file));
 }
 
 static void
@@ -981,13 +1063,16 @@ files_changed_callback (NemoDirectory *directory,
 			gpointer callback_data)
 {
 	FMTreeModelRoot *root;
+	PendingInsertion pending = { NULL, NULL };
 	GList *node;
 
 	root = (FMTreeModelRoot *) (callback_data);
 
 	for (node = changed_files; node != NULL; node = node->next) {
-		process_file_change (root, NEMO_FILE (node->data));
+		process_file_change (root, NEMO_FILE (node->data), &pending);
 	}
+
+	flush_pending_insertion (root, &pending);
 }
 
 static void
@@ -1347,8 +1432,7 @@ fm_tree_model_iter_has_child (GtkTreeModel *model, GtkTreeIter *iter)
 static int
 fm_tree_model_iter_n_children (GtkTreeModel *model, GtkTreeIter *iter)
 {
-	TreeNode *parent, *node;
-	int n;
+	TreeNode *parent;
 	
 	g_return_val_if_fail (FM_IS_TREE_MODEL (model), FALSE);
 	g_return_val_if_fail (iter == NULL || iter_is_valid (FM_TREE_MODEL (model), iter), FALSE);
@@ -1362,12 +1446,7 @@ fm_tree_model_iter_n_children (GtkTreeModel *model, GtkTreeIter *iter)
 		return 0;
 	}
 
-	n = tree_node_has_dummy_child (parent) ? 1 : 0;
-	for (node = parent->first_child; node != NULL; node = node->next) {
-		n++;
-	}
-
-	return n;
+	return parent->n_children + (tree_node_has_dummy_child (parent) ? 1 : 0);
 }
 
 static gboolean
@@ -1396,14 +1475,21 @@ fm_tree_model_iter_nth_child (GtkTreeModel *model, GtkTreeIter *iter,
 		return make_iter_invalid (iter);
 	}
 
-	i = tree_node_has_dummy_child (parent) ? 1 : 0;
-	if (n == 0 && i == 1) {
-		return make_iter_for_dummy_row (parent, iter, parent_iter->stamp);
-	}
-	for (node = parent->first_child; i != n; i++, node = node->next) {
-		if (node == NULL) {
-			return make_iter_invalid (iter);
+	if (tree_node_has_dummy_child (parent)) {
+		if (n == 0) {
+			return make_iter_for_dummy_row (parent, iter, parent_iter->stamp);
 		}
+		n--;
+	}
+	if (n < 0 || n >= parent->n_children) {
+		return make_iter_invalid (iter);
+	}
+
+	/* Walk from whichever end is closer */
+	if (n < parent->n_children / 2) {
+		for (node = parent->first_child, i = 0; i != n; i++, node = node->next);
+	} else {
+		for (node = parent->last_child, i = parent->n_children - 1; i != n; i--, node = node->prev);
 	}
 
 	return make_iter_for_node (node, iter, parent_iter->stamp);	
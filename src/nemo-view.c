@@ -112,6 +112,17 @@
 
 #define MAX_QUEUED_UPDATES 500
 
+/* Time in microseconds spent adding pending files to the view before
+ * letting it lay out and repaint what it has so far.
+ */
+#define PENDING_FILES_FRAME_BUDGET 8000
+
+/* Number of files to add between looks at the clock */
+#define PENDING_FILES_CLOCK_INTERVAL 16
+
+/* Most files handed to a view's add_files at a time */
+#define PENDING_FILES_BATCH_SIZE 512
+
 #define NEMO_VIEW_MENU_PATH_APPLICATIONS_SUBMENU_PLACEHOLDER  "/MenuBar/File/Open Placeholder/Open With/Applications Placeholder"
 #define NEMO_VIEW_MENU_PATH_APPLICATIONS_PLACEHOLDER    	  "/MenuBar/File/Open Placeholder/Applications Placeholder"
 #define NEMO_VIEW_MENU_PATH_SCRIPTS_PLACEHOLDER               "/MenuBar/File/Open Placeholder/Scripts/Scripts Placeholder"
@@ -333,6 +344,7 @@ static void     remove_update_status_idle_callback             (NemoView *view);
 static void     reset_update_interval                          (NemoView      *view);
 static void     schedule_idle_display_of_pending_files         (NemoView      *view);
 static void     unschedule_display_of_pending_files            (NemoView      *view);
+static void     schedule_display_of_remaining_pending_files    (NemoView      *view);
 static void     disconnect_model_handlers                      (NemoView      *view);
 static void     metadata_for_directory_as_file_ready_callback  (NemoFile         *file,
 								gpointer              callback_data);
@@ -3540,6 +3552,49 @@ sort_files (NemoView *view, GList **list)
 	
 }
 
+/* Rotates the sorted list so the files from the first visible one on
+ * come first. Files are added in chunks, and the view sorts them itself,
+ * so this only changes which part of the view fills in first.
+ */
+static void
+move_visible_files_first (NemoView *view, GList **list)
+{
+	NemoFile *visible_file;
+	FileAndDirectory *pending;
+	GList *node, *last;
+	char *uri;
+
+	uri = nemo_view_get_first_visible_file (view);
+	if (uri == NULL) {
+		return;
+	}
+
+	visible_file = nemo_file_get_existing_by_uri (uri);
+	g_free (uri);
+	if (visible_file == NULL) {
+		return;
+	}
+
+	for (node = *list; node != NULL; node = node->next) {
+		pending = node->data;
+		if (NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->compare_files
+		    (view, pending->file, visible_file) >= 0) {
+			break;
+		}
+	}
+
+	if (node != NULL && node != *list) {
+		last = g_list_last (node);
+		node->prev->next = NULL;
+		node->prev = NULL;
+		last->next = *list;
+		(*list)->prev = last;
+		*list = node;
+	}
+
+	nemo_file_unref (visible_file);
+}
+
 /* Go through all the new added and changed files.
  * Put any that are not ready to load in the non_ready_files hash table.
  * Add all the rest to the old_added_files and old_changed_files lists.
@@ -3615,6 +3670,7 @@ process_new_files (NemoView *view)
 	if (old_added_files != view->details->old_added_files) {
 		view->details->old_added_files = old_added_files;
 		sort_files (view, &view->details->old_added_files);
+		move_visible_files_first (view, &view->details->old_added_files);
 	}
 
 	/* Resort old_changed_files too, since file attributes
@@ -3627,38 +3683,133 @@ process_new_files (NemoView *view)
 
 }
 
-static void
+/* Removes the first n_processed links from *list and returns them */
+static GList *
+split_off_processed_files (GList **list, guint n_processed)
+{
+	GList *processed, *rest;
+
+	if (n_processed == 0) {
+		return NULL;
+	}
+
+	processed = *list;
+	rest = g_list_nth (processed, n_processed);
+	if (rest != NULL) {
+		rest->prev->next = NULL;
+		rest->prev = NULL;
+	}
+	*list = rest;
+
+	return processed;
+}
+
+/* Hands the files from node on that are in the same directory, up to
+ * PENDING_FILES_BATCH_SIZE of them, to the view's add_files. Returns the
+ * first node not handed over.
+ */
+static GList *
+add_pending_files_batch (NemoView *view, GList *node, guint *n_added)
+{
+	FileAndDirectory *pending;
+	NemoDirectory *directory;
+	GList *files;
+	guint n_files;
+
+	directory = ((FileAndDirectory *) node->data)->directory;
+	files = NULL;
+
+	for (n_files = 0;
+	     node != NULL && n_files < PENDING_FILES_BATCH_SIZE;
+	     node = node->next, n_files++) {
+		pending = node->data;
+		if (pending->directory != directory) {
+			break;
+		}
+		files = g_list_prepend (files, pending->file);
+	}
+
+	files = g_list_reverse (files);
+	NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->add_files (view, files, directory);
+	g_list_free (files);
+
+	*n_added += n_files;
+
+	return node;
+}
+
+/* Hands the old added and changed files to the view until they run out or
+ * the frame budget is spent. Returns TRUE if there are none left.
+ */
+static gboolean
 process_old_files (NemoView *view)
 {
 	GList *files_added, *files_changed, *node;
 	FileAndDirectory *pending;
 	GList *selection, *files;
-	gboolean send_selection_change;
+	gboolean send_selection_change, out_of_time, add_in_batches;
+	gint64 deadline;
+	guint n_added, n_changed;
 
-	files_added = view->details->old_added_files;
-	files_changed = view->details->old_changed_files;
-	
+	files_added = NULL;
+	files_changed = NULL;
 	send_selection_change = FALSE;
 
-	if (files_added != NULL || files_changed != NULL) {
+	if (view->details->old_added_files != NULL || view->details->old_changed_files != NULL) {
+		deadline = g_get_monotonic_time () + PENDING_FILES_FRAME_BUDGET;
+		out_of_time = FALSE;
+		n_added = 0;
+		n_changed = 0;
+
+		/* Handlers of "add_file", such as the ones selecting newly
+		 * copied files, need to see every file.
+		 */
+		add_in_batches = NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->add_files != NULL &&
+			!g_signal_has_handler_pending (view, signals[ADD_FILE], 0, FALSE);
+
 		g_signal_emit (view, signals[BEGIN_FILE_CHANGES], 0);
 
-		for (node = files_added; node != NULL; node = node->next) {
-			pending = node->data;
-			g_signal_emit (view,
-				       signals[ADD_FILE], 0, pending->file, pending->directory);
+		node = view->details->old_added_files;
+		while (node != NULL && !out_of_time) {
+			if (add_in_batches) {
+				node = add_pending_files_batch (view, node, &n_added);
+				out_of_time = g_get_monotonic_time () >= deadline;
+			} else {
+				pending = node->data;
+				g_signal_emit (view,
+					       signals[ADD_FILE], 0, pending->file, pending->directory);
+				node = node->next;
+
+				if (++n_added % PENDING_FILES_CLOCK_INTERVAL == 0) {
+					out_of_time = g_get_monotonic_time () >= deadline;
+				}
+			}
 		}
 
-		for (node = files_changed; node != NULL; node = node->next) {
-			pending = node->data;
-			g_signal_emit (view,
-				       signals[still_should_show_file (view, pending->file, pending->directory)
-					       ? FILE_CHANGED : REMOVE_FILE], 0,
-				       pending->file, pending->directory);
+		/* Changes are only handed over once all the additions are,
+		 * as they may be for files that are still to be added.
+		 */
+		if (node == NULL) {
+			for (node = view->details->old_changed_files;
+			     node != NULL && !out_of_time;
+			     node = node->next) {
+				pending = node->data;
+				g_signal_emit (view,
+					       signals[still_should_show_file (view, pending->file, pending->directory)
+						       ? FILE_CHANGED : REMOVE_FILE], 0,
+					       pending->file, pending->directory);
+
+				if (++n_changed % PENDING_FILES_CLOCK_INTERVAL == 0) {
+					out_of_time = g_get_monotonic_time () >= deadline;
+				}
+			}
 		}
 
 		g_signal_emit (view, signals[END_FILE_CHANGES], 0);
 
+		files_added = split_off_processed_files (&view->details->old_added_files, n_added);
+		files_changed = split_off_processed_files (&view->details->old_changed_files, n_changed);
+
 		if (files_changed != NULL) {
 			selection = nemo_view_get_selection (view);
 			files = file_and_directory_list_to_files (files_changed);
@@ -3668,11 +3819,8 @@ process_old_files (NemoView *view)
 			nemo_file_list_free (selection);
 		}
 		
-		file_and_directory_list_free (view->details->old_added_files);
-		view->details->old_added_files = NULL;
-
-		file_and_directory_list_free (view->details->old_changed_files);
-		view->details->old_changed_files = NULL;
+		file_and_directory_list_free (files_added);
+		file_and_directory_list_free (files_changed);
 	}
 
 	if (send_selection_change) {
@@ -3681,6 +3829,9 @@ process_old_files (NemoView *view)
 		 */
 		nemo_view_send_selection_change (view);
 	}
+
+	return view->details->old_added_files == NULL &&
+		view->details->old_changed_files == NULL;
 }
 
 static void
@@ -3693,7 +3844,10 @@ display_pending_files (NemoView *view)
 	}
 
 	process_new_files (view);
-	process_old_files (view);
+	if (!process_old_files (view)) {
+		schedule_display_of_remaining_pending_files (view);
+		return;
+	}
 
 	if (view->details->model != NULL
 	    && nemo_directory_are_all_files_seen (view->details->model)
@@ -3813,6 +3967,19 @@ schedule_idle_display_of_pending_files (NemoView *view)
 				 display_pending_callback, view, NULL);
 }
 
+static void
+schedule_display_of_remaining_pending_files (NemoView *view)
+{
+	unschedule_display_of_pending_files (view);
+
+	/* Go on with the files the last dispatch had no time for after the
+	   view had a chance to lay out and repaint the ones it got, so the
+	   first of them show up while the rest are still being added. */
+	view->details->display_pending_source_id =
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE + 10,
+				 display_pending_callback, view, NULL);
+}
+
 static void
 schedule_timeout_display_of_pending_files (NemoView *view, guint interval)
 {
@@ -87,6 +87,14 @@ struct NemoViewClass {
 					  NemoFile *file,
 					  NemoDirectory *directory);
 
+	/* add_files is called in place of the 'add_file' signal to add
+	 * several files from the same directory at once, when nothing
+	 * else is connected to that signal. It can be left NULL.
+	 */
+	void    (* add_files)		 (NemoView *view,
+					  GList *files,
+					  NemoDirectory *directory);
+
 	/* The 'file_changed' signal is emitted to signal a change in a file,
 	 * including the file being removed.
 	 * It must be replaced by each subclass.
@@ -56,6 +56,7 @@
 #include <libnemo-private/nemo-module.h>
 #include <libnemo-private/nemo-monitor.h>
 #include <libnemo-private/nemo-search-directory.h>
+#include <libnemo-private/nemo-trace.h>
 
 #define DEBUG_FLAG NEMO_DEBUG_WINDOW
 #include <libnemo-private/nemo-debug.h>
@@ -647,6 +648,8 @@ begin_location_change (NemoWindowSlot *slot,
 
 	end_location_change (slot);
 
+	slot->trace_load_start = nemo_trace_begin ();
+
 	nemo_window_slot_set_allow_stop (slot, TRUE);
 	nemo_window_slot_set_status (slot, " ", NULL);
 
@@ -1527,9 +1530,14 @@ end_location_change (NemoWindowSlot *slot)
 	uri = nemo_window_slot_get_location_uri (slot);
 	if (uri) {
 		DEBUG ("Finished loading window for uri %s", uri);
-		g_free (uri);
 	}
 
+	if (slot->trace_load_start != 0) {
+		nemo_trace_end (slot->trace_load_start, "window", "Load location", uri);
+		slot->trace_load_start = 0;
+	}
+	g_free (uri);
+
 	nemo_window_slot_set_allow_stop (slot, FALSE);
 	remove_loading_floating_bar (slot);
 
@@ -111,6 +111,9 @@ struct NemoWindowSlot {
 
 	GCancellable *find_mount_cancellable;
 
+	/* For nemo-trace; 0 unless tracing a load */
+	gint64 trace_load_start;
+
 	gboolean visible;
 
 	/* Back/Forward chain, and history list. 
@@ -0,0 +1,64 @@
+#include "test.h"
+
+#include <libnemo-private/nemo-icon-container.h>
+#include <stdlib.h>
+
+/* Stress test for adding and removing many icons.
+ *
+ * Usage: test-nemo-icon-container [n-icons]
+ */
+
+#define DEFAULT_N_ICONS 100000
+
+int
+main (int argc, char *argv[])
+{
+	GtkWidget *container;
+	GTimer *timer;
+	guint *icon_data;
+	guint n_icons, i;
+
+	test_init (&argc, &argv);
+
+	n_icons = DEFAULT_N_ICONS;
+	if (argc > 1) {
+		n_icons = MAX (atoi (argv[1]), 1);
+	}
+
+	container = nemo_icon_container_new ();
+	g_object_ref_sink (container);
+
+	/* The container only uses the icon data as a key. */
+	icon_data = g_new0 (guint, n_icons);
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < n_icons; i++) {
+		nemo_icon_container_add (NEMO_ICON_CONTAINER (container),
+					 (NemoIconData *) &icon_data[i]);
+	}
+	g_print ("added %u icons in %.3f s\n", n_icons, g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	nemo_icon_container_select_all (NEMO_ICON_CONTAINER (container));
+	nemo_icon_container_unselect_all (NEMO_ICON_CONTAINER (container));
+	g_print ("selected and unselected %u icons in %.3f s\n", n_icons, g_timer_elapsed (timer, NULL));
+
+	/* Remove in insertion order; the oldest icon is at the end of the
+	 * container's list, so this used to be quadratic.
+	 */
+	g_timer_start (timer);
+	for (i = 0; i < n_icons; i++) {
+		nemo_icon_container_remove (NEMO_ICON_CONTAINER (container),
+					    (NemoIconData *) &icon_data[i]);
+	}
+	g_print ("removed %u icons in %.3f s\n", n_icons, g_timer_elapsed (timer, NULL));
+
+	g_assert (nemo_icon_container_is_empty (NEMO_ICON_CONTAINER (container)));
+
+	g_timer_destroy (timer);
+	g_free (icon_data);
+	g_object_unref (container);
+
+	return test_quit (0);
+}